@@ -0,0 +1,202 @@
+//*****************************************************************************
+// File Name	: benchtest.c
+//
+// Title		: cycle counts of the driver hot paths
+// Revision		: 1.0
+// Notes		: Built with -DBENCH only ("make benchmark"). Measures with timer1 at
+//				  clk/1 and interrupts off, so the counts are exact and the same on
+//				  the chip and under simavr. Takes over the stepper, timer0/1 and
+//				  PB3/PB4 (SoftSerial); not for a connected machine.
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Revision History:
+// When			Who			Description of change
+// -----------	-----------	-----------------------
+// 19-Oct-2026	flyingyizi		Created the program
+//*****************************************************************************
+
+#ifdef BENCH
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>		   // include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h> // include interrupt support
+#include <avr/sleep.h>
+#include <util/delay_basic.h>
+
+#include "../serial/serial.h"
+#include "../util/print.h"
+#include "../stepper/stepper.h"
+#include "../pcint/pcint.h"
+#include "../softSerial/softSerial.h"
+#include <avr/pgmspace.h>
+
+//example
+// int main()
+// {
+//   // Initialize system upon power-up.
+//   serial_init(); // Setup serial baud rate and interrupts
+//   sei();         // Enable interrupts
+//   benchTest();   // never returns
+//   return 0;
+// }
+
+// One line per hot path, for tools/bench.py:
+//   BENCH,<name>,<cycles>,<symbol>[+<symbol>...]
+// cycles run from the call (for an ISR: from the interrupt response) to the return, so they
+// are what the path costs the CPU each time. ISRs are called directly, which skips the
+// response and the vector jump; BENCH_IRQ adds them back. The symbols are the functions whose
+// sizes tools/bench.py adds up from the ELF.
+#define BENCH_CALL 8  // call + ret
+#define BENCH_IRQ 11  // response + jmp + reti
+
+#define BENCH_STR_(x) #x
+#define BENCH_STR(x) BENCH_STR_(x) // Expands the vector macros to __vector_<n>
+
+#define BENCH_SS_BAUD 9600 // One SoftSerial byte, about 16700 cycles, fits the 16-bit count
+
+typedef void (*bench_fn_t)(void);
+
+extern void SERIAL_RX(void);
+extern void SERIAL_UDRE(void);
+extern void PCINT0_vect(void);
+extern void PCINT1_vect(void);
+extern void TIMER1_COMPA_vect(void);
+extern void TIMER0_OVF_vect(void);
+#ifndef TIMER2_OVF_STATIC
+extern void TIMER2_OVF_vect(void);
+#endif
+
+static uint16_t bench_overhead;
+
+static void bench_nothing(void) { }
+static void bench_callback(void *p) { }
+static void bench_serial_write(void) { serial_write('U'); }
+static void bench_print_integer(void) { printInteger(-1234567); }
+static void bench_print_float(void) { printFloat(-123.456, 3); }
+
+// Waits until the TX ring is empty, so no UDRE interrupt is due during a measurement.
+static void bench_drain(void)
+{
+    sei();
+    while (serial_get_tx_buffer_count()) { }
+}
+
+// Cycles of one fn() call with interrupts off, net of the measurement itself. An ISR called
+// here returns with reti, so interrupts are switched off again right after.
+static uint16_t bench_cycles(bench_fn_t fn)
+{
+    uint16_t t;
+
+    cli();
+    TCNT1 = 0;
+    fn();
+    t = TCNT1;
+    cli();
+    return t - bench_overhead;
+}
+
+static void bench_report(const char *name, uint16_t cycles, const char *symbol)
+{
+    sei();
+    printPgmFormat(PSTR("BENCH,%S,%u,%S\r\n"), name, cycles, symbol);
+    bench_drain(); // The next measurement starts with an idle TX ring
+}
+
+static void bench_timer1_free(void)
+{
+    TIMSK1 = 0;
+    TCCR1A = 0;
+    TCCR1B = (1 << CS10); // normal mode, clk/1
+}
+
+void benchTest(void)
+{
+    uint16_t t;
+
+    bench_timer1_free();
+    bench_overhead = 0;
+    bench_overhead = bench_cycles(bench_nothing);
+    printPgmString(PSTR("\r\nBENCH,begin\r\n"));
+    bench_drain();
+
+    // Hardware serial
+    serial_reset_read_buffer();
+    t = bench_cycles(SERIAL_RX) + BENCH_IRQ;
+    serial_reset_read_buffer();
+    bench_report(PSTR("serial_rx_isr"), t, PSTR(BENCH_STR(SERIAL_RX)));
+
+    t = bench_cycles(bench_serial_write) + BENCH_CALL;
+    bench_report(PSTR("serial_write"), t, PSTR("serial_write"));
+
+    cli();
+    serial_write('U'); // One byte queued, UDRIE on but interrupts off
+    t = bench_cycles(SERIAL_UDRE) + BENCH_IRQ;
+    bench_report(PSTR("serial_udre_isr"), t, PSTR(BENCH_STR(SERIAL_UDRE)));
+
+    // Printing, short enough for the empty TX ring
+    t = bench_cycles(bench_print_integer) + BENCH_CALL;
+    bench_report(PSTR("printInteger"), t, PSTR("printInteger"));
+    t = bench_cycles(bench_print_float) + BENCH_CALL;
+    bench_report(PSTR("printFloat"), t, PSTR("printFloat"));
+
+    // Pin change dispatch to an empty callback (PC0, PCINT1 group)
+    enable_pcinterrupt(register_pcinterrupt(PCINTR8, bench_callback, NULL));
+    t = bench_cycles(PCINT1_vect) + BENCH_IRQ;
+    bench_report(PSTR("pcint_dispatch"), t, PSTR(BENCH_STR(PCINT1_vect)));
+
+    // SoftSerial: one byte through the PCINT0 vector. The RX pin is driven low, so recv() sees
+    // a start bit and samples zeros.
+    SoftSerial *ss = NewSoftSerial(PCINTR3 /* RX */, PCINTR4 /* TX */, BENCH_SS_BAUD);
+    begin(ss);
+    DDRB |= _BV(PB3);
+    PORTB &= ~_BV(PB3);
+    t = bench_cycles(PCINT0_vect) + BENCH_IRQ;
+    bench_report(PSTR("softserial_recv"), t,
+                 PSTR(BENCH_STR(PCINT0_vect) "+softserial_interrupt+recv"));
+    DDRB &= ~_BV(PB3);
+    read(ss);
+
+    // Stepper: a three axis segment. The first interrupt loads it and programs timer1, the
+    // second one is a plain step and is measured.
+    static const int32_t steps[N_AXIS] = { 1000, 500, 250 };
+    stepper_init();
+    TIMSK0 &= ~(1 << TOIE0); // The pulse reset is measured on its own below
+    st_push_segment(st_push_block(steps), 100, 2000);
+    st_cycle_start();
+    cli();
+    TIMER1_COMPA_vect();
+    bench_timer1_free();
+    t = bench_cycles(TIMER1_COMPA_vect) + BENCH_IRQ;
+#ifdef TIMER1_COMPA_STATIC
+    bench_report(PSTR("stepper_isr"), t, PSTR(BENCH_STR(TIMER1_COMPA_vect)));
+#else
+    bench_report(PSTR("stepper_isr"), t, PSTR(BENCH_STR(TIMER1_COMPA_vect) "+st_step_interrupt"));
+#endif
+    t = bench_cycles(TIMER0_OVF_vect) + BENCH_IRQ;
+#ifdef TIMER0_OVF_STATIC
+    bench_report(PSTR("step_reset_isr"), t, PSTR(BENCH_STR(TIMER0_OVF_vect)));
+#else
+    bench_report(PSTR("step_reset_isr"), t, PSTR(BENCH_STR(TIMER0_OVF_vect) "+st_reset_interrupt"));
+#endif
+    st_reset();
+    bench_timer1_free();
+
+#ifndef TIMER2_OVF_STATIC
+    t = bench_cycles(TIMER2_OVF_vect) + BENCH_IRQ;
+    bench_report(PSTR("timer2_ovf_isr"), t, PSTR(BENCH_STR(TIMER2_OVF_vect)));
+#endif
+
+    printPgmString(PSTR("BENCH,end\r\n"));
+    bench_drain();
+    _delay_loop_2(0); // Let the last byte leave the shift register
+
+    // Sleeping with interrupts off ends a simavr run; on the chip it just stops here.
+    cli();
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    sleep_cpu();
+    for (;;) { }
+}
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef BENCHTEST_H
+#define BENCHTEST_H
+
+// Cycle counts of the driver hot paths, with -DBENCH. See benchtest.c and tools/bench.py.
+void benchTest(void);
+
+#endif
@@ -0,0 +1,174 @@
+/*! \file dds.c \brief Direct digital synthesis waveform generator on timer1/timer2 PWM. */
+//*****************************************************************************
+//
+// File Name	: 'dds.c'
+// Title		: Direct digital synthesis (DDS) waveform generator
+// Author		: flyingyizi
+// Created		: 10/19/2026
+// Revised		:
+// Version		: 1.0
+// Target MCU	: Atmel AVR Series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "dds.h"
+#include "../timerx8/timerx8.h"
+
+#ifdef DDS_USE_TIMER1
+#define DDS_OCR OCR1A
+#define DDS_OVF_INT TIMER1OVERFLOW_INT
+#if defined(TIMER1_OVF_STATIC)
+#define DDS_STATIC_VECT TIMER1_OVF_vect
+#endif
+#else
+#define DDS_OCR OCR2A
+#define DDS_OVF_INT TIMER2OVERFLOW_INT
+#if defined(TIMER2_OVF_STATIC)
+#define DDS_STATIC_VECT TIMER2_OVF_vect
+#endif
+#endif
+
+// 2^48 / (Fs * 1000), used as (mHz * K) >> 16
+#define DDS_MHZ_K ((uint32_t)(281474976710656.0 / (DDS_SAMPLE_RATE * 1000.0) + 0.5))
+
+const uint8_t dds_wave_sine[256] PROGMEM = {
+    128, 131, 134, 137, 140, 144, 147, 150, 153, 156, 159, 162, 165, 168, 171, 174,
+    177, 179, 182, 185, 188, 191, 193, 196, 199, 201, 204, 206, 209, 211, 213, 216,
+    218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 239, 240, 241, 243, 244,
+    245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+    255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+    245, 244, 243, 241, 240, 239, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+    218, 216, 213, 211, 209, 206, 204, 201, 199, 196, 193, 191, 188, 185, 182, 179,
+    177, 174, 171, 168, 165, 162, 159, 156, 153, 150, 147, 144, 140, 137, 134, 131,
+    128, 125, 122, 119, 116, 112, 109, 106, 103, 100,  97,  94,  91,  88,  85,  82,
+     79,  77,  74,  71,  68,  65,  63,  60,  57,  55,  52,  50,  47,  45,  43,  40,
+     38,  36,  34,  32,  30,  28,  26,  24,  22,  21,  19,  17,  16,  15,  13,  12,
+     11,  10,   8,   7,   6,   6,   5,   4,   3,   3,   2,   2,   2,   1,   1,   1,
+      1,   1,   1,   1,   2,   2,   2,   3,   3,   4,   5,   6,   6,   7,   8,  10,
+     11,  12,  13,  15,  16,  17,  19,  21,  22,  24,  26,  28,  30,  32,  34,  36,
+     38,  40,  43,  45,  47,  50,  52,  55,  57,  60,  63,  65,  68,  71,  74,  77,
+     79,  82,  85,  88,  91,  94,  97, 100, 103, 106, 109, 112, 116, 119, 122, 125,
+};
+
+const uint8_t dds_wave_triangle[256] PROGMEM = {
+      0,   2,   4,   6,   8,  10,  12,  14,  16,  18,  20,  22,  24,  26,  28,  30,
+     32,  34,  36,  38,  40,  42,  44,  46,  48,  50,  52,  54,  56,  58,  60,  62,
+     64,  66,  68,  70,  72,  74,  76,  78,  80,  82,  84,  86,  88,  90,  92,  94,
+     96,  98, 100, 102, 104, 106, 108, 110, 112, 114, 116, 118, 120, 122, 124, 126,
+    128, 130, 132, 134, 136, 138, 140, 142, 144, 146, 148, 150, 152, 154, 156, 158,
+    160, 162, 164, 166, 168, 170, 172, 174, 176, 178, 180, 182, 184, 186, 188, 190,
+    192, 194, 196, 198, 200, 202, 204, 206, 208, 210, 212, 214, 216, 218, 220, 222,
+    224, 226, 228, 230, 232, 234, 236, 238, 240, 242, 244, 246, 248, 250, 252, 254,
+    255, 253, 251, 249, 247, 245, 243, 241, 239, 237, 235, 233, 231, 229, 227, 225,
+    223, 221, 219, 217, 215, 213, 211, 209, 207, 205, 203, 201, 199, 197, 195, 193,
+    191, 189, 187, 185, 183, 181, 179, 177, 175, 173, 171, 169, 167, 165, 163, 161,
+    159, 157, 155, 153, 151, 149, 147, 145, 143, 141, 139, 137, 135, 133, 131, 129,
+    127, 125, 123, 121, 119, 117, 115, 113, 111, 109, 107, 105, 103, 101,  99,  97,
+     95,  93,  91,  89,  87,  85,  83,  81,  79,  77,  75,  73,  71,  69,  67,  65,
+     63,  61,  59,  57,  55,  53,  51,  49,  47,  45,  43,  41,  39,  37,  35,  33,
+     31,  29,  27,  25,  23,  21,  19,  17,  15,  13,  11,   9,   7,   5,   3,   1,
+};
+
+// Only the sample routine touches the accumulator; the tuning word and table
+// are written by the main program with interrupts held off.
+static uint32_t dds_phase;
+static uint32_t dds_tuning;
+static const uint8_t *dds_wave = dds_wave_sine;
+
+#ifdef DDS_STATIC_VECT
+ISR(DDS_STATIC_VECT)
+#else
+static void dds_sample(void)
+#endif
+{
+    uint32_t phase = dds_phase + dds_tuning;
+    dds_phase = phase;
+    DDS_OCR = pgm_read_byte(dds_wave + (uint8_t)(phase >> 24));
+}
+
+void dds_set_wave(const uint8_t *table_P)
+{
+    uint8_t sreg = SREG;
+    cli();
+    dds_wave = table_P;
+    SREG = sreg;
+}
+
+void dds_set_tuning(uint32_t tuning)
+{
+    uint8_t sreg = SREG;
+    cli();
+    dds_tuning = tuning;
+    SREG = sreg;
+}
+
+void dds_set_freq_mhz(uint32_t mhz)
+{
+    dds_set_tuning((uint32_t)(((uint64_t)mhz * DDS_MHZ_K) >> 16));
+}
+
+void dds_reset_phase(void)
+{
+    uint8_t sreg = SREG;
+    cli();
+    dds_phase = 0;
+    SREG = sreg;
+}
+
+void dds_init(const uint8_t *table_P)
+{
+    dds_set_wave(table_P);
+    dds_reset_phase();
+
+#ifndef DDS_STATIC_VECT
+    timerAttach(DDS_OVF_INT, dds_sample);
+#endif
+
+#ifdef DDS_USE_TIMER1
+    // OC1A (PB1), non-inverting 8-bit PWM, no prescaling
+    DDRB |= _BV(DDB1);
+    OCR1A = 0x80;
+#ifdef DDS_PHASE_CORRECT
+    TCCR1A = _BV(COM1A1) | _BV(WGM10);              // mode 1
+    TCCR1B = _BV(CS10);
+#else
+    TCCR1A = _BV(COM1A1) | _BV(WGM10);              // mode 5
+    TCCR1B = _BV(WGM12) | _BV(CS10);
+#endif
+    TIFR1 = _BV(TOV1);
+    TIMSK1 |= _BV(TOIE1);
+#else
+    // OC2A (PB3), non-inverting 8-bit PWM, no prescaling
+    DDRB |= _BV(DDB3);
+    OCR2A = 0x80;
+#ifdef DDS_PHASE_CORRECT
+    TCCR2A = _BV(COM2A1) | _BV(WGM20);              // mode 1
+#else
+    TCCR2A = _BV(COM2A1) | _BV(WGM21) | _BV(WGM20); // mode 3
+#endif
+    TCCR2B = TIMERRTC_CLK_DIV1;
+    TIFR2 = _BV(TOV2);
+    TIMSK2 |= _BV(TOIE2);
+#endif
+}
+
+void dds_stop(void)
+{
+#ifdef DDS_USE_TIMER1
+    TIMSK1 &= ~_BV(TOIE1);
+    TCCR1B &= ~TIMER_PRESCALER5_MASK;
+    TCCR1A &= ~(_BV(COM1A1) | _BV(COM1A0));
+#else
+    TIMSK2 &= ~_BV(TOIE2);
+    TCCR2B &= ~TIMERRTC_PRESCALE7_MASK;
+    TCCR2A &= ~(_BV(COM2A1) | _BV(COM2A0));
+#endif
+#ifndef DDS_STATIC_VECT
+    timerDetach(DDS_OVF_INT);
+#endif
+}
@@ -0,0 +1,70 @@
+/*! \file dds.h \brief Direct digital synthesis waveform generator on timer1/timer2 PWM. */
+//*****************************************************************************
+//
+// File Name	: 'dds.h'
+// Title		: Direct digital synthesis (DDS) waveform generator
+// Author		: flyingyizi
+// Created		: 10/19/2026
+// Revised		:
+// Version		: 1.0
+// Target MCU	: Atmel AVR Series
+// Editor Tabs	: 4
+//
+// Notes:	An 8-bit PWM output (OC2A/PB3 by default, OC1A/PB1 with
+//			DDS_USE_TIMER1) runs at the full CPU clock. Its overflow
+//			interrupt adds a 32-bit tuning word to a phase accumulator and
+//			writes the wavetable entry indexed by the top 8 phase bits to the
+//			compare register. Filter the pin with an RC low pass.
+//
+//			sample rate	Fs = F_CPU/256 (fast PWM, 62.5kHz @16MHz)
+//						Fs = F_CPU/510 (DDS_PHASE_CORRECT, 31.4kHz @16MHz)
+//			tuning word	= f * 2^32 / Fs, resolution Fs/2^32 (~15uHz)
+//
+//			Changing the frequency only changes the tuning word, the phase
+//			accumulator keeps running, so there is no phase discontinuity.
+//
+//			By default the sample routine is attached through timerAttach().
+//			For the tightest interrupt define TIMER2_OVF_STATIC (or
+//			TIMER1_OVF_STATIC with DDS_USE_TIMER1) in DEFS: timerx8.c then
+//			leaves the vector alone and dds.c binds it directly.
+//
+//*****************************************************************************
+
+#ifndef DDS_H
+#define DDS_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#ifdef DDS_PHASE_CORRECT
+#define DDS_SAMPLE_RATE (F_CPU / 510.0)
+#else
+#define DDS_SAMPLE_RATE (F_CPU / 256.0)
+#endif
+
+// tuning word for a constant frequency in Hz (folded at compile time)
+#define DDS_TUNING(hz) ((uint32_t)((hz) * 4294967296.0 / DDS_SAMPLE_RATE + 0.5))
+
+// built-in 256 entry wavetables, 8-bit unsigned, in PROGMEM
+extern const uint8_t dds_wave_sine[256] PROGMEM;
+extern const uint8_t dds_wave_triangle[256] PROGMEM;
+
+//! Configure the PWM output pin and timer, start generating with the given table.
+void dds_init(const uint8_t *table_P);
+
+//! Stop the timer and disconnect the output pin.
+void dds_stop(void);
+
+//! Select a wavetable (256 bytes in PROGMEM). Takes effect on the next sample.
+void dds_set_wave(const uint8_t *table_P);
+
+//! Set the raw tuning word, see DDS_TUNING().
+void dds_set_tuning(uint32_t tuning);
+
+//! Set the frequency in millihertz (0 .. Fs/2 * 1000).
+void dds_set_freq_mhz(uint32_t mhz);
+
+//! Restart the waveform at phase 0.
+void dds_reset_phase(void);
+
+#endif
@@ -0,0 +1,55 @@
+//*****************************************************************************
+// File Name	: ddstest.c
+//
+// Title		: example usage of the DDS waveform generator
+// Revision		: 1.0
+// Notes		: put a 1k/100nF RC low pass on OC2A (PB3)
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Revision History:
+// When			Who			Description of change
+// -----------	-----------	-----------------------
+// 19-Oct-2026	flyingyizi		Created the program
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>		   // include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h> // include interrupt support
+
+#include <util/delay.h>
+#include "../serial/serial.h"
+#include "../util/print.h"
+#include <avr/pgmspace.h>
+
+#include "dds.h"
+
+//example
+// int main()
+// {
+//   // Initialize system upon power-up.
+//   serial_init(); // Setup serial baud rate and interrupts
+//   sei();         // Enable interrupts
+//   ddsTest();
+//   return 0;
+// }
+
+// 440Hz sine, then a slow 100Hz..1kHz chirp in 0.5Hz steps, then triangle
+void ddsTest(void)
+{
+    printPgmString(PSTR("\r\n\n\nWelcome to the DDS library test program!\r\n"));
+
+    dds_set_tuning(DDS_TUNING(440));
+    dds_init(dds_wave_sine);
+    _delay_ms(2000);
+
+    uint32_t mhz;
+    for (mhz = 100000UL; mhz <= 1000000UL; mhz += 500)
+    {
+        dds_set_freq_mhz(mhz);  // phase continuous
+        _delay_ms(1);
+    }
+
+    dds_set_wave(dds_wave_triangle);
+    while (1);
+}
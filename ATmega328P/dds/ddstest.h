@@ -0,0 +1,8 @@
+#ifndef DDSTEST_H
+#define DDSTEST_H
+
+#include "dds.h"
+
+void ddsTest(void);
+
+#endif
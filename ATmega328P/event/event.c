@@ -0,0 +1,54 @@
+/*
+  event.c - Lock-free SPSC event queue, consumer side, see event.h
+*/
+
+#include "event.h"
+
+uint8_t event_pop(event_queue_t *q, event_t *e)
+{
+  uint8_t tail = q->tail;
+  if (tail == q->head) { return 0; }
+  EVENT_BARRIER(); // Slot read after head
+  *e = q->buf[tail & q->mask];
+  EVENT_BARRIER();
+  q->tail = tail + 1;
+  return 1;
+}
+
+uint8_t event_pop_many(event_queue_t *q, event_t *out, uint8_t max)
+{
+  uint8_t tail = q->tail;
+  uint8_t n = q->head - tail;
+  uint8_t i;
+  if (n > max) { n = max; }
+  EVENT_BARRIER();
+  for (i = 0; i < n; i++) { out[i] = q->buf[(uint8_t)(tail + i) & q->mask]; }
+  EVENT_BARRIER();
+  q->tail = tail + n;
+  return n;
+}
+
+uint8_t event_dispatch(event_queue_t *q, void (*handler)(const event_t *e), uint8_t max)
+{
+  uint8_t tail = q->tail;
+  uint8_t n = q->head - tail;
+  uint8_t i;
+  if (n > max) { n = max; }
+  EVENT_BARRIER();
+  for (i = 0; i < n; i++) { handler(&q->buf[(uint8_t)(tail + i) & q->mask]); }
+  EVENT_BARRIER();
+  q->tail = tail + n;
+  return n;
+}
+
+uint16_t event_dropped(event_queue_t *q)
+{
+  uint16_t dropped;
+  do { dropped = q->dropped; } while (dropped != q->dropped);
+  return dropped;
+}
+
+void event_flush(event_queue_t *q)
+{
+  q->tail = q->head;
+}
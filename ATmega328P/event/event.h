@@ -0,0 +1,113 @@
+/*
+  event.h - Lock-free single-producer/single-consumer event queue, ISR to main loop
+
+  sys_rt_exec_state carries one bit per request: repeats merge and nothing comes with them.
+  An event queue keeps every occurrence, in order, with a type, an 8 bit and a 16 bit value.
+
+  One producer pushes and one consumer pops, usually an ISR and the main loop. Neither turns
+  interrupts off. The indices are single bytes, which the AVR reads and writes in one
+  instruction, and each is written by one side only: head by the producer, after the event is
+  stored, tail by the consumer, after the event is copied out. Indices run freely over 0..255,
+  so the count is head - tail in 8 bits; the size must be a power of two, at most 128.
+  Several producers (e.g. two ISRs that can nest, or main and an ISR) need a queue each.
+
+  A full queue drops the new event and counts it. peak is the most events ever queued, to
+  size the queue.
+
+  pcint, extint and timerx8 callbacks that push one event are one line each:
+
+    EVENT_QUEUE(inputs, 16);
+    EVENT_CALLBACK(on_int0, &inputs, EV_INT0, 0, TCNT1)       // extint: value = time stamp
+    EVENT_PCINT_CALLBACK(on_pd3, &inputs, EV_PD3, PIND, 0)     // pcint: arg = port state
+    ...
+    extintAttach(EXTINT0, on_int0, EXTINT_EDGE_FALLING);
+    enable_pcinterrupt(register_pcinterrupt(PCINTR19, on_pd3, NULL));
+
+  and the main loop takes them in batches with event_dispatch() or event_pop_many().
+*/
+
+#ifndef event_h
+#define event_h
+#include <avr/io.h>
+
+typedef struct {
+  uint8_t type;   // User defined, e.g. the source
+  uint8_t arg;
+  uint16_t value;
+} event_t;
+
+typedef struct {
+  event_t *buf;
+  uint8_t mask;              // Size - 1
+  volatile uint8_t head;     // Next slot to push, producer only
+  volatile uint8_t tail;     // Next slot to pop, consumer only
+  volatile uint8_t peak;     // Most events queued, producer only
+  volatile uint16_t dropped; // Events lost to a full queue, producer only
+} event_queue_t;
+
+// Keeps the compiler from moving slot accesses across the index update that hands the slot
+// over. The AVR itself does not reorder memory accesses.
+#define EVENT_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+// Defines queue name with size events, empty.
+#define EVENT_QUEUE(name, size) \
+  _Static_assert((size) >= 2 && (size) <= 128 && !((size) & ((size) - 1)), \
+                 "event queue size must be a power of two, 2 to 128"); \
+  static event_t name##_buf[size]; \
+  event_queue_t name = { name##_buf, (size) - 1, 0, 0, 0, 0 }
+
+// Defines void name(void), an extint or timerx8 callback pushing { type, arg, value }. arg
+// and value are evaluated in the ISR, e.g. a pin register or a timer count.
+#define EVENT_CALLBACK(name, q, type, arg, value) \
+  void name(void) { event_push((q), (type), (arg), (value)); }
+
+// Same for a pcint callback, void name(void *param). The parameter is not used.
+#define EVENT_PCINT_CALLBACK(name, q, type, arg, value) \
+  void name(void *param) { event_push((q), (type), (arg), (value)); }
+
+// Appends an event. Producer side. Returns 0 when the queue was full and the event dropped.
+static inline uint8_t event_push(event_queue_t *q, uint8_t type, uint8_t arg, uint16_t value)
+{
+  uint8_t head = q->head;
+  uint8_t count = head - q->tail;
+  if (count > q->mask)
+  {
+    q->dropped++;
+    return 0;
+  }
+  event_t *e = &q->buf[head & q->mask];
+  e->type = type;
+  e->arg = arg;
+  e->value = value;
+  EVENT_BARRIER();
+  q->head = head + 1;
+  if (count >= q->peak) { q->peak = count + 1; }
+  return 1;
+}
+
+// Takes the oldest event into e. Consumer side. Returns 0 when the queue is empty.
+uint8_t event_pop(event_queue_t *q, event_t *e);
+
+// Takes up to max events into out, oldest first, and frees their slots at once. Consumer
+// side. Returns the number taken.
+uint8_t event_pop_many(event_queue_t *q, event_t *out, uint8_t max);
+
+// Calls handler for up to max queued events, oldest first, in place, and frees their slots
+// after the last call. Consumer side. Events pushed meanwhile wait for the next call. Returns
+// the number handled.
+uint8_t event_dispatch(event_queue_t *q, void (*handler)(const event_t *e), uint8_t max);
+
+// Events queued now. Either side.
+static inline uint8_t event_count(event_queue_t *q)
+{
+  return (uint8_t)(q->head - q->tail);
+}
+
+// Events dropped so far. Consumer side: the 16 bit count is read until two reads agree, as
+// the producer may update it in between.
+uint16_t event_dropped(event_queue_t *q);
+
+// Empties the queue. Consumer side, or with the producer stopped.
+void event_flush(event_queue_t *q);
+
+#endif
@@ -0,0 +1,95 @@
+//*****************************************************************************
+// File Name	: eventtest.c
+//
+// Title		: example usage of the event queue with pcint, extint and timerx8
+// Revision		: 1.0
+// Notes		: INT0 (PD2) and PCINT19 (PD3) edges and the timer1 overflow push
+//				  events from their callbacks; the main loop drains them in batches.
+//				  Edges are time stamped with TCNT1 at clk/64, 4 us per count.
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Revision History:
+// When			Who			Description of change
+// -----------	-----------	-----------------------
+// 19-Oct-2026	flyingyizi		Created the program
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>			// include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h>	// include interrupt support
+#include <avr/pgmspace.h>
+
+#include "../serial/serial.h"
+#include "../util/print.h"
+#include "../extint/extint.h"
+#include "../pcint/pcint.h"
+#include "../timerx8/timerx8.h"
+
+#include "event.h"
+
+//example
+// int main()
+// {
+//   // Initialize system upon power-up.
+//   serial_init(); // Setup serial baud rate and interrupts
+//   sei();         // Enable interrupts
+//   eventTest();
+//   return 0;
+// }
+
+enum { EV_INT0, EV_PD3, EV_TICK };
+
+EVENT_QUEUE(inputs, 16);
+
+// One line per callback: the event and what the ISR samples for it.
+EVENT_CALLBACK(on_int0, &inputs, EV_INT0, 0, TCNT1)
+EVENT_PCINT_CALLBACK(on_pd3, &inputs, EV_PD3, PIND & _BV(PIND3), TCNT1)
+EVENT_CALLBACK(on_tick, &inputs, EV_TICK, 0, 0)
+
+static uint16_t edges[2];
+static uint8_t ticks;
+
+static void handle(const event_t *e)
+{
+	switch (e->type)
+	{
+		case EV_INT0:
+			edges[0]++;
+			printPgmFormat(PSTR("INT0 falling at %u\r\n"), e->value);
+			break;
+		case EV_PD3:
+			edges[1]++;
+			printPgmFormat(PSTR("PD3 %S at %u\r\n"), e->arg ? PSTR("rising") : PSTR("falling"), e->value);
+			break;
+		case EV_TICK:
+			ticks++;
+			break;
+	}
+}
+
+void eventTest(void)
+{
+	printPgmString(PSTR("\r\n\n\nWelcome to the event queue test program!\r\n"));
+
+	printPgmString(PSTR("Attaching INT0, PCINT19 and timer1 overflow callbacks\r\n"));
+	PORTD |= _BV(PORTD2) | _BV(PORTD3); // pullup-input
+	extintInit();
+	extintAttach(EXTINT0, on_int0, EXTINT_EDGE_FALLING);
+	enable_pcinterrupt(register_pcinterrupt(PCINTR19, on_pd3, NULL));
+	timer1OVFInit(0); // clk/64, overflow every 262 ms
+	timerAttach(TIMER1OVERFLOW_INT, on_tick);
+
+	while (1)
+	{
+		// A batch at a time, so a burst of edges can not starve the rest of the loop
+		event_dispatch(&inputs, handle, 4);
+
+		if (ticks >= 4)
+		{
+			ticks = 0;
+			printPgmFormat(PSTR("[EV:int0=%u,pd3=%u,peak=%u,dropped=%u]\r\n"),
+						   edges[0], edges[1], inputs.peak, event_dropped(&inputs));
+		}
+	}
+}
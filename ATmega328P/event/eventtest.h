@@ -0,0 +1,8 @@
+#ifndef EVENTTEST_H
+#define EVENTTEST_H
+
+#include "event.h"
+
+void eventTest(void);
+
+#endif
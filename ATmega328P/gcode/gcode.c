@@ -0,0 +1,400 @@
+/*
+  gcode.c - rs274/ngc parser.
+  Part of Grbl
+
+  Copyright (c) 2011-2015 Sungeun K. Jeon
+  Copyright (c) 2009-2011 Simen Svale Skogsrud
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <avr/interrupt.h>
+#include "gcode.h"
+#include "../planner/planner.h"
+#include "../util/report.h"
+#include "../util/fixed.h"
+
+// Feed rate handed to the planner for G0. The planner clamps it to the axis maximum rates.
+#define SEEK_FEED_RATE 1.0E+38
+
+// Largest fixed point magnitude before the next digit overflows 31 bits.
+#define FIXED_DIGIT_LIMIT ((0x7FFFFFFFUL-9)/10)
+
+parser_state_t gc_state;
+static parser_block_t gc_block;
+
+
+void gc_init()
+{
+  memset(&gc_state, 0, sizeof(gc_state));
+}
+
+
+// Sets g-code parser position in mm. Input in steps. Called by the system abort and hard
+// limit pull-off routines. Scaled by the parser units per step in Q12.20, integer only.
+void gc_sync_position()
+{
+  static const int32_t units_per_step[N_AXIS] PROGMEM = {
+    FIXED_CONST(GC_FIXED_ONE/DEFAULT_X_STEPS_PER_MM, 20),
+    FIXED_CONST(GC_FIXED_ONE/DEFAULT_Y_STEPS_PER_MM, 20),
+    FIXED_CONST(GC_FIXED_ONE/DEFAULT_Z_STEPS_PER_MM, 20) };
+  int32_t steps[N_AXIS];
+  uint8_t idx;
+  st_get_position(steps);
+  for (idx=0; idx<N_AXIS; idx++) {
+    gc_state.position[idx] = fixed_mul(steps[idx], pgm_read_dword(&units_per_step[idx]), 20);
+  }
+}
+
+
+// Reads a signed decimal number at line[*char_counter] into fixed point with GC_FIXED_DECIMALS
+// fraction digits, and advances char_counter past it. Integer arithmetic only: the digits are
+// accumulated as one integer and the missing fraction digits are made up by multiplying by ten.
+static uint8_t read_fixed(const char *line, uint8_t *char_counter, gc_fixed_t *value)
+{
+  const char *ptr = line + *char_counter;
+  uint32_t intval = 0;
+  uint8_t isnegative = 0;
+  uint8_t ndigit = 0;
+  uint8_t isdecimal = 0;
+  uint8_t frac_digits = 0;
+  uint8_t round_up = 0;
+  uint8_t c = *ptr++;
+
+  // Capture initial positive/minus character
+  if (c == '-') {
+    isnegative = 1;
+    c = *ptr++;
+  } else if (c == '+') {
+    c = *ptr++;
+  }
+
+  for (;;) {
+    c -= '0';
+    if (c <= 9) {
+      ndigit++;
+      if (frac_digits < GC_FIXED_DECIMALS) {
+        if (intval > FIXED_DIGIT_LIMIT) { return(STATUS_BAD_NUMBER_FORMAT); }
+        intval = 10*intval + c;
+        if (isdecimal) { frac_digits++; }
+      } else if (frac_digits == GC_FIXED_DECIMALS) {
+        round_up = (c >= 5); // First dropped digit rounds, the rest is ignored.
+        frac_digits++;
+      }
+    } else if (c == (uint8_t)('.'-'0') && !isdecimal) {
+      isdecimal = 1;
+    } else {
+      break;
+    }
+    c = *ptr++;
+  }
+
+  // Return if no digits have been read.
+  if (!ndigit) { return(STATUS_BAD_NUMBER_FORMAT); }
+
+  while (frac_digits < GC_FIXED_DECIMALS) {
+    if (intval > FIXED_DIGIT_LIMIT) { return(STATUS_BAD_NUMBER_FORMAT); }
+    intval *= 10;
+    frac_digits++;
+  }
+  intval += round_up;
+
+  *value = isnegative ? -(int32_t)intval : (int32_t)intval;
+  *char_counter = ptr - line - 1; // Set char_counter to next statement
+  return(STATUS_OK);
+}
+
+
+// Reads an unsigned integer command value (G/M code, line number, tool) with an optional one
+// digit mantissa, e.g. "92.1". Trailing zeros after the mantissa are accepted, other digits are not.
+static uint8_t read_code(const char *line, uint8_t *char_counter, uint32_t *int_value, uint8_t *mantissa)
+{
+  const char *ptr = line + *char_counter;
+  uint32_t intval = 0;
+  uint8_t ndigit = 0;
+  uint8_t c = *ptr++ - '0';
+
+  while (c <= 9) {
+    if (intval > FIXED_DIGIT_LIMIT) { return(STATUS_BAD_NUMBER_FORMAT); }
+    intval = 10*intval + c;
+    ndigit++;
+    c = *ptr++ - '0';
+  }
+  *mantissa = 0;
+  if (c == (uint8_t)('.'-'0')) {
+    c = *ptr++ - '0';
+    if (c <= 9) {
+      *mantissa = c;
+      ndigit++;
+      while ((c = *ptr++ - '0') <= 9) {
+        if (c) { return(STATUS_GCODE_COMMAND_VALUE_NOT_INTEGER); }
+      }
+    }
+  }
+
+  if (!ndigit) { return(STATUS_BAD_NUMBER_FORMAT); }
+  *int_value = intval;
+  *char_counter = ptr - line - 1;
+  return(STATUS_OK);
+}
+
+
+// Converts a value given in 0.001 inch to um, rounded to nearest.
+static uint8_t inches_to_mm(gc_fixed_t *value)
+{
+  gc_fixed_t v = *value;
+  if (v > 0x7FFFFFFFL/127 || v < -(0x7FFFFFFFL/127)) { return(STATUS_BAD_NUMBER_FORMAT); }
+  v *= 127;
+  *value = (v + (v < 0 ? -2 : 2))/5; // 25.4 = 127/5
+  return(STATUS_OK);
+}
+
+
+/* Parses one line of pre-filtered g-code in a single pass. Every word is validated as it is
+   read: modal group and word repetition are checked against the command_groups and words
+   bitmasks, so no second scan over the line is needed. Semantic checks that depend on the whole
+   line (axis command conflicts, missing feed rate) are left to gc_execute_line(). */
+uint8_t gc_parse_line(char *line, parser_block_t *block)
+{
+  uint8_t char_counter = 0;
+  uint8_t letter;
+  uint8_t status;
+  uint8_t mantissa;
+  uint8_t group_bit;
+  uint8_t word_bit;
+  uint32_t int_value;
+  gc_fixed_t value;
+
+  memcpy(&block->modal, &gc_state.modal, sizeof(gc_modal_t)); // Copy current modes
+  block->non_modal_command = NON_MODAL_NO_ACTION;
+  block->command_groups = 0;
+  block->words = 0;
+
+  while ((letter = line[char_counter]) != 0) {
+
+    // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
+    if ((letter < 'A') || (letter > 'Z')) { return(STATUS_EXPECTED_COMMAND_LETTER); } // [Expected word letter]
+    char_counter++;
+
+    if (letter == 'G' || letter == 'M') {
+      status = read_code(line, &char_counter, &int_value, &mantissa);
+      if (status) { return(status); }
+      if (int_value > 255) { return(STATUS_GCODE_UNSUPPORTED_COMMAND); }
+
+      if (letter == 'G') {
+        // Set modal group values. Mantissa only allowed for G92.1.
+        if (mantissa && !(int_value == 92 && mantissa == 1)) { return(STATUS_GCODE_UNSUPPORTED_COMMAND); }
+        switch((uint8_t)int_value) {
+          case 53: case 92:
+            group_bit = MODAL_GROUP_G0;
+            if (int_value == 53) { block->non_modal_command = NON_MODAL_ABSOLUTE_OVERRIDE; }
+            else if (mantissa) { block->non_modal_command = NON_MODAL_RESET_COORDINATE_OFFSET; }
+            else { block->non_modal_command = NON_MODAL_SET_COORDINATE_OFFSET; }
+            break;
+          case 0: block->modal.motion = MOTION_MODE_SEEK; group_bit = MODAL_GROUP_G1; break;
+          case 1: block->modal.motion = MOTION_MODE_LINEAR; group_bit = MODAL_GROUP_G1; break;
+          case 80: block->modal.motion = MOTION_MODE_NONE; group_bit = MODAL_GROUP_G1; break;
+          case 17: block->modal.plane_select = PLANE_SELECT_XY; group_bit = MODAL_GROUP_G2; break;
+          case 18: block->modal.plane_select = PLANE_SELECT_ZX; group_bit = MODAL_GROUP_G2; break;
+          case 19: block->modal.plane_select = PLANE_SELECT_YZ; group_bit = MODAL_GROUP_G2; break;
+          case 90: block->modal.distance = DISTANCE_MODE_ABSOLUTE; group_bit = MODAL_GROUP_G3; break;
+          case 91: block->modal.distance = DISTANCE_MODE_INCREMENTAL; group_bit = MODAL_GROUP_G3; break;
+          case 94: block->modal.feed_rate = FEED_RATE_MODE_UNITS_PER_MIN; group_bit = MODAL_GROUP_G5; break;
+          case 20: block->modal.units = UNITS_MODE_INCHES; group_bit = MODAL_GROUP_G6; break;
+          case 21: block->modal.units = UNITS_MODE_MM; group_bit = MODAL_GROUP_G6; break;
+          default: return(STATUS_GCODE_UNSUPPORTED_COMMAND); // [Unsupported G command]
+        }
+      } else {
+        if (mantissa) { return(STATUS_GCODE_COMMAND_VALUE_NOT_INTEGER); }
+        switch((uint8_t)int_value) {
+          case 0: case 1: block->modal.program_flow = PROGRAM_FLOW_PAUSED; group_bit = MODAL_GROUP_M4; break;
+          case 2: case 30: block->modal.program_flow = PROGRAM_FLOW_COMPLETED; group_bit = MODAL_GROUP_M4; break;
+          case 3: block->modal.spindle = SPINDLE_ENABLE_CW; group_bit = MODAL_GROUP_M7; break;
+          case 4: block->modal.spindle = SPINDLE_ENABLE_CCW; group_bit = MODAL_GROUP_M7; break;
+          case 5: block->modal.spindle = SPINDLE_DISABLE; group_bit = MODAL_GROUP_M7; break;
+          case 7: block->modal.coolant = COOLANT_MIST_ENABLE; group_bit = MODAL_GROUP_M8; break;
+          case 8: block->modal.coolant = COOLANT_FLOOD_ENABLE; group_bit = MODAL_GROUP_M8; break;
+          case 9: block->modal.coolant = COOLANT_DISABLE; group_bit = MODAL_GROUP_M8; break;
+          default: return(STATUS_GCODE_UNSUPPORTED_COMMAND); // [Unsupported M command]
+        }
+      }
+
+      // Check for more than one command per modal group violations in the current block
+      // NOTE: Variable 'group_bit' is assigned when the command is valid.
+      if (bit_istrue(block->command_groups,bit(group_bit))) { return(STATUS_GCODE_MODAL_GROUP_VIOLATION); }
+      block->command_groups |= bit(group_bit);
+
+    } else {
+
+      // Non-command words. N and T are integers, everything else is fixed point.
+      switch(letter){
+        case 'N': case 'T':
+          status = read_code(line, &char_counter, &int_value, &mantissa);
+          if (status) { return(status); }
+          if (mantissa) { return(STATUS_GCODE_COMMAND_VALUE_NOT_INTEGER); }
+          if (letter == 'N') {
+            if (int_value > 9999999) { return(STATUS_GCODE_INVALID_LINE_NUMBER); } // [Max N exceeded]
+            block->values.n = int_value; word_bit = WORD_N;
+          } else {
+            if (int_value > 255) { return(STATUS_GCODE_UNSUPPORTED_COMMAND); }
+            block->values.t = int_value; word_bit = WORD_T;
+          }
+          break;
+        case 'F': case 'S': case 'X': case 'Y': case 'Z':
+          status = read_fixed(line, &char_counter, &value);
+          if (status) { return(status); }
+          switch(letter) {
+            case 'F': word_bit = WORD_F; block->values.f = value; break;
+            case 'S': word_bit = WORD_S; block->values.s = value; break;
+            case 'X': word_bit = WORD_X; block->values.xyz[X_AXIS] = value; break;
+            case 'Y': word_bit = WORD_Y; block->values.xyz[Y_AXIS] = value; break;
+            default:  word_bit = WORD_Z; block->values.xyz[Z_AXIS] = value; break;
+          }
+          // Check for value words that must not be negative.
+          if (value < 0 && (word_bit == WORD_F || word_bit == WORD_S)) { return(STATUS_NEGATIVE_VALUE); }
+          break;
+        default: return(STATUS_GCODE_UNSUPPORTED_COMMAND);
+      }
+
+      // NOTE: Variable 'word_bit' is always assigned, if the non-command letter is valid.
+      if (bit_istrue(block->words,bit(word_bit))) { return(STATUS_GCODE_WORD_REPEATED); } // [Word repeated]
+      block->words |= bit(word_bit);
+    }
+  }
+  return(STATUS_OK);
+}
+
+
+/* Executes one line of 0-terminated G-Code. The line is assumed to contain only uppercase
+   characters and signed decimal values (no whitespace). Comments and block delete
+   characters have been removed. In this function, all units and positions are converted and
+   exported to grbl's internal functions in terms of (mm, mm/min) and absolute machine
+   coordinates, respectively. The only floating point work left per line is the final
+   conversion of the target for the planner. */
+uint8_t gc_execute_line(char *line)
+{
+  uint8_t status = gc_parse_line(line, &gc_block);
+  if (status) { return(status); }
+
+  uint8_t idx;
+  uint8_t axis_words = gc_block.words & AXIS_WORDS_MASK;
+
+  // [Unit conversion]: Everything below works in mm and mm/min.
+  if (gc_block.modal.units == UNITS_MODE_INCHES) {
+    for (idx=0; idx<N_AXIS; idx++) {
+      if (bit_istrue(axis_words,bit((WORD_X+idx)))) {
+        status = inches_to_mm(&gc_block.values.xyz[idx]);
+        if (status) { return(status); }
+      }
+    }
+    if (bit_istrue(gc_block.words,bit(WORD_F))) {
+      status = inches_to_mm(&gc_block.values.f);
+      if (status) { return(status); }
+    }
+  }
+
+  // [Axis word users]: G92 and the motion modes both consume the axis words. Only one may.
+  if (gc_block.non_modal_command == NON_MODAL_SET_COORDINATE_OFFSET) {
+    if (bit_istrue(gc_block.command_groups,bit(MODAL_GROUP_G1))) { return(STATUS_GCODE_AXIS_COMMAND_CONFLICT); }
+    if (!axis_words) { return(STATUS_GCODE_NO_AXIS_WORDS); } // [No axis words]
+  } else if (axis_words) {
+    if (gc_block.modal.motion == MOTION_MODE_NONE) { return(STATUS_GCODE_AXIS_WORDS_EXIST); } // [No axis words allowed]
+  }
+
+  // [G53 errors]: Only valid with a G0 or G1 motion mode on the same line.
+  if (gc_block.non_modal_command == NON_MODAL_ABSOLUTE_OVERRIDE) {
+    if (gc_block.modal.motion == MOTION_MODE_NONE) { return(STATUS_GCODE_G53_INVALID_MOTION_MODE); }
+  }
+
+  // [Feed rate]: A G1 move needs a feed rate, from this line or an earlier one.
+  if (bit_isfalse(gc_block.words,bit(WORD_F))) { gc_block.values.f = gc_state.feed_rate; }
+  if (axis_words && gc_block.modal.motion == MOTION_MODE_LINEAR && gc_block.values.f == 0) {
+    return(STATUS_GCODE_UNDEFINED_FEED_RATE); // [Feed rate undefined]
+  }
+
+  /* -------------------------------------------------------------------------------------
+     STEP 4: EXECUTE!!
+     Assumes that all error-checking has been completed and no failure modes exist. We just
+     need to update the state and execute the block according to the order-of-execution.
+  */
+
+  // [0. Non-specific/common error-checks and miscellaneous setup]: Line number, feed, spindle, tool.
+  if (bit_istrue(gc_block.words,bit(WORD_N))) { gc_state.line_number = gc_block.values.n; }
+  gc_state.feed_rate = gc_block.values.f;
+  if (bit_istrue(gc_block.words,bit(WORD_S))) { gc_state.spindle_speed = gc_block.values.s; }
+  if (bit_istrue(gc_block.words,bit(WORD_T))) { gc_state.tool = gc_block.values.t; }
+
+  // [Spindle, coolant, plane, units, distance, feed mode]: State only, there is no hardware for
+  // spindle and coolant yet.
+  memcpy(&gc_state.modal, &gc_block.modal, sizeof(gc_modal_t));
+  gc_state.modal.program_flow = PROGRAM_FLOW_RUNNING;
+
+  // [Coordinate offset]: G92 makes the current position read as the given axis values.
+  int32_t target[N_AXIS];
+  if (gc_block.non_modal_command == NON_MODAL_SET_COORDINATE_OFFSET) {
+    for (idx=0; idx<N_AXIS; idx++) {
+      if (bit_istrue(axis_words,bit((WORD_X+idx)))) {
+        gc_state.coord_offset[idx] = gc_state.position[idx] - gc_block.values.xyz[idx];
+      }
+    }
+  } else if (gc_block.non_modal_command == NON_MODAL_RESET_COORDINATE_OFFSET) {
+    memset(gc_state.coord_offset, 0, sizeof(gc_state.coord_offset));
+  }
+
+  // [Motion]: G0/G1 with axis words. Targets stay in fixed point until handed to the planner.
+  if (axis_words && gc_block.non_modal_command != NON_MODAL_SET_COORDINATE_OFFSET) {
+    float target_mm[N_AXIS];
+    for (idx=0; idx<N_AXIS; idx++) {
+      if (bit_isfalse(axis_words,bit((WORD_X+idx)))) {
+        target[idx] = gc_state.position[idx];
+      } else if (gc_block.non_modal_command == NON_MODAL_ABSOLUTE_OVERRIDE) {
+        target[idx] = gc_block.values.xyz[idx]; // G53 is always absolute machine coordinates.
+      } else if (gc_block.modal.distance == DISTANCE_MODE_INCREMENTAL) {
+        target[idx] = gc_state.position[idx] + gc_block.values.xyz[idx];
+      } else {
+        target[idx] = gc_block.values.xyz[idx] + gc_state.coord_offset[idx];
+      }
+      target_mm[idx] = target[idx]*(1.0/GC_FIXED_ONE);
+    }
+    if (gc_block.modal.motion == MOTION_MODE_SEEK) {
+      mc_line(target_mm, SEEK_FEED_RATE);
+    } else {
+      mc_line(target_mm, gc_state.feed_rate*(1.0/GC_FIXED_ONE));
+    }
+    memcpy(gc_state.position, target, sizeof(target)); // gc_state.position[] = target[];
+  }
+
+  // [Program flow]: M0/M1 pause once the queued motion is done. M2/M30 also reset the modes.
+  if (gc_block.modal.program_flow) {
+    protocol_buffer_synchronize(); // Sync and finish all remaining buffered motions before moving on.
+    if (gc_block.modal.program_flow == PROGRAM_FLOW_PAUSED) {
+      protocol_program_pause(); // Hold the following lines until cycle start.
+    } else {
+      // Upon program complete, only a subset of g-codes reset to certain defaults, according to
+      // LinuxCNC's program end descriptions and testing. Only modal groups [G-code 1,2,3,5,7,12]
+      // and [M-code 7,8,9] reset to [G1,G17,G90,G94,G40,G54,M5,M9,M48]. The remaining modal groups
+      // [G-code 4,6,8,10,13,14,15] and [M-code 4,5,6] and the modal words [F,S,T,H] do not reset.
+      gc_state.modal.motion = MOTION_MODE_LINEAR;
+      gc_state.modal.plane_select = PLANE_SELECT_XY;
+      gc_state.modal.distance = DISTANCE_MODE_ABSOLUTE;
+      gc_state.modal.feed_rate = FEED_RATE_MODE_UNITS_PER_MIN;
+      gc_state.modal.spindle = SPINDLE_DISABLE;
+      gc_state.modal.coolant = COOLANT_DISABLE;
+      memset(gc_state.coord_offset, 0, sizeof(gc_state.coord_offset));
+    }
+  }
+
+  return(STATUS_OK);
+}
@@ -0,0 +1,169 @@
+/*
+  gcode.h - rs274/ngc parser.
+  Part of Grbl
+
+  Copyright (c) 2011-2015 Sungeun K. Jeon
+  Copyright (c) 2009-2011 Simen Svale Skogsrud
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef gcode_h
+#define gcode_h
+#include <avr/io.h>
+#include "../serial/serial.h"
+#include "../stepper/stepper.h"
+
+// All values are parsed straight into scaled 32-bit fixed point, so no soft-float code runs
+// per word. With 3 decimals the unit is 1um (or 0.001 inch / 0.001 mm/min) and the range is
+// +/-2147483.647. Digits past the last decimal are rounded into it.
+#define GC_FIXED_DECIMALS 3
+#define GC_FIXED_ONE 1000L
+typedef int32_t gc_fixed_t;
+
+// Define modal group internal numbers for checking multiple command violations and tracking the
+// type of command that is called in the block. A modal group is a group of g-code commands that are
+// mutually exclusive, or cannot exist on the same line, because they each toggle a state or execute
+// a unique motion. These are defined in the NIST RS274-NGC v3 g-code standard, available online,
+// and are similar/identical to other g-code interpreters by manufacturers (Haas,Fanuc,Mazak,etc).
+// NOTE: Modal group define values must be sequential and starting from zero.
+#define MODAL_GROUP_G0 0 // [G53,G92,G92.1] Non-modal
+#define MODAL_GROUP_G1 1 // [G0,G1,G80] Motion
+#define MODAL_GROUP_G2 2 // [G17,G18,G19] Plane selection
+#define MODAL_GROUP_G3 3 // [G90,G91] Distance mode
+#define MODAL_GROUP_G5 4 // [G94] Feed rate mode
+#define MODAL_GROUP_G6 5 // [G20,G21] Units
+#define MODAL_GROUP_M4 6 // [M0,M1,M2,M30] Stopping
+#define MODAL_GROUP_M7 7 // [M3,M4,M5] Spindle turning
+#define MODAL_GROUP_M8 8 // [M7,M8,M9] Coolant control
+
+// Define command actions for within execution-type modal groups (motion, stopping, non-modal). Used
+// internally by the parser to know which command to execute.
+
+// Modal Group G0: Non-modal actions
+#define NON_MODAL_NO_ACTION 0 // (Default: Must be zero)
+#define NON_MODAL_ABSOLUTE_OVERRIDE 1 // G53
+#define NON_MODAL_SET_COORDINATE_OFFSET 2 // G92
+#define NON_MODAL_RESET_COORDINATE_OFFSET 3 // G92.1
+
+// Modal Group G1: Motion modes
+#define MOTION_MODE_SEEK 0 // G0 (Default: Must be zero)
+#define MOTION_MODE_LINEAR 1 // G1
+#define MOTION_MODE_NONE 2 // G80
+
+// Modal Group G2: Plane select
+#define PLANE_SELECT_XY 0 // G17 (Default: Must be zero)
+#define PLANE_SELECT_ZX 1 // G18
+#define PLANE_SELECT_YZ 2 // G19
+
+// Modal Group G3: Distance mode
+#define DISTANCE_MODE_ABSOLUTE 0 // G90 (Default: Must be zero)
+#define DISTANCE_MODE_INCREMENTAL 1 // G91
+
+// Modal Group G5: Feed rate mode
+#define FEED_RATE_MODE_UNITS_PER_MIN 0 // G94 (Default: Must be zero)
+
+// Modal Group G6: Units mode
+#define UNITS_MODE_MM 0 // G21 (Default: Must be zero)
+#define UNITS_MODE_INCHES 1 // G20
+
+// Modal Group M4: Program flow
+#define PROGRAM_FLOW_RUNNING 0 // (Default: Must be zero)
+#define PROGRAM_FLOW_PAUSED 1 // M0, M1
+#define PROGRAM_FLOW_COMPLETED 2 // M2, M30
+
+// Modal Group M7: Spindle control
+#define SPINDLE_DISABLE 0 // M5 (Default: Must be zero)
+#define SPINDLE_ENABLE_CW 1 // M3
+#define SPINDLE_ENABLE_CCW 2 // M4
+
+// Modal Group M8: Coolant control
+#define COOLANT_DISABLE 0 // M9 (Default: Must be zero)
+#define COOLANT_MIST_ENABLE 1 // M7
+#define COOLANT_FLOOD_ENABLE 2 // M8
+
+// Define parameter word mapping. Bit index in parser_block_t.words.
+#define WORD_F  0
+#define WORD_N  1
+#define WORD_S  2
+#define WORD_T  3
+#define WORD_X  4
+#define WORD_Y  5
+#define WORD_Z  6
+#define AXIS_WORDS_MASK (bit(WORD_X)|bit(WORD_Y)|bit(WORD_Z))
+
+// NOTE: When this struct is zeroed, the above defines set the defaults for the system.
+typedef struct {
+  uint8_t motion;          // {G0,G1,G80}
+  uint8_t feed_rate;       // {G94}
+  uint8_t units;           // {G20,G21}
+  uint8_t distance;        // {G90,G91}
+  uint8_t plane_select;    // {G17,G18,G19}
+  uint8_t program_flow;    // {M0,M1,M2,M30}
+  uint8_t coolant;         // {M7,M8,M9}
+  uint8_t spindle;         // {M3,M4,M5}
+} gc_modal_t;
+
+typedef struct {
+  gc_fixed_t f;            // Feed
+  int32_t n;               // Line number
+  gc_fixed_t s;            // Spindle speed
+  uint8_t t;               // Tool selection
+  gc_fixed_t xyz[N_AXIS];  // X,Y,Z Translational axes
+} gc_values_t;
+
+// Compact result of parsing one line. Only the groups flagged in command_groups and the
+// words flagged in words are valid, the rest is left over from earlier lines.
+typedef struct {
+  uint8_t non_modal_command;
+  uint16_t command_groups; // Modal groups set on this line. Bit index MODAL_GROUP_*.
+  uint16_t words;          // Value words set on this line. Bit index WORD_*.
+  gc_modal_t modal;
+  gc_values_t values;
+} parser_block_t;
+
+typedef struct {
+  gc_modal_t modal;
+
+  gc_fixed_t spindle_speed;          // RPM
+  gc_fixed_t feed_rate;              // Millimeters/min
+  uint8_t tool;                      // Tracks tool number. NOT USED.
+  int32_t line_number;               // Last line number sent
+
+  gc_fixed_t position[N_AXIS];       // Where the interpreter considers the tool to be at this point in the code
+  gc_fixed_t coord_offset[N_AXIS];   // Retains the G92 coordinate offset (work coordinates) relative to
+                                     // machine zero in mm. Non-persistent. Cleared upon reset and boot.
+} parser_state_t;
+extern parser_state_t gc_state;
+
+
+// Initialize the parser
+void gc_init();
+
+// Parse one pre-filtered block of g-code (no spaces or comments, upper case) into a
+// parser_block_t in a single pass. Returns a STATUS_* code from report.h.
+uint8_t gc_parse_line(char *line, parser_block_t *gc_block);
+
+// Parse and execute one block of g-code. Returns a STATUS_* code from report.h.
+uint8_t gc_execute_line(char *line);
+
+// Set g-code parser position. Input in steps.
+void gc_sync_position();
+
+// Implemented by the main program (main.c).
+void mc_line(float *target, float feed_rate);
+void protocol_buffer_synchronize();
+void protocol_program_pause();
+
+#endif
@@ -0,0 +1,34 @@
+/* avr/interrupt.h - Interrupts for the host build
+
+  ISR(x_vect) defines a plain function __vector_<n>, which host/hostio.c calls when the
+  interrupt is enabled, its flag is set and SREG_I is set, like the vector table would.
+  sei() takes the pending interrupts right away; cli() only clears SREG_I. ISR attributes are
+  accepted and ignored: an ISR runs with SREG_I clear and returns with it set, unless it sets
+  it itself.
+*/
+
+#ifndef _HOST_AVR_INTERRUPT_H_
+#define _HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+#include "../hostio.h"
+
+#define sei() host_sei()
+#define cli() ((void)(SREG &= (uint8_t)~_BV(SREG_I)))
+#define reti() return
+
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+#define ISR_FLATTEN
+#define ISR_NOICF
+#define ISR_ALIASOF(v)
+
+#define ISR(vector, ...) void vector(void); void vector(void)
+#define SIGNAL(vector) ISR(vector)
+#define EMPTY_INTERRUPT(vector) void vector(void); void vector(void) { }
+#define ISR_ALIAS(vector, target) void vector(void); void vector(void) { target(); }
+
+#define BADISR_vect __vector_default
+
+#endif
@@ -0,0 +1,44 @@
+/* avr/pgmspace.h - Program memory access for the host build
+
+  There is one address space on the host: PROGMEM data stays in the data section and the
+  pgm_read_*() macros are plain loads.
+*/
+
+#ifndef _HOST_AVR_PGMSPACE_H_
+#define _HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PGM_VOID_P const void *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr)       (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)       (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)      (*(const uint32_t *)(addr))
+#define pgm_read_float(addr)      (*(const float *)(addr))
+#define pgm_read_ptr(addr)        (*(void * const *)(addr))
+#define pgm_read_byte_near(addr)  pgm_read_byte(addr)
+#define pgm_read_word_near(addr)  pgm_read_word(addr)
+#define pgm_read_dword_near(addr) pgm_read_dword(addr)
+#define pgm_read_byte_far(addr)   pgm_read_byte(addr)
+#define pgm_read_word_far(addr)   pgm_read_word(addr)
+
+#define memcpy_P  memcpy
+#define memcmp_P  memcmp
+#define strlen_P  strlen
+#define strcpy_P  strcpy
+#define strncpy_P strncpy
+#define strcmp_P  strcmp
+#define strncmp_P strncmp
+#define strcasecmp_P strcasecmp
+#define sprintf_P  sprintf
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+#define printf_P   printf
+
+#endif
@@ -0,0 +1,27 @@
+/* avr/sleep.h - Sleep modes for the host build
+
+  sleep_cpu() lets simulated time pass up to the next interrupt, see host_sleep(). The mode is
+  not looked at: every mode wakes on every interrupt the model raises.
+*/
+
+#ifndef _HOST_AVR_SLEEP_H_
+#define _HOST_AVR_SLEEP_H_
+
+#include <avr/io.h>
+#include "../hostio.h"
+
+#define SLEEP_MODE_IDLE         0
+#define SLEEP_MODE_ADC          _BV(SM0)
+#define SLEEP_MODE_PWR_DOWN     _BV(SM1)
+#define SLEEP_MODE_PWR_SAVE     (_BV(SM0) | _BV(SM1))
+#define SLEEP_MODE_STANDBY      (_BV(SM1) | _BV(SM2))
+#define SLEEP_MODE_EXT_STANDBY  (_BV(SM0) | _BV(SM1) | _BV(SM2))
+
+#define set_sleep_mode(mode) \
+  ((void)(SMCR = (SMCR & ~(_BV(SM0) | _BV(SM1) | _BV(SM2))) | (mode)))
+#define sleep_enable()  ((void)(SMCR |= _BV(SE)))
+#define sleep_disable() ((void)(SMCR &= (uint8_t)~_BV(SE)))
+#define sleep_cpu()     do { if (SMCR & _BV(SE)) { host_sleep(); } } while (0)
+#define sleep_mode()    do { sleep_enable(); sleep_cpu(); sleep_disable(); } while (0)
+
+#endif
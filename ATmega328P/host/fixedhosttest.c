@@ -0,0 +1,274 @@
+//*****************************************************************************
+// File Name	: fixedhosttest.c
+//
+// Title		: util/fixed.c and printFixed() on the host, against long double
+// Revision		: 1.0
+// Notes		: Host build only ("make hosttest"). Runs the fixed point
+//				  functions over edge values and pseudo-random operands and
+//				  compares each result with the same operation in long double
+//				  (64 bit mantissa, exact for every product here), rounded and
+//				  saturated as fixed.h documents. Quotients are checked in 64
+//				  bit integers instead, as a long double quotient can round to
+//				  the wrong side of a half.
+// Target MCU	: host gcc, see hostio.h
+// Editor Tabs	: 4
+//
+// Revision History:
+// When			Who			Description of change
+// -----------	-----------	-----------------------
+// 19-Oct-2026	flyingyizi		Created the program
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../util/fixed.h"
+#include "../util/print.h"
+#include "../util/report.h"
+
+//usage: fixedhosttest [-n rounds] [-s seed]
+//  -n  pseudo-random operands per function and format, default 20000
+//  -s  seed of the operands
+// Exits 1 on any wrong result.
+
+static const uint8_t fracs[] = { 0, 1, 8, 16, 24, 30 };
+#define NFRACS (sizeof(fracs) / sizeof(fracs[0]))
+
+static const int32_t edges[] = {
+    0, 1, -1, 2, -2, 0x7f, -0x80, 0x80, 0xff, 0x7fff, -0x8000, 0x8000, -0x8001, 0xffff,
+    0x10000, -0x10000, 0x18000, -0x18000, 0x7fffff, 0x1000000, 0x40000000, -0x40000000,
+    INT32_MAX, INT32_MAX - 1, INT32_MIN, INT32_MIN + 1
+};
+#define NEDGES (sizeof(edges) / sizeof(edges[0]))
+
+static uint32_t seed = 1;
+static uint32_t checks, failures;
+
+// xorshift32: the same operands on every run and every host.
+static uint32_t next_random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+// Random operands of all magnitudes, not only the 32 bit ones.
+static int32_t random_operand(void)
+{
+    uint32_t r = next_random();
+    return (int32_t)r >> (next_random() % 32);
+}
+
+static int32_t saturate(long double v, long double lo, long double hi)
+{
+    if (v > hi) { return hi; }
+    if (v < lo) { return lo; }
+    return v;
+}
+
+static void check(const char *what, int32_t a, int32_t b, uint8_t frac, int64_t got, int64_t want)
+{
+    checks++;
+    if (got == want) { return; }
+    if (++failures <= 20) {
+        printf("%s(%ld, %ld, %u) = %lld, expected %lld\n", what, (long)a, (long)b, frac,
+               (long long)got, (long long)want);
+    }
+}
+
+// serial.c comes in for the USART stream print_stream starts on. Nothing is written to it.
+void protocol_execute_realtime_silent(void) { }
+
+//----- References -------------------------------------------------------------
+// a*b >> frac, halves up, saturated.
+static int32_t ref_mul(int32_t a, int32_t b, uint8_t frac)
+{
+    long double p = ldexpl((long double)a * b, -frac);
+    return saturate(floorl(p + 0.5L), INT32_MIN, INT32_MAX);
+}
+
+// (a << frac) / b, halves away from zero, saturated. Division by zero: the sign of a.
+static int32_t ref_div(int32_t a, int32_t b, uint8_t frac)
+{
+    if (b == 0) { return (a < 0) ? INT32_MIN : INT32_MAX; }
+    uint64_t n = (uint64_t)llabs(a) << frac;
+    uint64_t d = llabs(b);
+    uint64_t q = (2*n + d) / (2*d);
+    if ((a < 0) != (b < 0)) { return (q >= 0x80000000ULL) ? INT32_MIN : -(int64_t)q; }
+    return (q > INT32_MAX) ? INT32_MAX : (int32_t)q;
+}
+
+// Nearest integer, halves away from zero.
+static int32_t ref_round(int32_t a, uint8_t frac)
+{
+    long double v = ldexpl(a, -frac);
+    return (v < 0) ? -floorl(-v + 0.5L) : floorl(v + 0.5L);
+}
+
+//----- The checks -------------------------------------------------------------
+static void check_pair(int32_t a, int32_t b)
+{
+    uint8_t i;
+
+    for (i = 0; i < NFRACS; i++) {
+        uint8_t frac = fracs[i];
+        check("fixed_mul", a, b, frac, fixed_mul(a, b, frac), ref_mul(a, b, frac));
+        check("fixed_div", a, b, frac, fixed_div(a, b, frac), ref_div(a, b, frac));
+    }
+    int16_t a16 = a, b16 = b;
+    long double p = ldexpl((long double)a16 * b16, -Q8_8_FRAC);
+    check("q8_8_mul", a16, b16, Q8_8_FRAC, q8_8_mul(a16, b16),
+          saturate(floorl(p + 0.5L), INT16_MIN, INT16_MAX));
+    int32_t q = ref_div(a16, b16, Q8_8_FRAC);
+    check("q8_8_div", a16, b16, Q8_8_FRAC, q8_8_div(a16, b16),
+          (q > INT16_MAX) ? INT16_MAX : (q < INT16_MIN) ? INT16_MIN : q);
+}
+
+static void check_value(int32_t a)
+{
+    uint8_t i;
+
+    for (i = 0; i < NFRACS; i++) {
+        uint8_t frac = fracs[i];
+        check("fixed_round", a, 0, frac, fixed_round(a, frac), ref_round(a, frac));
+    }
+    check("fixed_from_decimal", a, 3, 16, fixed_from_decimal(a, 3, 16), ref_div(a, 1000, 16));
+    check("fixed_to_decimal", a, 16, 3, fixed_to_decimal(a, 16, 3), ref_mul(a, 1000, 16));
+}
+
+// Parses text at frac and compares value, status and the end position with strtold(). Digits
+// past the ninth decimal are dropped, as fixed_parse() ignores them.
+static void check_parse(const char *text, uint8_t frac)
+{
+    char trimmed[64];
+    char *dot = strchr(strcpy(trimmed, text), '.');
+    if (dot && (strlen(dot + 1) > 9)) { dot[10] = 0; }
+
+    long double v = ldexpl(strtold(trimmed, NULL), frac);
+    long double r = (v < 0) ? -floorl(-v + 0.5L) : floorl(v + 0.5L);
+    uint8_t want_ok = (r >= INT32_MIN) && (r <= INT32_MAX);
+
+    char line[80];
+    snprintf(line, sizeof(line), "X%s Y", text);
+    uint8_t char_counter = 1;
+    int32_t value = 0x5a5a5a5a;
+    uint8_t status = fixed_parse(line, &char_counter, &value, frac);
+
+    checks++;
+    if (want_ok ? ((status == STATUS_OK) && (value == (int32_t)r) && (line[char_counter] == ' '))
+                : (status == STATUS_BAD_NUMBER_FORMAT)) {
+        return;
+    }
+    if (++failures <= 20) {
+        printf("fixed_parse(\"%s\", %u) = %u, %ld at %u, expected ", text, frac, status,
+               (long)value, char_counter);
+        if (want_ok) { printf("%.0Lf\n", r); } else { printf("STATUS_BAD_NUMBER_FORMAT\n"); }
+    }
+}
+
+// printFixed() into a RAM stream, against the long double value rounded to places decimals,
+// halves up.
+static void check_print(int32_t a, uint8_t frac, uint8_t places)
+{
+    static char out[32];
+    stream_buf_t buf;
+    stream_t *prev = print_bind(stream_buf_init(&buf, out, sizeof(out) - 1));
+    printFixed(a, frac, places);
+    print_bind(prev);
+    out[buf.len] = 0;
+
+    uint32_t u = (a < 0) ? -(uint32_t)a : (uint32_t)a;
+    uint64_t ipart = u >> frac;
+    long double scale = powl(10, (places > 9) ? 9 : places);
+    uint64_t fpart = floorl(ldexpl(u & ((1ULL << frac) - 1), -frac) * scale + 0.5L);
+    if (fpart == scale) { ipart++; fpart = 0; }
+    char want[32];
+    if (places) {
+        snprintf(want, sizeof(want), "%s%llu.%0*llu", (a < 0) ? "-" : "", (unsigned long long)ipart,
+                 (places > 9) ? 9 : places, (unsigned long long)fpart);
+    } else {
+        snprintf(want, sizeof(want), "%s%llu", (a < 0) ? "-" : "", (unsigned long long)ipart);
+    }
+
+    checks++;
+    if (strcmp(out, want) == 0) { return; }
+    if (++failures <= 20) {
+        printf("printFixed(%ld, %u, %u) = \"%s\", expected \"%s\"\n", (long)a, frac, places, out, want);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const char *numbers[] = {
+        "0", "-0", "+1", "1.5", "-1.5", ".5", "-.25", "0.0000152587890625", "3.14159265358979",
+        "32767", "32767.99998", "32767.99999", "-32768", "-32768.00001", "32768", "-32769",
+        "127.99", "-128", "128", "2147483647", "-2147483648", "2147483648", "-2147483649",
+        "4294967296", "4294967295", "21474836480", "99999999999999999999", "1.9999999999",
+        "-1.99999999999", "0.999999999", "1.00000000049", "-0.5", "0.5", "1.", "-."
+    };
+    uint32_t rounds = 20000;
+    uint32_t i, j;
+    uint8_t k;
+
+    for (i = 1; i + 1 < (uint32_t)argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0) { rounds = strtoul(argv[i + 1], NULL, 0); }
+        else if (strcmp(argv[i], "-s") == 0) { seed = strtoul(argv[i + 1], NULL, 0) | 1; }
+    }
+
+    // Every pair of edge values, then random pairs.
+    for (i = 0; i < NEDGES; i++) {
+        check_value(edges[i]);
+        for (j = 0; j < NEDGES; j++) { check_pair(edges[i], edges[j]); }
+    }
+    for (i = 0; i < rounds; i++) {
+        int32_t a = random_operand();
+        check_value(a);
+        check_pair(a, random_operand());
+    }
+
+    // The parser on fixed strings, including the 32 bit wrap of the integer part, then on
+    // random values printed with up to 10 decimals.
+    for (i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+        if (strcmp(numbers[i], "-.") == 0) { // No digits
+            char line[] = "X-. Y";
+            uint8_t char_counter = 1;
+            int32_t value;
+            checks++;
+            if (fixed_parse(line, &char_counter, &value, 16) != STATUS_BAD_NUMBER_FORMAT) {
+                printf("fixed_parse(\"-.\") accepted\n");
+                failures++;
+            }
+            continue;
+        }
+        for (k = 0; k < NFRACS; k++) { check_parse(numbers[i], fracs[k]); }
+    }
+    for (i = 0; i < rounds; i++) {
+        char text[40];
+        int32_t a = random_operand();
+        snprintf(text, sizeof(text), "%.*Lf", (int)(next_random() % 11),
+                 ldexpl(a, -(int)(next_random() % 20)));
+        for (k = 0; k < NFRACS; k++) { check_parse(text, fracs[k]); }
+    }
+
+    // printFixed() on the edges at every format and precision, then random values.
+    for (i = 0; i < NEDGES; i++) {
+        for (k = 0; k < NFRACS; k++) {
+            for (j = 0; j <= 10; j++) { check_print(edges[i], fracs[k], j); }
+        }
+    }
+    for (i = 0; i < rounds; i++) {
+        check_print(random_operand(), fracs[next_random() % NFRACS], next_random() % 11);
+    }
+
+    printf("fixed    %lu checks, %lu failed\n", (unsigned long)checks, (unsigned long)failures);
+    if (failures) {
+        printf("FAIL: %lu wrong results\n", (unsigned long)failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,453 @@
+/* hostio.c - Simulated ATmega328P for the host build, see hostio.h */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "hostio.h"
+
+#define HOST_NEVER UINT64_MAX
+#define HOST_STORM 1000000UL // ISR calls without time passing that count as a hang
+
+volatile uint8_t host_io[0x100];
+uint64_t host_cycles;
+host_uart_t host_uart0;
+uint32_t host_isr_count[HOST_VECTORS];
+
+static uint32_t host_isr_total; // All ISR calls, to see whether a sleep was woken
+static uint32_t host_storm;     // ISR calls since time last passed
+
+// The ISRs linked in, by vector number. Weak references: a vector without ISR is NULL.
+#define HOST_VECTOR(n) extern void __vector_##n(void) __attribute__((weak));
+HOST_VECTOR(1) HOST_VECTOR(2) HOST_VECTOR(3) HOST_VECTOR(4) HOST_VECTOR(5)
+HOST_VECTOR(6) HOST_VECTOR(7) HOST_VECTOR(8) HOST_VECTOR(9) HOST_VECTOR(10)
+HOST_VECTOR(11) HOST_VECTOR(12) HOST_VECTOR(13) HOST_VECTOR(14) HOST_VECTOR(15)
+HOST_VECTOR(16) HOST_VECTOR(17) HOST_VECTOR(18) HOST_VECTOR(19) HOST_VECTOR(20)
+HOST_VECTOR(21) HOST_VECTOR(22) HOST_VECTOR(23) HOST_VECTOR(24) HOST_VECTOR(25)
+
+static void (*const host_vector[HOST_VECTORS])(void) = {
+  NULL, __vector_1, __vector_2, __vector_3, __vector_4, __vector_5,
+  __vector_6, __vector_7, __vector_8, __vector_9, __vector_10,
+  __vector_11, __vector_12, __vector_13, __vector_14, __vector_15,
+  __vector_16, __vector_17, __vector_18, __vector_19, __vector_20,
+  __vector_21, __vector_22, __vector_23, __vector_24, __vector_25
+};
+
+// Flag and enable bit of each interrupt. Vectors without an entry are never raised.
+typedef struct {
+  volatile uint8_t *flag;
+  uint8_t flag_bit;
+  volatile uint8_t *mask;
+  uint8_t mask_bit;
+  uint8_t cleared; // Flag cleared by the hardware when the ISR is entered
+} host_source_t;
+
+static const host_source_t host_source[HOST_VECTORS] = {
+  [INT0_vect_num]         = { &EIFR,   INTF0, &EIMSK,  INT0,   1 },
+  [INT1_vect_num]         = { &EIFR,   INTF1, &EIMSK,  INT1,   1 },
+  [PCINT0_vect_num]       = { &PCIFR,  PCIF0, &PCICR,  PCIE0,  1 },
+  [PCINT1_vect_num]       = { &PCIFR,  PCIF1, &PCICR,  PCIE1,  1 },
+  [PCINT2_vect_num]       = { &PCIFR,  PCIF2, &PCICR,  PCIE2,  1 },
+  [TIMER2_COMPA_vect_num] = { &TIFR2,  OCF2A, &TIMSK2, OCIE2A, 1 },
+  [TIMER2_COMPB_vect_num] = { &TIFR2,  OCF2B, &TIMSK2, OCIE2B, 1 },
+  [TIMER2_OVF_vect_num]   = { &TIFR2,  TOV2,  &TIMSK2, TOIE2,  1 },
+  [TIMER1_COMPA_vect_num] = { &TIFR1,  OCF1A, &TIMSK1, OCIE1A, 1 },
+  [TIMER1_COMPB_vect_num] = { &TIFR1,  OCF1B, &TIMSK1, OCIE1B, 1 },
+  [TIMER1_OVF_vect_num]   = { &TIFR1,  TOV1,  &TIMSK1, TOIE1,  1 },
+  [TIMER0_COMPA_vect_num] = { &TIFR0,  OCF0A, &TIMSK0, OCIE0A, 1 },
+  [TIMER0_COMPB_vect_num] = { &TIFR0,  OCF0B, &TIMSK0, OCIE0B, 1 },
+  [TIMER0_OVF_vect_num]   = { &TIFR0,  TOV0,  &TIMSK0, TOIE0,  1 },
+  [USART_RX_vect_num]     = { &UCSR0A, RXC0,  &UCSR0B, RXCIE0, 0 }, // Cleared by reading UDR0
+  [USART_UDRE_vect_num]   = { &UCSR0A, UDRE0, &UCSR0B, UDRIE0, 0 }, // Cleared by writing UDR0
+  [USART_TX_vect_num]     = { &UCSR0A, TXC0,  &UCSR0B, TXCIE0, 1 },
+};
+
+
+/* ---------------------------------------------------------------------------------------- */
+/* USART0 */
+
+static struct {
+  uint64_t rx_next;   // End of the frame on the RX line, HOST_NEVER while the receiver is off
+  uint8_t rx_valid;   // That frame carries rx_data, else the line is idle
+  uint8_t rx_data;
+  uint8_t rx_fifo[2]; // Receive FIFO, rx_fifo[0] is in UDR0
+  uint8_t rx_count;
+  uint64_t tx_done;   // End of the frame in the shift register, HOST_NEVER while idle
+  uint8_t tx_shift;
+  uint8_t tx_udr;     // Written byte waiting for the shift register
+  uint8_t tx_full;
+} uart;
+
+uint32_t host_uart_frame_cycles(void)
+{
+  static const uint8_t data_bits[8] = { 5, 6, 7, 8, 8, 8, 8, 9 };
+  uint8_t size = ((UCSR0C >> UCSZ00) & 3) | ((UCSR0B & _BV(UCSZ02)) ? 4 : 0);
+  uint8_t bits = 1 + data_bits[size] + ((UCSR0C & _BV(UPM01)) ? 1 : 0) + ((UCSR0C & _BV(USBS0)) ? 2 : 1);
+  uint32_t bit = ((UCSR0A & _BV(U2X0)) ? 8UL : 16UL) * ((UBRR0 & 0x0fff) + 1);
+  return bits * bit;
+}
+
+// Frame on the RX line done: into the FIFO, then the next byte from the source.
+static void host_uart_rx_frame(void)
+{
+  if (uart.rx_valid)
+  {
+    if (uart.rx_count == sizeof(uart.rx_fifo))
+    {
+      UCSR0A |= _BV(DOR0);
+      host_uart0.overruns++;
+    }
+    else
+    {
+      uart.rx_fifo[uart.rx_count++] = uart.rx_data;
+      UDR0 = uart.rx_fifo[0];
+      UCSR0A |= _BV(RXC0);
+      host_uart0.rx_bytes++;
+    }
+  }
+  int c = host_uart0.rx_source ? host_uart0.rx_source() : -1;
+  uart.rx_valid = (c >= 0);
+  uart.rx_data = (uint8_t)c;
+  uart.rx_next = host_cycles + host_uart_frame_cycles() + (uart.rx_valid ? host_uart0.rx_gap : 0);
+}
+
+// The USART_RX ISR read UDR0.
+static void host_uart_rx_read(void)
+{
+  if (uart.rx_count == 0) { return; }
+  uart.rx_fifo[0] = uart.rx_fifo[1];
+  uart.rx_count--;
+  UCSR0A &= ~_BV(DOR0);
+  if (uart.rx_count) { UDR0 = uart.rx_fifo[0]; }
+  else { UCSR0A &= ~_BV(RXC0); }
+}
+
+// The USART_UDRE ISR wrote UDR0.
+static void host_uart_tx_write(uint8_t data)
+{
+  if (!(UCSR0B & _BV(TXEN0))) { return; }
+  UCSR0A &= ~_BV(TXC0);
+  if (uart.tx_done == HOST_NEVER)
+  {
+    uart.tx_shift = data; // Straight into the shift register, UDR0 stays empty
+    uart.tx_done = host_cycles + host_uart_frame_cycles();
+  }
+  else
+  {
+    uart.tx_udr = data;
+    uart.tx_full = 1;
+    UCSR0A &= ~_BV(UDRE0);
+  }
+}
+
+// Frame in the shift register sent: to the sink, then the next one from UDR0.
+static void host_uart_tx_frame(void)
+{
+  host_uart0.tx_bytes++;
+  if (host_uart0.tx_sink) { host_uart0.tx_sink(uart.tx_shift); }
+  if (uart.tx_full)
+  {
+    uart.tx_shift = uart.tx_udr;
+    uart.tx_full = 0;
+    uart.tx_done = host_cycles + host_uart_frame_cycles();
+    UCSR0A |= _BV(UDRE0);
+  }
+  else
+  {
+    uart.tx_done = HOST_NEVER;
+    UCSR0A |= _BV(TXC0);
+  }
+}
+
+static void host_uart_update(void)
+{
+  if (!(UCSR0B & _BV(RXEN0))) { uart.rx_next = HOST_NEVER; }
+  else if (uart.rx_next == HOST_NEVER) { uart.rx_valid = 0; uart.rx_next = host_cycles; }
+  while (uart.rx_next <= host_cycles) { host_uart_rx_frame(); }
+  while (uart.tx_done <= host_cycles) { host_uart_tx_frame(); }
+}
+
+
+/* ---------------------------------------------------------------------------------------- */
+/* Timer/Counter0, 1 and 2 */
+
+typedef struct {
+  volatile uint8_t *tccra, *tccrb, *tcnt, *ocra, *ocrb, *icr, *tifr, *timsk;
+  uint8_t wide;              // 16 bit registers
+  const uint16_t *prescale;  // Clock divider by CS bits, 0: stopped or external clock
+} host_timer_t;
+
+static const uint16_t host_prescale01[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+static const uint16_t host_prescale2[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+
+static const host_timer_t host_timer[3] = {
+  { &TCCR0A, &TCCR0B, &TCNT0, &OCR0A, &OCR0B, NULL, &TIFR0, &TIMSK0, 0, host_prescale01 },
+  { &TCCR1A, &TCCR1B, &TCNT1L, &OCR1AL, &OCR1BL, &ICR1L, &TIFR1, &TIMSK1, 1, host_prescale01 },
+  { &TCCR2A, &TCCR2B, &TCNT2, &OCR2A, &OCR2B, NULL, &TIFR2, &TIMSK2, 0, host_prescale2 },
+};
+static uint32_t host_timer_phase[3]; // Cycles since the last timer clock
+
+// TOP by waveform mode. 0: MAX, 4: OCRnA, 5: ICR1, else the value. The flag tells whether
+// TOVn is set at TOP (PWM modes) or at MAX (normal and CTC).
+#define TOP_MAX  0
+#define TOP_OCRA 4
+#define TOP_ICR  5
+static const struct { uint16_t top; uint8_t tov_at_top; } host_wgm8[8] = {
+  { TOP_MAX, 0 }, { 0xff, 1 }, { TOP_OCRA, 0 }, { 0xff, 1 },
+  { TOP_MAX, 0 }, { TOP_OCRA, 1 }, { TOP_MAX, 0 }, { TOP_OCRA, 1 },
+};
+static const struct { uint16_t top; uint8_t tov_at_top; } host_wgm16[16] = {
+  { TOP_MAX, 0 }, { 0xff, 1 }, { 0x1ff, 1 }, { 0x3ff, 1 },
+  { TOP_OCRA, 0 }, { 0xff, 1 }, { 0x1ff, 1 }, { 0x3ff, 1 },
+  { TOP_ICR, 1 }, { TOP_OCRA, 1 }, { TOP_ICR, 1 }, { TOP_OCRA, 1 },
+  { TOP_ICR, 0 }, { TOP_MAX, 0 }, { TOP_ICR, 1 }, { TOP_OCRA, 1 },
+};
+
+typedef struct {
+  uint32_t max, top, count, ocra, ocrb, tov; // tov: the value whose end sets TOVn
+  uint16_t prescale;
+} host_count_t;
+
+static uint16_t host_reg(volatile uint8_t *reg, uint8_t wide)
+{
+  return wide ? *(volatile uint16_t *)reg : *reg;
+}
+
+static uint8_t host_timer_state(uint8_t t, host_count_t *s)
+{
+  const host_timer_t *tm = &host_timer[t];
+  s->prescale = tm->prescale[*tm->tccrb & 7];
+  if (!s->prescale) { return 0; }
+
+  uint8_t wgm = (*tm->tccra & 3) | ((*tm->tccrb >> 1) & (tm->wide ? 0x0c : 0x04));
+  uint16_t top = tm->wide ? host_wgm16[wgm].top : host_wgm8[wgm].top;
+  uint8_t tov_at_top = tm->wide ? host_wgm16[wgm].tov_at_top : host_wgm8[wgm].tov_at_top;
+
+  s->max = tm->wide ? 0xffff : 0xff;
+  s->count = host_reg(tm->tcnt, tm->wide);
+  s->ocra = host_reg(tm->ocra, tm->wide);
+  s->ocrb = host_reg(tm->ocrb, tm->wide);
+  if (top == TOP_MAX) { s->top = s->max; }
+  else if (top == TOP_OCRA) { s->top = s->ocra; }
+  else if (top == TOP_ICR) { s->top = host_reg(tm->icr, 1); }
+  else { s->top = top; }
+  s->tov = tov_at_top ? s->top : s->max;
+  return 1;
+}
+
+// Timer clocks until the counter leaves value v, or 0 if it never does.
+static uint64_t host_timer_ticks_to(const host_count_t *s, uint32_t v)
+{
+  if (s->count > s->top) // Past TOP: runs on to MAX and wraps
+  {
+    if (v >= s->count) { return v - s->count + 1; }
+    return (v <= s->top) ? (s->max - s->count + 1) + v + 1 : 0;
+  }
+  if (v > s->top) { return 0; }
+  return ((v + s->top + 1 - s->count) % (s->top + 1)) + 1;
+}
+
+// Whether the counter leaves value v within the next ticks timer clocks.
+static uint8_t host_timer_passes(const host_count_t *s, uint32_t v, uint64_t ticks)
+{
+  uint64_t n = host_timer_ticks_to(s, v);
+  return n && n <= ticks;
+}
+
+static void host_timer_advance(uint8_t t, uint64_t cycles)
+{
+  const host_timer_t *tm = &host_timer[t];
+  host_count_t s;
+  if (!host_timer_state(t, &s)) { return; }
+
+  uint64_t total = host_timer_phase[t] + cycles;
+  uint64_t ticks = total / s.prescale;
+  host_timer_phase[t] = total % s.prescale;
+  if (!ticks) { return; }
+
+  if (host_timer_passes(&s, s.ocra, ticks)) { *tm->tifr |= _BV(OCF0A); }
+  if (host_timer_passes(&s, s.ocrb, ticks)) { *tm->tifr |= _BV(OCF0B); }
+  if (host_timer_passes(&s, s.tov, ticks)) { *tm->tifr |= _BV(TOV0); }
+
+  uint64_t count = s.count;
+  if (count > s.top)
+  {
+    uint64_t run = s.max - count + 1;
+    if (ticks < run) { count += ticks; ticks = 0; }
+    else { ticks -= run; count = 0; }
+  }
+  count = (count + ticks) % ((uint64_t)s.top + 1);
+  if (tm->wide) { *(volatile uint16_t *)tm->tcnt = count; }
+  else { *tm->tcnt = count; }
+}
+
+// Cycles until the next enabled timer interrupt flag is set, or HOST_NEVER.
+static uint64_t host_timer_next(uint8_t t)
+{
+  const host_timer_t *tm = &host_timer[t];
+  static const uint8_t bits[3] = { OCF0A, OCF0B, TOV0 }; // Same bits in all three timers
+  host_count_t s;
+  uint64_t next = HOST_NEVER;
+  if (!host_timer_state(t, &s)) { return next; }
+
+  uint32_t value[3] = { s.ocra, s.ocrb, s.tov };
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    // TIMSKn enable bits are in the same positions as the TIFRn flags
+    if (!(*tm->timsk & _BV(bits[i])) || (*tm->tifr & _BV(bits[i]))) { continue; }
+    uint64_t ticks = host_timer_ticks_to(&s, value[i]);
+    if (!ticks) { continue; }
+    uint64_t cycles = ticks * s.prescale - host_timer_phase[t];
+    if (cycles < next) { next = cycles; }
+  }
+  return next;
+}
+
+
+/* ---------------------------------------------------------------------------------------- */
+/* Interrupts and time */
+
+// Lowest pending vector number, or 0.
+static uint8_t host_pending(void)
+{
+  // Quick test first: all flags but WDIF sit at the bit positions of their enable bits, and
+  // a level triggered INT0/INT1 has no flag at all.
+  if (!((EIFR & EIMSK) | (PCIFR & PCICR) | (TIFR0 & TIMSK0) | (TIFR1 & TIMSK1) | (TIFR2 & TIMSK2) |
+        (UCSR0A & UCSR0B & (_BV(RXC0) | _BV(TXC0) | _BV(UDRE0)))) && !(EIMSK & (_BV(INT0) | _BV(INT1))))
+  {
+    return 0;
+  }
+  for (uint8_t n = 1; n < HOST_VECTORS; n++)
+  {
+    const host_source_t *s = &host_source[n];
+    if (s->flag && (*s->mask & _BV(s->mask_bit)) && (*s->flag & _BV(s->flag_bit))) { return n; }
+    // INT0/INT1 in low level mode: requested as long as the pin is low, there is no flag.
+    if ((n == INT0_vect_num || n == INT1_vect_num) && (EIMSK & _BV(n - 1)) &&
+        !((EICRA >> (2 * (n - 1))) & 3) && !(PIND & _BV(PIND2 + n - 1))) { return n; }
+  }
+  return 0;
+}
+
+static void host_interrupt(uint8_t n)
+{
+  const host_source_t *s = &host_source[n];
+  if (!host_vector[n])
+  {
+    fprintf(stderr, "hostio: interrupt %u enabled without an ISR, the chip would reset\n", n);
+    abort();
+  }
+  if (++host_storm > HOST_STORM)
+  {
+    fprintf(stderr, "hostio: interrupt %u keeps firing at cycle %llu, its flag is never cleared\n",
+            n, (unsigned long long)host_cycles);
+    abort();
+  }
+  if (s->flag && s->cleared) { *s->flag &= ~_BV(s->flag_bit); }
+  if (n == USART_RX_vect_num) { UDR0 = uart.rx_fifo[0]; } // UDR0 reads the FIFO, not the last write
+
+  SREG &= ~_BV(SREG_I);
+  host_isr_count[n]++;
+  host_isr_total++;
+  host_vector[n]();
+  if (n == USART_RX_vect_num) { host_uart_rx_read(); }
+  else if (n == USART_UDRE_vect_num) { host_uart_tx_write(UDR0); }
+  SREG |= _BV(SREG_I); // reti
+}
+
+void host_poll(void)
+{
+  uint8_t n;
+  while ((SREG & _BV(SREG_I)) && (n = host_pending())) { host_interrupt(n); }
+}
+
+void host_sei(void)
+{
+  SREG |= _BV(SREG_I);
+  host_poll();
+}
+
+// Moves time to the next event, but not past end, and takes the interrupts it raises.
+static void host_step(uint64_t end)
+{
+  uint64_t next = end;
+  if (uart.rx_next < next) { next = uart.rx_next; }
+  if (uart.tx_done < next) { next = uart.tx_done; }
+  for (uint8_t t = 0; t < 3; t++)
+  {
+    uint64_t cycles = host_timer_next(t);
+    if (cycles != HOST_NEVER && host_cycles + cycles < next) { next = host_cycles + cycles; }
+  }
+  if (next > host_cycles)
+  {
+    for (uint8_t t = 0; t < 3; t++) { host_timer_advance(t, next - host_cycles); }
+    host_cycles = next;
+    host_storm = 0;
+  }
+  host_uart_update();
+  host_poll();
+}
+
+void host_run(uint32_t cycles)
+{
+  uint64_t end = host_cycles + cycles;
+  host_uart_update(); // Pick up a receiver enabled since the last step
+  host_poll();
+  while (host_cycles < end) { host_step(end); }
+}
+
+uint32_t host_sleep(void)
+{
+  uint64_t start = host_cycles;
+  uint64_t end = start + F_CPU;
+  uint32_t isrs = host_isr_total;
+  host_uart_update();
+  while ((host_cycles < end) && (host_isr_total == isrs) && !host_pending()) { host_step(end); }
+  return (uint32_t)(host_cycles - start);
+}
+
+void host_pin(volatile uint8_t *pin, uint8_t bit, uint8_t level)
+{
+  uint8_t old = *pin;
+  if (level) { *pin |= _BV(bit); }
+  else { *pin &= ~_BV(bit); }
+  if (*pin == old) { return; }
+
+  // PCMSK0..2 follow each other, like PINB, PINC, PIND
+  int8_t group = (pin == &PINB) ? 0 : (pin == &PINC) ? 1 : (pin == &PIND) ? 2 : -1;
+  if (group >= 0 && ((&PCMSK0)[group] & _BV(bit))) { PCIFR |= _BV(group); }
+  if (pin == &PIND && (bit == PIND2 || bit == PIND3))
+  {
+    uint8_t n = bit - PIND2;
+    uint8_t sense = (EICRA >> (2 * n)) & 3; // 1: any edge, 2: falling, 3: rising
+    if ((sense == 1) || (sense == 2 && !level) || (sense == 3 && level)) { EIFR |= _BV(n); }
+  }
+  host_poll();
+}
+
+void host_reset(void)
+{
+  memset((void *)host_io, 0, sizeof(host_io));
+  UCSR0A = _BV(UDRE0);
+  UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+  SP = RAMEND;
+
+  host_cycles = 0;
+  host_storm = 0;
+  host_isr_total = 0;
+  memset(host_isr_count, 0, sizeof(host_isr_count));
+  memset(&uart, 0, sizeof(uart));
+  uart.rx_next = HOST_NEVER;
+  uart.tx_done = HOST_NEVER;
+  memset(host_timer_phase, 0, sizeof(host_timer_phase));
+  host_uart0.rx_bytes = 0;
+  host_uart0.tx_bytes = 0;
+  host_uart0.overruns = 0;
+}
+
+// Power on: reset values before any constructor or main() of the test touches a register.
+static void host_power_on(void) __attribute__((constructor));
+static void host_power_on(void)
+{
+  host_reset();
+}
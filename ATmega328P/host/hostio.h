@@ -0,0 +1,69 @@
+/* hostio.h - Simulated ATmega328P for running the driver layer on the host
+
+  The host build (host/Makefile) compiles the firmware sources with the host gcc against the
+  headers in host/avr and host/util. Registers are bytes of host_io[] (see host/avr/io.h), and
+  this module plays the hardware behind them on a simulated clock:
+
+  - host_cycles counts F_CPU cycles. Native code takes no simulated time; time passes only in
+    host_run(), host_sleep() and the delay functions. A test charges the cost of the code it
+    runs, e.g. from the cycle counts of "make benchmark", with host_run().
+  - While time passes, the peripheral models set interrupt flags at the exact cycle they would
+    on the chip. Each time one is set, the pending interrupts are taken in vector order, as
+    long as SREG_I is set: the ISR, a plain function __vector_<n>, is called with SREG_I clear.
+    An enabled interrupt without an ISR aborts, where the chip would reset.
+  - Nothing is random. The same test gives the same sequence of ISR calls on every run.
+
+  Modelled:
+  - USART0: frame length from UBRR0, U2X0 and UCSR0C. Received bytes come from
+    host_uart0.rx_source at line rate, into the two byte receive FIFO; a byte arriving to a
+    full FIFO is lost and sets DOR0. Sent bytes go to host_uart0.tx_sink at the end of their
+    stop bit. RXC0, UDRE0 and TXC0 follow the FIFO and the shift register. The USART_RX ISR
+    must read UDR0 once and the USART_UDRE ISR must write it once, as serial.c does; register
+    accesses themselves are not seen by the model, so polled UDR0 use is not supported.
+  - Timer/Counter0, 1 and 2: prescalers, normal, CTC and fast PWM counting with TOVn, OCFnA
+    and OCFnB. Phase correct modes count up only. No external clock, no input capture.
+  - Pin change and INT0/INT1 on the levels set with host_pin(). Output pins are not looped back
+    into PINx.
+*/
+
+#ifndef hostio_h
+#define hostio_h
+
+#include <stdint.h>
+
+#define HOST_VECTORS 26 // Vector table entries, 0 is reset
+
+typedef struct {
+  int (*rx_source)(void);        // Next byte to receive, or -1: line idle for one frame
+  void (*tx_sink)(uint8_t data); // Each byte sent, at the end of its stop bit
+  uint32_t rx_gap;               // Extra idle cycles between received frames
+  uint32_t rx_bytes;             // Bytes received into the FIFO
+  uint32_t tx_bytes;             // Bytes sent
+  uint32_t overruns;             // Bytes lost to a full receive FIFO (DOR0)
+} host_uart_t;
+
+extern uint64_t host_cycles;
+extern host_uart_t host_uart0;
+extern uint32_t host_isr_count[HOST_VECTORS]; // ISR calls per vector since host_reset()
+
+// Register reset values, time 0, statistics cleared. host_uart0 callbacks are kept.
+void host_reset(void);
+
+// Lets cycles pass, taking the interrupts that become pending on the way.
+void host_run(uint32_t cycles);
+
+// Lets time pass up to the next interrupt, at most one second. Returns the cycles slept.
+uint32_t host_sleep(void);
+
+// Takes the pending interrupts, if SREG_I is set. Called by sei().
+void host_poll(void);
+void host_sei(void);
+
+// Sets the level of an input pin, e.g. host_pin(&PIND, PIND2, 0). Raises the pin change and
+// external interrupt flags for the edge.
+void host_pin(volatile uint8_t *pin, uint8_t bit, uint8_t level);
+
+// Cycles of one USART0 frame at the current settings.
+uint32_t host_uart_frame_cycles(void);
+
+#endif
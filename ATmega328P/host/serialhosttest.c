@@ -0,0 +1,346 @@
+//*****************************************************************************
+// File Name	: serialhosttest.c
+//
+// Title		: serial.c and the line preprocessor on the host, against hostio
+// Revision		: 1.0
+// Notes		: Host build only ("make hosttest"). Streams generated g-code
+//				  through the USART0 model into ISR(SERIAL_RX), the RX ring and
+//				  protocol_read_lines(), and checks every line and every response.
+//				  The motion layer is replaced by stubs.
+// Target MCU	: host gcc, see hostio.h
+// Editor Tabs	: 4
+//
+// Revision History:
+// When			Who			Description of change
+// -----------	-----------	-----------------------
+// 19-Oct-2026	flyingyizi		Created the program
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+// The firmware's own main.c, for its static line slots and protocol_read_lines(). Its main()
+// and the timer demo it calls are not used here.
+#define main avr_main
+#define timer0_CTC_ISR_test() ((void)0)
+#include "../main.c"
+#undef main
+
+#include "hostio.h"
+
+//usage: serialhosttest [-n bytes] [-s seed] [-l line_cycles] [-p loop_cycles]
+//                      [-c byte_cycles] [-g gap_cycles] [-f]
+//  -n  bytes to send, default 1000000
+//  -s  seed of the generated g-code
+//  -l  simulated cycles per executed line (the g-code parser and planner), default 16000
+//  -p  simulated cycles per idle main loop pass, default 200
+//  -c  simulated cycles per byte taken by protocol_read_lines(), default 40
+//  -g  idle cycles between received bytes, default 0 (back to back at BAUD_RATE)
+//  -f  flood: send without flow control and count what is lost, instead of character
+//      counting like tools/stream.py, where nothing may be lost
+// Exits 1 on any wrong line or response, or on any loss while character counting.
+
+#define RAW_SIZE 128    // Longest generated line, terminator included
+#define PENDING_SIZE 256 // Lines in flight; character counting keeps fewer than RX_BUFFER_SIZE
+
+typedef struct {
+    uint8_t len;    // Raw bytes, for the character count
+    uint8_t status; // Response expected
+    char text[LINE_BUFFER_SIZE]; // Line expected at gc_execute_line()
+} pending_t;
+
+static struct {
+    uint32_t seed;
+    uint32_t total;     // Bytes to send
+    uint8_t flood;
+    char raw[RAW_SIZE]; // Line being sent
+    uint8_t len, pos;
+    uint8_t held;       // Length of the next line in raw, held back by the character count
+    uint32_t bytes, lines;
+    uint16_t in_flight; // Bytes sent and not acknowledged
+    pending_t pending[PENDING_SIZE];
+    uint16_t ack;       // Oldest line without response
+    uint16_t exec;      // Next line to reach gc_execute_line()
+    uint16_t head;
+} tx;
+
+static struct {
+    char text[96];
+    uint8_t len;
+    uint32_t ok, error, feedback, other;
+    uint32_t consumed;  // Bytes taken out of the RX ring by protocol_read_lines()
+    uint32_t executed, mismatches;
+} rx;
+
+static uint32_t rnd(void)
+{
+    uint32_t x = tx.seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return tx.seed = x;
+}
+
+static uint8_t put_word(char *p)
+{
+    static const char letters[] = "GMXYZFIJKSgxyzf";
+    uint8_t n = 0;
+    p[n++] = letters[rnd() % (sizeof(letters) - 1)];
+    if (rnd() % 4 == 0) { p[n++] = '-'; }
+    n += sprintf(&p[n], "%u", (unsigned)(rnd() % 1000));
+    if (rnd() % 2) { n += sprintf(&p[n], ".%03u", (unsigned)(rnd() % 1000)); }
+    return n;
+}
+
+// A random line: g-code words, blanks and tabs, lower case, comments, now and then an empty
+// line, a comment alone or a line too long for LINE_BUFFER_SIZE. Never a realtime character.
+static uint8_t gen_line(char *p)
+{
+    uint8_t n = 0;
+    uint32_t kind = rnd() % 64;
+
+    if (kind == 1) {
+        n += sprintf(&p[n], "(comment %u)", (unsigned)rnd() % 100);
+    } else if (kind == 2) {
+        while (n < LINE_BUFFER_SIZE + 10) { n += put_word(&p[n]); }
+    } else if (kind != 0) {
+        uint8_t words = 1 + rnd() % 6;
+        while (words--) {
+            n += put_word(&p[n]);
+            switch (rnd() % 8) {
+            case 0: p[n++] = ' '; p[n++] = ' '; break;
+            case 1: p[n++] = '\t'; break;
+            case 2: n += sprintf(&p[n], "(c%u)", (unsigned)(rnd() % 10)); break;
+            case 3: case 4: p[n++] = ' '; break;
+            }
+        }
+        if (rnd() % 8 == 0) { n += sprintf(&p[n], " ; tail (not a comment"); }
+    }
+    p[n++] = (rnd() % 16) ? '\n' : '\r';
+    return n;
+}
+
+// What the line preprocessor should make of a raw line, written from its description rather
+// than from serial_char_class[]. Returns the expected status.
+static uint8_t preprocess(const char *p, char *out)
+{
+    uint8_t n = 0, overflow = 0;
+    char comment = 0;
+    for (; *p != '\n' && *p != '\r'; p++) {
+        char c = *p;
+        if (comment) {
+            if (comment == '(' && c == ')') { comment = 0; }
+            continue;
+        }
+        if (c == '(' || c == ';') { comment = c; continue; }
+        if (c <= ' ' || c == '/' || c == ')') { continue; }
+        if (c >= 'a' && c <= 'z') { c -= 'a' - 'A'; }
+        if (n >= LINE_BUFFER_SIZE - 1) { overflow = 1; }
+        else { out[n++] = c; }
+    }
+    out[n] = 0;
+    return overflow ? STATUS_OVERFLOW : STATUS_OK;
+}
+
+// host_uart0.rx_source: the sender.
+static int sender_next(void)
+{
+    if (tx.pos == tx.len) {
+        if (!tx.held) {
+            if (tx.bytes >= tx.total) { return -1; } // Done
+            tx.held = gen_line(tx.raw);
+        }
+        if (!tx.flood) {
+            // Character counting. A line longer than the ring goes alone.
+            if (tx.in_flight && (tx.in_flight + tx.held > RX_BUFFER_SIZE - 1)) { return -1; }
+            pending_t *e = &tx.pending[tx.head++ % PENDING_SIZE];
+            e->len = tx.held;
+            e->status = preprocess(tx.raw, e->text);
+            tx.in_flight += tx.held;
+        }
+        tx.len = tx.held;
+        tx.pos = 0;
+        tx.held = 0;
+        tx.lines++;
+    }
+    tx.bytes++;
+    return (uint8_t)tx.raw[tx.pos++];
+}
+
+// host_uart0.tx_sink: the responses, one per line, checked in order.
+static void receiver(uint8_t c)
+{
+    if (c == '\r') { return; }
+    if (c != '\n') {
+        if (rx.len < sizeof(rx.text) - 1) { rx.text[rx.len++] = c; }
+        return;
+    }
+    rx.text[rx.len] = 0;
+    rx.len = 0;
+
+    char *bf = strstr(rx.text, " Bf:"); // REPORT_BUFFER_STATE
+    if (bf) { *bf = 0; }
+
+    int status;
+    if (strcmp(rx.text, "ok") == 0) { status = STATUS_OK; rx.ok++; }
+    else if (strncmp(rx.text, "error:", 6) == 0) { status = atoi(&rx.text[6]); rx.error++; }
+    else if (rx.text[0] == '[') { rx.feedback++; return; } // e.g. [RX overflow]
+    else { rx.other++; return; }
+
+    if (tx.flood) { return; }
+    if (tx.ack == tx.head) {
+        printf("response \"%s\" without a line\n", rx.text);
+        rx.mismatches++;
+        return;
+    }
+    pending_t *e = &tx.pending[tx.ack++ % PENDING_SIZE];
+    if (status != e->status) {
+        printf("line %u: \"%s\", expected status %u\n", (unsigned)(tx.ack - 1), rx.text, e->status);
+        rx.mismatches++;
+    }
+    tx.in_flight -= e->len;
+}
+
+//----- The motion layer, not part of the host build --------------------------
+void gc_init() { }
+
+uint8_t gc_execute_line(char *line)
+{
+    rx.executed++;
+    if (tx.flood) { return STATUS_OK; }
+    // Skip the lines that never get here: empty, comment only, overflowed.
+    while ((tx.exec != tx.head) && ((tx.pending[tx.exec % PENDING_SIZE].status != STATUS_OK) ||
+                                    !tx.pending[tx.exec % PENDING_SIZE].text[0])) {
+        tx.exec++;
+    }
+    if (tx.exec == tx.head) {
+        printf("unexpected line \"%s\"\n", line);
+        rx.mismatches++;
+        return STATUS_OK;
+    }
+    pending_t *e = &tx.pending[tx.exec++ % PENDING_SIZE];
+    if (strcmp(line, e->text) != 0) {
+        printf("line \"%s\", expected \"%s\"\n", line, e->text);
+        rx.mismatches++;
+    }
+    return STATUS_OK;
+}
+
+void plan_buffer_line(float *target, float feed_rate) { }
+plan_block_t *plan_get_current_block() { return NULL; }
+uint8_t plan_check_full_buffer() { return 0; }
+uint8_t plan_get_block_buffer_available() { return BLOCK_BUFFER_SIZE - 1; }
+void plan_prep_buffer() { }
+uint8_t plan_feed_hold() { return 0; }
+void plan_reset() { }
+uint8_t plan_cycle_start() { return 1; }
+uint8_t plan_is_held() { return 0; }
+void stepper_init() { }
+uint8_t st_get_state() { return ST_STATE_IDLE; }
+void st_get_position(int32_t *position) { memset(position, 0, N_AXIS * sizeof(*position)); }
+
+//----- Test -------------------------------------------------------------------
+static uint8_t idle(void)
+{
+    return (tx.pos == tx.len) && !tx.held && (tx.bytes >= tx.total) &&
+           (host_uart0.rx_bytes + host_uart0.overruns == tx.bytes) &&
+           (tx.flood || tx.ack == tx.head) && !line_count &&
+           !(sys_rt_exec_state & EXEC_MASK) && !sys_rt_exec_state_hi &&
+           !serial_get_rx_buffer_count() && !serial_get_tx_buffer_count();
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t line_cycles = 16000, loop_cycles = 200, byte_cycles = 40;
+    int opt;
+
+    tx.seed = 1;
+    tx.total = 1000000;
+    while ((opt = getopt(argc, argv, "n:s:l:p:c:g:f")) != -1) {
+        switch (opt) {
+        case 'n': tx.total = strtoul(optarg, NULL, 0); break;
+        case 's': tx.seed = strtoul(optarg, NULL, 0) | 1; break;
+        case 'l': line_cycles = strtoul(optarg, NULL, 0); break;
+        case 'p': loop_cycles = strtoul(optarg, NULL, 0); break;
+        case 'c': byte_cycles = strtoul(optarg, NULL, 0); break;
+        case 'g': host_uart0.rx_gap = strtoul(optarg, NULL, 0); break;
+        case 'f': tx.flood = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-n bytes] [-s seed] [-l line_cycles] [-p loop_cycles]"
+                    " [-c byte_cycles] [-g gap_cycles] [-f]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    host_uart0.rx_source = sender_next;
+    host_uart0.tx_sink = receiver;
+    serial_init();
+    sei();
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t limit = (uint64_t)tx.total * host_uart_frame_cycles() * 20 + F_CPU;
+
+    // The steps of protocol_main_loop(), without the echo, each charged its simulated time.
+    while (!idle()) {
+        if (host_cycles > limit) {
+            printf("stalled at cycle %llu\n", (unsigned long long)host_cycles);
+            rx.mismatches++;
+            break;
+        }
+        uint8_t before = serial_get_rx_buffer_count();
+        protocol_read_lines();
+        uint8_t taken = before - serial_get_rx_buffer_count(); // No ISR runs in native code
+        rx.consumed += taken;
+        host_run(byte_cycles * taken);
+
+        if (line_count) {
+            uint8_t status = line_status[line_tail];
+            if (status == STATUS_OK) { protocol_execute_line(line_buffer[line_tail]); }
+            else { report_status_message(status); }
+            if (++line_tail == LINE_BUFFER_COUNT) { line_tail = 0; }
+            line_count--;
+            host_run(line_cycles);
+            continue;
+        }
+        protocol_auto_cycle_start();
+        trace_drain();
+        protocol_execute_realtime();
+        host_run(loop_cycles);
+    }
+    host_run(4 * host_uart_frame_cycles()); // Last bytes out of the USART
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    double sim = (double)host_cycles / F_CPU;
+
+    printf("%s, %u baud, RX ring %u, TX ring %u, %u line slots\n",
+           tx.flood ? "flood" : "character counting", BAUD_RATE, RX_BUFFER_SIZE, TX_BUFFER_SIZE,
+           LINE_BUFFER_COUNT);
+    printf("sent     %lu bytes, %lu lines in %.2f s simulated (%.0f bytes/s)\n",
+           (unsigned long)tx.bytes, (unsigned long)tx.lines, sim, tx.bytes / sim);
+    printf("received %lu ok, %lu error, %lu feedback, %lu other; %lu lines executed\n",
+           (unsigned long)rx.ok, (unsigned long)rx.error, (unsigned long)rx.feedback,
+           (unsigned long)rx.other, (unsigned long)rx.executed);
+    printf("lost     %lu bytes to USART overruns, %lu to a full RX ring\n",
+           (unsigned long)host_uart0.overruns,
+           (unsigned long)(host_uart0.rx_bytes - rx.consumed));
+    printf("host     %.3f s, %.2f MB/s, %lu RX ISR and %lu UDRE ISR calls\n",
+           wall, tx.bytes / wall / 1e6, (unsigned long)host_isr_count[USART_RX_vect_num],
+           (unsigned long)host_isr_count[USART_UDRE_vect_num]);
+
+    if (rx.mismatches) {
+        printf("FAIL: %lu mismatches\n", (unsigned long)rx.mismatches);
+        return 1;
+    }
+    if (!tx.flood && (host_uart0.overruns || (host_uart0.rx_bytes != rx.consumed))) {
+        printf("FAIL: bytes lost while character counting\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,32 @@
+/* util/atomic.h - ATOMIC_BLOCK for the host build
+
+  Same construction as avr-libc: the block runs with SREG_I clear and a cleanup handler puts
+  SREG back when it is left by any path. Restoring SREG_I takes the interrupts that became
+  pending inside the block, as the chip would on the next instruction.
+*/
+
+#ifndef _HOST_UTIL_ATOMIC_H_
+#define _HOST_UTIL_ATOMIC_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+static __inline__ uint8_t __iCliRetVal(void) { cli(); return 1; }
+static __inline__ uint8_t __iSeiRetVal(void) { sei(); return 1; }
+static __inline__ void __iSeiParam(const uint8_t *__s) { sei(); (void)__s; }
+static __inline__ void __iCliParam(const uint8_t *__s) { cli(); (void)__s; }
+static __inline__ void __iRestore(const uint8_t *__s)
+{
+  SREG = *__s;
+  if (*__s & _BV(SREG_I)) { host_poll(); }
+}
+
+#define ATOMIC_BLOCK(type) for (type, __ToDo = __iCliRetVal(); __ToDo; __ToDo = 0)
+#define NONATOMIC_BLOCK(type) for (type, __ToDo = __iSeiRetVal(); __ToDo; __ToDo = 0)
+
+#define ATOMIC_RESTORESTATE uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define ATOMIC_FORCEON uint8_t sreg_save __attribute__((__cleanup__(__iSeiParam))) = 0
+#define NONATOMIC_RESTORESTATE uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define NONATOMIC_FORCEOFF uint8_t sreg_save __attribute__((__cleanup__(__iCliParam))) = 0
+
+#endif
@@ -0,0 +1,15 @@
+/* util/delay.h - Busy waits for the host build
+
+  The delays let the same number of simulated cycles pass, with interrupts taken on the way
+  when SREG_I is set, so code that times itself with _delay_us() sees the right rate.
+*/
+
+#ifndef _HOST_UTIL_DELAY_H_
+#define _HOST_UTIL_DELAY_H_
+
+#include <util/delay_basic.h>
+
+#define _delay_us(us) host_run((uint32_t)((double)(us) * (F_CPU / 1e6) + 0.5))
+#define _delay_ms(ms) host_run((uint32_t)((double)(ms) * (F_CPU / 1e3) + 0.5))
+
+#endif
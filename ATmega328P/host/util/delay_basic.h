@@ -0,0 +1,19 @@
+/* util/delay_basic.h - Counted busy loops for the host build, 3 and 4 cycles per count */
+
+#ifndef _HOST_UTIL_DELAY_BASIC_H_
+#define _HOST_UTIL_DELAY_BASIC_H_
+
+#include <stdint.h>
+#include "../hostio.h"
+
+static __inline__ void _delay_loop_1(uint8_t __count)
+{
+  host_run(3UL * (__count ? __count : 256));
+}
+
+static __inline__ void _delay_loop_2(uint16_t __count)
+{
+  host_run(4UL * (__count ? __count : 65536UL));
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+  load.c - CPU load meter and main loop statistics, see load.h
+*/
+
+#include "load.h"
+
+#ifdef LOAD_METER
+
+#include <avr/interrupt.h>
+#include "../timerx8/timerx8.h"
+
+#define LOAD_PRESCALE 64
+#define LOAD_TICKS_PER_MS (F_CPU / LOAD_PRESCALE / 1000)
+#define LOAD_WINDOW_TICKS ((uint32_t)LOAD_WINDOW_MS * LOAD_TICKS_PER_MS)
+_Static_assert(LOAD_WINDOW_TICKS >= 1000, "LOAD_WINDOW_MS too short");
+#define LOAD_TICKS_US(t) ((t) * LOAD_PRESCALE / (F_CPU / 1000000))
+
+volatile uint32_t load_isr_ticks;
+uint8_t load_isr_depth;
+uint8_t load_isr_start;
+
+static struct {
+  uint32_t last;         // End of the previous iteration
+  uint32_t isr_last;     // load_isr_ticks then
+  uint32_t window_start;
+  uint32_t window_isr;   // load_isr_ticks at window_start
+  uint32_t idle;         // Idle ticks in the window
+  uint32_t loops;
+  uint32_t max;          // Longest iteration in the window, ticks
+  load_stats_t stats;
+} load;
+
+// Ticks since load_init(), and the ISR ticks at the same instant.
+static uint32_t load_now(uint32_t *isr)
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint32_t ovf = timer2GetOverflowCount();
+  uint8_t t = TCNT2;
+  if ((TIFR2 & (1<<TOV2)) && (t < 128)) { ovf++; } // Wrapped, overflow ISR still pending
+  *isr = load_isr_ticks;
+  SREG = sreg;
+  return (ovf << 8) | t;
+}
+
+void load_init()
+{
+  TCCR2A = 0; // Normal mode, counts 0 to 255
+  timer2OVFInit(0);
+  timer2SetPrescaler(TIMERRTC_CLK_DIV64);
+  load.last = load.window_start = load_now(&load.isr_last);
+  load.window_isr = load.isr_last;
+}
+
+void load_loop(uint8_t idle)
+{
+  uint32_t isr;
+  uint32_t now = load_now(&isr);
+  uint32_t dt = now - load.last;
+
+  if (idle) { load.idle += dt - (isr - load.isr_last); }
+  if (dt > load.max) { load.max = dt; }
+  load.loops++;
+  load.last = now;
+  load.isr_last = isr;
+
+  uint32_t elapsed = now - load.window_start;
+  if (elapsed < LOAD_WINDOW_TICKS) { return; }
+  uint32_t ms = elapsed / LOAD_TICKS_PER_MS;
+  uint32_t per_mille = elapsed / 1000; // Never overflows, even after a long iteration
+  load.stats.isr = (isr - load.window_isr) / per_mille;
+  load.stats.idle = load.idle / per_mille;
+  if (load.stats.isr + load.stats.idle > 1000) { load.stats.idle = 1000 - load.stats.isr; }
+  load.stats.main = 1000 - load.stats.isr - load.stats.idle;
+  load.stats.loops = (load.loops * 1000) / ms;
+  load.stats.max_us = LOAD_TICKS_US(load.max);
+  if (load.stats.max_us > load.stats.peak_us) { load.stats.peak_us = load.stats.max_us; }
+  load.window_start = now;
+  load.window_isr = isr;
+  load.idle = 0;
+  load.loops = 0;
+  load.max = 0;
+}
+
+void load_get_stats(load_stats_t *stats)
+{
+  *stats = load.stats;
+}
+
+#endif
@@ -0,0 +1,70 @@
+/*
+  load.h - CPU load meter and main loop statistics
+
+  Enabled with -DLOAD_METER. Timer2 runs free at clk/64 (4 us at 16 MHz) through timerx8.c's
+  overflow counter and gives a 32-bit tick count. Three kinds of time are told apart:
+    isr   bodies of the instrumented ISRs (serial RX/UDRE, stepper), between LOAD_ISR_ENTER()
+          and LOAD_ISR_EXIT(). Nested ones count once. Vector prologues and the Timer2 tick
+          itself are not included.
+    idle  main loop iterations that found no line to execute, less the ISR time inside them
+    main  the rest: parsing, planning, reports, and waiting for a full planner or TX ring
+  load_loop() closes each main loop iteration. Every LOAD_WINDOW_MS the counts are turned into
+  the figures of load_stats_t, which the status report and CMD_LOAD_REPORT print. The longest
+  iteration is the worst delay a received line can see before the loop gets back to it.
+
+  ISR times are read from TCNT2 at the tick resolution, so a body shorter than one tick counts
+  as 0 or 1 tick; over many interrupts the average is right. Timer2 can not be shared, so this
+  excludes PROFILE and TIMER2_OVF_STATIC.
+*/
+
+#ifndef load_h
+#define load_h
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#if defined(LOAD_METER) && (defined(PROFILE) || defined(TIMER2_OVF_STATIC))
+  #error "LOAD_METER needs Timer2, which PROFILE or TIMER2_OVF_STATIC already use"
+#endif
+
+#ifndef LOAD_WINDOW_MS
+  #define LOAD_WINDOW_MS 1000
+#endif
+
+typedef struct {
+  uint16_t isr;           // Per mille of the window
+  uint16_t main;
+  uint16_t idle;
+  uint32_t loops;         // Main loop iterations per second
+  uint32_t max_us;        // Longest iteration in the window
+  uint32_t peak_us;       // Longest iteration since reset
+} load_stats_t;
+
+#ifdef LOAD_METER
+  extern volatile uint32_t load_isr_ticks;
+  extern uint8_t load_isr_depth;
+  extern uint8_t load_isr_start;
+
+  // Bracket an ISR body. Enter before any sei() in it, exit on every path out. The exit turns
+  // interrupts off, for ISRs that turned them on; the reti turns them back on.
+  #define LOAD_ISR_ENTER() do { if (load_isr_depth++ == 0) { load_isr_start = TCNT2; } } while (0)
+  #define LOAD_ISR_EXIT() do { \
+      cli(); \
+      if (--load_isr_depth == 0) { load_isr_ticks += (uint8_t)(TCNT2 - load_isr_start); } \
+    } while (0)
+
+  // Starts the time base. Before sei().
+  void load_init();
+
+  // Ends one main loop iteration. idle: nothing was executed in it.
+  void load_loop(uint8_t idle);
+
+  // Figures of the last complete window.
+  void load_get_stats(load_stats_t *stats);
+#else
+  #define LOAD_ISR_ENTER()
+  #define LOAD_ISR_EXIT()
+  #define load_init()
+  #define load_loop(idle)
+#endif
+
+#endif
@@ -1,4 +1,5 @@
 #include <inttypes.h>
+#include <stddef.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/sleep.h>
@@ -7,10 +8,17 @@
 
 #include "util/print.h"
 #include "util/report.h"
+#include "stepper/stepper.h"
+#include "planner/planner.h"
+#include "gcode/gcode.h"
+#include "trace/trace.h"
+#include "profile/profile.h"
+#include "load/load.h"
+#include "bench/benchtest.h"
 #include <avr/pgmspace.h>
 
 // #include "pcint/pcinttest.h" 
-#include "softSerial/softSerialtest.h"
+#include "softSerial/softserialtest.h"
 
 
 // Line buffer size from the serial input stream to be executed.
@@ -23,11 +31,30 @@
 #define LINE_BUFFER_SIZE 80
 #endif
 
-//TODO
+// Number of line slots. One slot is executing while the others are assembled from the serial
+// stream, so reception keeps draining the RX ring during slow commands. Minimum 2.
+#ifndef LINE_BUFFER_COUNT
+#define LINE_BUFFER_COUNT 2
+#endif
+#if LINE_BUFFER_COUNT < 2
+  #error "LINE_BUFFER_COUNT must be at least 2"
+#endif
+
+static void protocol_read_lines();
+
 // Directs and executes one line of formatted input from protocol_process. While mostly
 // incoming streaming g-code blocks, this also directs and executes Grbl internal commands,
 // such as settings, initiating the homing cycle, and toggling switch states.
-static void protocol_execute_line(char *line) {}
+static void protocol_execute_line(char *line)
+{
+  if (line[0] == 0) {
+    // Empty or comment line. Send status message for syncing purposes.
+    report_status_message(STATUS_OK);
+  } else {
+    // Everything else is gcode.
+    report_status_message(gc_execute_line(line));
+  }
+}
 
 // Auto-cycle start has two purposes: 1. Resumes a plan_synchronize() call from a function that
 // requires the planner buffer to empty (spindle enable, dwell, etc.) 2. As a user setting that
@@ -40,8 +67,160 @@ static void protocol_execute_line(char *line) {}
 // when one of these conditions exist respectively: There are no more blocks sent (i.e. streaming
 // is finished, single commands), a command that needs to wait for the motions in the buffer to
 // execute calls a buffer sync, or the planner buffer is full and ready to go.
-void protocol_auto_cycle_start() { bit_true_atomic(sys_rt_exec_state, EXEC_CYCLE_START); }
-//TODO
+static uint8_t auto_start = 1; // Planner auto-start flag. Cleared by a feed hold or program pause, set again by a user cycle start.
+void protocol_auto_cycle_start() { if (auto_start) { rt_exec_set(EXEC_CYCLE_START); } }
+
+// Program pause (M0/M1). Called after the buffer sync, so there is no motion left to hold: the
+// blocks of the following lines are only queued until the user cycle start. Kept apart from the
+// feed hold: the cycle stop of the motion just finished may still be pending, and so may the
+// auto start of the sync, which is dropped.
+static uint8_t program_paused;
+void protocol_program_pause()
+{
+  auto_start = 0;
+  program_paused = 1;
+  rt_exec_clear(EXEC_CYCLE_START);
+}
+
+// Realtime flag handlers. Each gets the full snapshot of flags claimed in this pass, so it can see
+// what else was flagged together with it. Handlers run in flag priority order (lowest bit first).
+typedef void (*rt_exec_handler_t)(uint16_t rt_exec);
+
+// Execute a feed hold. The planner decelerates the running motion to a stop along its path
+// and keeps the remaining blocks until a cycle start replans them from rest.
+static void rt_feed_hold(uint16_t rt_exec)
+{
+  // Disable planner auto start upon feed hold. A '!' while idle has nothing to hold and leaves
+  // it on, as no cycle start would ever come to set it again.
+  if (plan_feed_hold()) { auto_start = 0; }
+}
+
+// Execute a cycle start by starting the stepper interrupt to begin executing the blocks in queue.
+// NOTE: While auto start is disabled only the '~' realtime command can get here.
+static void rt_cycle_start(uint16_t rt_exec)
+{
+  // Block if called at same time as the hold command.
+  if (!(rt_exec & EXEC_FEED_HOLD)) {
+    // A hold still decelerating resumes once it is at rest: flag the cycle start again.
+    if (!plan_cycle_start()) { rt_exec_set(EXEC_CYCLE_START); return; }
+    auto_start = 1; // Resume from a hold or program pause.
+    program_paused = 0;
+  }
+}
+
+// Reinitializes the cycle plan and stepper system after a feed hold for a resume. Called by
+// the stepper interrupt when it runs out of segments. A stop at the end of a feed hold or
+// before a program pause keeps auto start disabled, so only a user cycle start resumes.
+static void rt_cycle_stop(uint16_t rt_exec)
+{
+  if (st_get_state() == ST_STATE_IDLE && !plan_is_held() && !program_paused) { auto_start = 1; }
+}
+
+// Refill the stepper segment ring. Flagged by the stepper interrupt whenever it frees a segment
+// and by the planner when a block is added, so the ring is only topped up when it can change.
+static void rt_prep_buffer(uint16_t rt_exec)
+{
+  plan_prep_buffer();
+}
+
+static void rt_status_report(uint16_t rt_exec)
+{
+  report_realtime_status();
+}
+
+#ifdef TELEMETRY
+static void rt_telemetry_report(uint16_t rt_exec)
+{
+  report_telemetry_status();
+}
+#else
+  #define rt_telemetry_report NULL
+#endif
+
+#ifdef MEMORY_STATS
+static void rt_memory_report(uint16_t rt_exec)
+{
+  report_memory_status();
+}
+#else
+  #define rt_memory_report NULL
+#endif
+
+#ifdef PROFILE
+static void rt_profile_report(uint16_t rt_exec)
+{
+  profile_report();
+}
+#else
+  #define rt_profile_report NULL
+#endif
+
+#ifdef LOAD_METER
+static void rt_load_report(uint16_t rt_exec)
+{
+  report_load_status();
+}
+#else
+  #define rt_load_report NULL
+#endif
+
+static void rt_rx_overflow(uint16_t rt_exec)
+{
+  report_feedback_message(MESSAGE_RX_OVERFLOW);
+}
+
+// Handler for each flag, indexed by bit number over sys_rt_exec_state and sys_rt_exec_state_hi.
+// NULL entries are flags without an action yet; they are claimed and dropped.
+static const rt_exec_handler_t rt_exec_handlers[16] PROGMEM = {
+  NULL,             // bit 0  EXEC_RESET  TODO: mc_reset()
+  NULL,             // bit 1  EXEC_SAFETY_DOOR
+  NULL,             // bit 2  EXEC_MOTION_CANCEL
+  rt_feed_hold,     // bit 3  EXEC_FEED_HOLD
+  rt_cycle_stop,    // bit 4  EXEC_CYCLE_STOP
+  rt_cycle_start,   // bit 5  EXEC_CYCLE_START
+  rt_prep_buffer,   // bit 6  EXEC_PREP_BUFFER
+  NULL,             // bit 7  not an executor flag, never dispatched
+  rt_status_report, // bit 8  EXEC_HI_STATUS_REPORT
+  rt_rx_overflow,   // bit 9  EXEC_HI_RX_OVERFLOW
+  rt_telemetry_report, // bit 10 EXEC_HI_TELEMETRY_REPORT
+  rt_memory_report, // bit 11 EXEC_HI_MEMORY_REPORT
+  rt_profile_report, // bit 12 EXEC_HI_PROFILE_REPORT
+  rt_load_report,   // bit 13 EXEC_HI_LOAD_REPORT
+  NULL, NULL
+};
+
+// Claims the pending flags selected by mask and dispatches them in priority order. One pass of
+// find-first-set over the snapshot: no handler is looked at unless its flag is set.
+// A dispatch from inside a handler, e.g. the serial_write() spin of a report, is only done when
+// the running handlers are outside mask: the silent handlers keep the steppers fed during a long
+// report, but no handler ever runs inside itself.
+static void protocol_execute_rt_mask(uint16_t mask)
+{
+  static uint16_t rt_running; // Flags whose handler is running, nested dispatches included.
+
+  if (!((sys_rt_exec_state & (uint8_t)mask) | (sys_rt_exec_state_hi & (uint8_t)(mask >> 8)))) { return; }
+  if (rt_running & mask) { return; }
+
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t rt_exec = (sys_rt_exec_state | (sys_rt_exec_state_hi << 8)) & mask;
+  sys_rt_exec_state &= ~(uint8_t)rt_exec;
+  sys_rt_exec_state_hi &= ~(uint8_t)(rt_exec >> 8);
+  SREG = sreg;
+
+  uint16_t pending = rt_exec;
+  do {
+    rt_exec_handler_t handler = (rt_exec_handler_t)pgm_read_ptr(&rt_exec_handlers[__builtin_ctz(pending)]);
+    if (handler) {
+      uint16_t flag = pending & -pending; // Lowest set flag
+      rt_running |= flag;
+      handler(rt_exec);
+      rt_running &= ~flag;
+    }
+    pending &= pending - 1; // Clear lowest set flag
+  } while (pending);
+}
+
 // Executes run-time commands, when required. This is called from various check points in the main
 // program, primarily where there may be a while loop waiting for a buffer to clear space or any
 // point where the execution time from the last check point may be more than a fraction of a second.
@@ -53,15 +232,215 @@ void protocol_auto_cycle_start() { bit_true_atomic(sys_rt_exec_state, EXEC_CYCLE
 // recalculating the buffer upon a feedhold or override.
 // NOTE: The sys_rt_exec_state variable flags are set by any process, step or serial interrupts, pinouts,
 // limit switches, or the main program.
-void protocol_execute_realtime() {}
+void protocol_execute_realtime()
+{
+  protocol_execute_rt_mask(0xff00 | EXEC_MASK);
+}
+
+// Same, restricted to the handlers that never print. Called from the serial_write() spin.
+void protocol_execute_realtime_silent()
+{
+  protocol_execute_rt_mask(EXEC_SILENT_MASK);
+}
+
+// Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/minute.
+// Blocks in the realtime check loop while the planner buffer is full, so the executing motion
+// keeps being fed and realtime commands stay responsive.
+void mc_line(float *target, float feed_rate)
+{
+  while (plan_check_full_buffer()) {
+    protocol_auto_cycle_start(); // Auto-cycle start when buffer is full.
+    protocol_execute_realtime(); // Check for any run-time commands
+    protocol_read_lines();       // Assemble the next lines meanwhile
+  }
+  plan_buffer_line(target, feed_rate);
+}
+
+// Block until all buffered steps are executed. Used by commands that must run after the
+// preceding motion, e.g. program pause and end.
+void protocol_buffer_synchronize()
+{
+  // If system is queued, ensure cycle resumes if the auto start flag is present.
+  protocol_auto_cycle_start();
+  while (plan_get_current_block() || (st_get_state() != ST_STATE_IDLE)) {
+    protocol_execute_realtime();   // Check and execute run-time commands
+    protocol_read_lines();
+  }
+}
 
-static char line[LINE_BUFFER_SIZE]; // Line to be executed. Zero-terminated.
+static char line_buffer[LINE_BUFFER_COUNT][LINE_BUFFER_SIZE]; // Line slots. Zero-terminated.
+static uint8_t line_status[LINE_BUFFER_COUNT]; // STATUS_OK, or why a completed line is rejected.
+#ifdef LINE_CHECKSUM
+static uint32_t line_resend[LINE_BUFFER_COUNT]; // Line number to resend from, for framing errors.
+static uint32_t line_expected;                  // Next N<line> number of a framed line.
+#endif
+static uint8_t line_head;  // Slot being assembled
+static uint8_t line_tail;  // Oldest completed line, next to execute
+static uint8_t line_count; // Completed lines, including the one executing
 
 // Define different comment types for pre-parsing.
 #define COMMENT_NONE 0
 #define COMMENT_TYPE_PARENTHESES 1
 #define COMMENT_TYPE_SEMICOLON 2
 
+#ifdef LINE_CHECKSUM
+/* Validates a framed line "N<line><g-code>*<checksum>", where the checksum is the XOR of all
+   raw bytes before '*' (spaces and comments included), as most g-code senders compute it.
+   The line must carry the expected line number. "N<line>M110" sets the number instead and
+   executes as an empty line. Returns a STATUS_* code; the line stays in the slot with its N
+   word, which the g-code parser records as the current line number. */
+static uint8_t protocol_check_frame(char *line, uint8_t checksum, uint16_t given)
+{
+  uint8_t char_counter = 1;
+  uint32_t n = 0;
+
+  if (checksum != given) { return(STATUS_LINE_CHECKSUM); }
+  if (line[0] != 'N') { return(STATUS_LINE_SEQUENCE); }
+  uint8_t digit;
+  while ((digit = line[char_counter] - '0') <= 9) {
+    // A number that would wrap 32 bits could match line_expected by accident.
+    if ((n > 0xffffffffUL/10) || (10*n > 0xffffffffUL - digit)) { return(STATUS_LINE_SEQUENCE); }
+    n = 10*n + digit;
+    char_counter++;
+  }
+  if (strcmp_P(&line[char_counter], PSTR("M110")) == 0) {
+    line_expected = n + 1;
+    line[0] = 0;
+    return(STATUS_OK);
+  }
+  if (n != line_expected) { return(STATUS_LINE_SEQUENCE); }
+  line_expected++;
+  return(STATUS_OK);
+}
+#endif
+
+/* Process incoming serial data into the line slots, as the data becomes available. Performs an
+   initial filtering by removing spaces and comments and capitalizing all letters. Completed lines
+   are queued for protocol_main_loop(). Called from the main loop and from the wait loops in
+   mc_line() and protocol_buffer_synchronize(), so the next lines are assembled while the current
+   one executes. Stops when all slots hold completed lines, leaving the rest in the RX ring.
+
+   NOTE: While comment, spaces, and block delete(if supported) handling should technically
+   be done in the g-code parser, doing it here helps compress the incoming data into Grbl's
+   line buffer, which is limited in size. The g-code standard actually states a line can't
+   exceed 256 characters, but the Arduino Uno does not have the memory space for this.
+   With a better processor, it would be very easy to pull this initial parsing out as a
+   seperate task to be shared by the g-code parser and Grbl's system commands. */
+static void protocol_read_lines()
+{
+  static uint8_t comment = COMMENT_NONE;
+  static uint8_t char_counter = 0;
+  static uint8_t overflow = 0; // Line too long, the rest is dropped
+  #ifdef LINE_CHECKSUM
+    static uint8_t checksum = 0;    // XOR of the raw line bytes before '*'
+    static uint16_t given = 0xffff; // Checksum digits after '*'. No '*' never matches.
+    static uint8_t framed = 0;      // '*' seen on this line
+  #endif
+  char *line = line_buffer[line_head];
+  uint8_t c;
+
+  while ((line_count < LINE_BUFFER_COUNT) && ((c = serial_read()) != SERIAL_NO_DATA))
+  {
+    // One class lookup per byte. Plain g-code characters have class 0 and take the shortest path.
+    uint8_t cls = pgm_read_byte(&serial_char_class[c]);
+    if (cls & CC_EOL)
+    {                         // End of line reached
+      line[char_counter] = 0; // Set string termination character.
+      line_status[line_head] = STATUS_OK;
+      #ifdef LINE_CHECKSUM
+        if (framed || (line[0] == 'N')) {
+          // A numbered line without '*' is the head of a line split by a corrupted byte.
+          // An overflowed line keeps its N word and is checked too, so it uses up its line
+          // number: resending it would only overflow again.
+          line_status[line_head] = protocol_check_frame(line, checksum, given);
+          line_resend[line_head] = line_expected;
+        }
+        checksum = 0;
+        given = 0xffff;
+        framed = 0;
+      #endif
+      if (overflow && (line_status[line_head] == STATUS_OK)) { line_status[line_head] = STATUS_OVERFLOW; }
+
+      // Line is complete. Queue it for execution and start on the next slot.
+      if (++line_head == LINE_BUFFER_COUNT) { line_head = 0; }
+      line_count++;
+      line = line_buffer[line_head];
+      comment = COMMENT_NONE;
+      char_counter = 0;
+      overflow = 0;
+      continue;
+    }
+    #ifdef LINE_CHECKSUM
+      if (framed)
+      {
+        // Checksum digits. Anything else makes the checksum invalid.
+        c -= '0';
+        given = (c <= 9) ? (10*given + c) : 0xffff;
+        continue;
+      }
+      if ((cls & CC_CHECKSUM) && (comment == COMMENT_NONE))
+      {
+        framed = 1;
+        given = 0;
+        continue;
+      }
+      checksum ^= c;
+    #endif
+    if (comment != COMMENT_NONE)
+    {
+      // Throw away all comment characters
+      if ((cls & CC_COMMENT_CLOSE) && (comment == COMMENT_TYPE_PARENTHESES))
+      {
+        // End of comment. Resume line. But, not if semicolon type comment.
+        comment = COMMENT_NONE;
+      }
+      continue;
+    }
+    if (cls)
+    {
+      if (cls & CC_COMMENT_OPEN)
+      {
+        // Enable comments flag and ignore all characters until ')' or EOL.
+        // NOTE: This doesn't follow the NIST definition exactly, but is good enough for now.
+        // In the future, we could simply remove the items within the comments, but retain the
+        // comment control characters, so that the g-code parser can error-check it.
+        comment = COMMENT_TYPE_PARENTHESES;
+        continue;
+      }
+      if (cls & CC_COMMENT_EOL)
+      {
+        // NOTE: ';' comment to EOL is a LinuxCNC definition. Not NIST.
+        comment = COMMENT_TYPE_SEMICOLON;
+
+        // TODO: Install '%' feature
+        // Program start-end percent sign NOT SUPPORTED.
+        // NOTE: This maybe installed to tell Grbl when a program is running vs manual input,
+        // where, during a program, the system auto-cycle start will continue to execute
+        // everything until the next '%' sign. This will help fix resuming issues with certain
+        // functions that empty the planner buffer to execute its task on-time.
+        continue;
+      }
+      if (!(cls & CC_LOWER))
+      {
+        // Throw away whitepace, control characters and block delete.
+        continue;
+      }
+      c -= 'a' - 'A'; // Upcase lowercase
+    }
+    if (char_counter >= (LINE_BUFFER_SIZE - 1))
+    {
+      // Detect line buffer overflow. Drop the rest of the line, but keep following comments
+      // and the '*' framing; the error is reported in place of its 'ok', so responses stay
+      // in line order.
+      overflow = 1;
+    }
+    else
+    {
+      line[char_counter++] = c;
+    }
+  }
+}
+
 /* 
    PRIMARY LOOP:
 */
@@ -71,6 +450,10 @@ void protocol_main_loop()
   // Complete initialization procedures upon a power-up or reset.
   // ------------------------------------------------------------
 
+  stepper_init(); // Configure stepper pins and interrupt timers, clear its variables
+  plan_reset(); // Clear block buffer and planner variables
+  gc_init(); // Set g-code parser to default state
+
   // Print welcome message
   printPgmString(PSTR("\r\nserial demo "
                       "xxx"
@@ -80,98 +463,38 @@ void protocol_main_loop()
   // Primary loop! Upon a system abort, this exits back to main() to reset the system.
   // ---------------------------------------------------------------------------------
 
-  uint8_t comment = COMMENT_NONE;
-  uint8_t char_counter = 0;
-  uint8_t c;
   for (;;)
   {
+    protocol_read_lines();
 
-    // Process one line of incoming serial data, as the data becomes available. Performs an
-    // initial filtering by removing spaces and comments and capitalizing all letters.
-
-    // NOTE: While comment, spaces, and block delete(if supported) handling should technically
-    // be done in the g-code parser, doing it here helps compress the incoming data into Grbl's
-    // line buffer, which is limited in size. The g-code standard actually states a line can't
-    // exceed 256 characters, but the Arduino Uno does not have the memory space for this.
-    // With a better processor, it would be very easy to pull this initial parsing out as a
-    // seperate task to be shared by the g-code parser and Grbl's system commands.
-
-    while ((c = serial_read()) != SERIAL_NO_DATA)
+    if (line_count)
     {
-      if ((c == '\n') || (c == '\r'))
-      {                         // End of line reached
-        line[char_counter] = 0; // Set string termination character.
+      char *line = line_buffer[line_tail];
 
-        printString((line));
-        //http://home.eeworld.com.cn/forum.php?mod=viewthread&tid=607191&extra=page%3D1
+      printString((line));
+      //http://home.eeworld.com.cn/forum.php?mod=viewthread&tid=607191&extra=page%3D1
 
+      uint8_t status = line_status[line_tail];
+      if (status == STATUS_OK)
+      {
         protocol_execute_line(line); // Line is complete. Execute it!
-        comment = COMMENT_NONE;
-        char_counter = 0;
       }
-      else
-      {
-        if (comment != COMMENT_NONE)
+      #ifdef LINE_CHECKSUM
+        else if (status != STATUS_OVERFLOW)
         {
-          // Throw away all comment characters
-          if (c == ')')
-          {
-            // End of comment. Resume line. But, not if semicolon type comment.
-            if (comment == COMMENT_TYPE_PARENTHESES)
-            {
-              comment = COMMENT_NONE;
-            }
-          }
-        }
-        else
-        {
-          if (c <= ' ')
-          {
-            // Throw away whitepace and control characters
-          }
-          else if (c == '/')
-          {
-            // Block delete NOT SUPPORTED. Ignore character.
-            // NOTE: If supported, would simply need to check the system if block delete is enabled.
-          }
-          else if (c == '(')
-          {
-            // Enable comments flag and ignore all characters until ')' or EOL.
-            // NOTE: This doesn't follow the NIST definition exactly, but is good enough for now.
-            // In the future, we could simply remove the items within the comments, but retain the
-            // comment control characters, so that the g-code parser can error-check it.
-            comment = COMMENT_TYPE_PARENTHESES;
-          }
-          else if (c == ';')
-          {
-            // NOTE: ';' comment to EOL is a LinuxCNC definition. Not NIST.
-            comment = COMMENT_TYPE_SEMICOLON;
-
-            // TODO: Install '%' feature
-            // } else if (c == '%') {
-            // Program start-end percent sign NOT SUPPORTED.
-            // NOTE: This maybe installed to tell Grbl when a program is running vs manual input,
-            // where, during a program, the system auto-cycle start will continue to execute
-            // everything until the next '%' sign. This will help fix resuming issues with certain
-            // functions that empty the planner buffer to execute its task on-time.
-          }
-          else if (char_counter >= (LINE_BUFFER_SIZE - 1))
-          {
-            // Detect line buffer overflow. Report error and reset line buffer.
-            //TODO report_status_message(STATUS_OVERFLOW);
-            comment = COMMENT_NONE;
-            char_counter = 0;
-          }
-          else if (c >= 'a' && c <= 'z')
-          { // Upcase lowercase
-            line[char_counter++] = c - 'a' + 'A';
-          }
-          else
-          {
-            line[char_counter++] = c;
-          }
+          report_resend_request(status, line_resend[line_tail]);
         }
+      #endif
+      else
+      {
+        report_status_message(status);
       }
+
+      // Release the slot. Only now may the assembler reuse it.
+      if (++line_tail == LINE_BUFFER_COUNT) { line_tail = 0; }
+      line_count--;
+      load_loop(0);
+      continue;
     }
 
     // If there are no more characters in the serial read buffer to be processed and executed,
@@ -179,8 +502,11 @@ void protocol_main_loop()
     // completed. In either case, auto-cycle start, if enabled, any queued moves.
     protocol_auto_cycle_start();
 
+    trace_drain(); // Idle: send buffered trace records, if TX has room.
+
     protocol_execute_realtime(); // Runtime command check point.
     //TODO if (sys.abort) { return; } // Bail to main() program loop to reset system.
+    load_loop(1);
   }
 
   return; /* Never reached */
@@ -190,8 +516,13 @@ int main()
 {
   // Initialize system upon power-up.
   serial_init(); // Setup serial baud rate and interrupts
+  profile_init(); // Sampling profiler on Timer2, with PROFILE
+  load_init();    // CPU load time base on Timer2, with LOAD_METER
   sei();         // Enable interrupts
   // Write your code here
+#ifdef BENCH
+  benchTest(); // make benchmark: cycle counts of the hot paths, never returns
+#endif
   // Start main loop. Processes program inputs and executes them.
   //protocol_main_loop();
   // extintTest();
@@ -0,0 +1,505 @@
+/*
+  planner.c - buffers movement commands and manages the acceleration profile plan
+  Part of Grbl
+
+  Copyright (c) 2011-2015 Sungeun K. Jeon
+  Copyright (c) 2009-2011 Simen Svale Skogsrud
+  Copyright (c) 2011 Jens Geisler
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include "planner.h"
+#include "../serial/serial.h"
+#include "../trace/trace.h"
+#include <avr/interrupt.h>
+
+#ifndef min
+  #define min(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+  #define max(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define SOME_LARGE_VALUE 1.0E+38 // Used by rate and acceleration limiting
+
+static plan_block_t block_buffer[BLOCK_BUFFER_SIZE];  // A ring buffer for motion instructions
+static uint8_t block_buffer_tail;     // Index of the block to process now
+static uint8_t block_buffer_head;     // Index of the next block to be pushed
+static uint8_t next_buffer_head;      // Index of the next buffer head
+static uint8_t block_buffer_planned;  // Index of the optimally planned block
+
+// Define planner variables
+typedef struct {
+  int32_t position[N_AXIS];          // The planner position of the tool in absolute steps. Kept separate
+                                     // from g-code position for movements requiring multiple line motions,
+                                     // i.e. arcs, canned cycles, and backlash compensation.
+  float previous_unit_vec[N_AXIS];   // Unit vector of previous path line segment
+  float previous_nominal_speed_sqr;  // Nominal speed of previous path line segment
+} planner_t;
+static planner_t pl;
+
+// Segment preparation data struct. Contains all the necessary information to compute new segments
+// based on the current executing planner block.
+typedef struct {
+  uint8_t active;          // Set while the tail block is being converted into segments.
+  uint8_t st_block_index;  // Index of the stepper block data of the tail block.
+  uint8_t hold;            // Feed hold: plan to zero speed and stop preparing there.
+  float step_per_mm;
+  float steps_remaining;
+  float current_speed;     // Speed at the end of the last prepared segment (mm/min).
+  float dt_carry;          // Time of segments too short to hold a step (min).
+} st_prep_t;
+static st_prep_t prep;
+
+static const float steps_per_mm[N_AXIS] = {
+  DEFAULT_X_STEPS_PER_MM, DEFAULT_Y_STEPS_PER_MM, DEFAULT_Z_STEPS_PER_MM };
+static const float max_rate[N_AXIS] = {
+  DEFAULT_X_MAX_RATE, DEFAULT_Y_MAX_RATE, DEFAULT_Z_MAX_RATE };
+static const float acceleration[N_AXIS] = {
+  DEFAULT_X_ACCELERATION, DEFAULT_Y_ACCELERATION, DEFAULT_Z_ACCELERATION };
+
+
+// Returns the index of the next block in the ring buffer. Also called by stepper segment buffer.
+static uint8_t plan_next_block_index(uint8_t block_index)
+{
+  block_index++;
+  if (block_index == BLOCK_BUFFER_SIZE) { block_index = 0; }
+  return(block_index);
+}
+
+
+// Returns the index of the previous block in the ring buffer
+static uint8_t plan_prev_block_index(uint8_t block_index)
+{
+  if (block_index == 0) { block_index = BLOCK_BUFFER_SIZE; }
+  block_index--;
+  return(block_index);
+}
+
+
+/*                            PLANNER SPEED DEFINITION
+                                     +--------+   <- current->nominal_speed
+                                    /          \
+         current->entry_speed ->   +            \
+                                   |             + <- next->entry_speed (aka exit speed)
+                                   +-------------+
+                                       time -->
+
+  Recalculates the motion plan according to the following basic guidelines:
+
+    1. Go over every feasible block sequentially in reverse order and calculate the junction speeds
+        (i.e. current->entry_speed) such that:
+      a. No junction speed exceeds the pre-computed maximum junction speed limit or nominal speeds of
+         neighboring blocks.
+      b. A block entry speed cannot exceed one reverse-computed from its exit speed (next->entry_speed)
+         with a maximum allowable deceleration over the block travel distance.
+      c. The last (or newest appended) block is planned from a complete stop (an exit speed of zero).
+    2. Go over every block in chronological (forward) order and dial down junction speed values if
+      a. The exit speed exceeds the one forward-computed from its entry speed with the maximum allowable
+         acceleration over the block travel distance.
+
+  When these stages are complete, the planner will have maximized the velocity profiles throughout the all
+  of the planner blocks, where every block is operating at its maximum allowable acceleration limits. In
+  other words, for all of the blocks in the planner, the plan is optimal and no further speed improvements
+  are possible. If a new block is added to the buffer, the plan is recomputed according to the said
+  guidelines for a new optimal plan.
+
+  To increase computational efficiency of these guidelines, a set of planner block pointers have been
+  created to indicate stop-compute points for when the planner guidelines cannot logically make any further
+  changes or improvements to the plan when in normal operation and new blocks are streamed and added to the
+  planner buffer. For example, if a subset of sequential blocks in the planner have been planned and are
+  bracketed by junction velocities at their maximums (or by the first planner block as well), no new block
+  added to the planner buffer will alter the velocity profiles within them. So we no longer have to compute
+  them. Or, if a set of sequential blocks from the first block in the planner (or a optimal stop-compute
+  point) are all accelerating, they are all optimal and can not be altered by a new block added to the
+  planner buffer, as this will only further increase the plan speed to chronological blocks until a maximum
+  junction velocity is reached. However, if the operational conditions of the plan changes from infrequently
+  used feed holds or feedrate overrides, the stop-compute pointers will be reset and the entire plan is
+  recomputed as stated in the general guidelines.
+
+  The tail block is being executed while the plan changes. plan_prep_buffer() keeps its entry speed and
+  millimeters at the actual speed and remaining distance, so the forward pass always starts from where the
+  machine really is.
+*/
+static void planner_recalculate()
+{
+  // Initialize block index to the last block in the planner buffer.
+  uint8_t block_index = plan_prev_block_index(block_buffer_head);
+
+  // Bail. Can't do anything with one only one plan-able block.
+  if (block_index == block_buffer_planned) { return; }
+
+  // Reverse Pass: Coarsely maximize all possible deceleration curves back-planning from the last
+  // block in buffer. Cease planning when the last optimal planned or tail pointer is reached.
+  // NOTE: Forward pass will later refine and correct the reverse pass to create an optimal plan.
+  float entry_speed_sqr;
+  plan_block_t *next;
+  plan_block_t *current = &block_buffer[block_index];
+
+  // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
+  current->entry_speed_sqr = min(current->max_entry_speed_sqr, 2*current->acceleration*current->millimeters);
+
+  block_index = plan_prev_block_index(block_index);
+  while (block_index != block_buffer_planned) {
+    next = current;
+    current = &block_buffer[block_index];
+    block_index = plan_prev_block_index(block_index);
+
+    // Compute maximum entry speed decelerating over the current block from its exit speed.
+    if (current->entry_speed_sqr != current->max_entry_speed_sqr) {
+      entry_speed_sqr = next->entry_speed_sqr + 2*current->acceleration*current->millimeters;
+      if (entry_speed_sqr < current->max_entry_speed_sqr) {
+        current->entry_speed_sqr = entry_speed_sqr;
+      } else {
+        current->entry_speed_sqr = current->max_entry_speed_sqr;
+      }
+    }
+  }
+
+  // Forward Pass: Forward plan the acceleration curve from the planned pointer onward.
+  // Also scans for optimal plan breakpoints and appropriately updates the planned pointer.
+  next = &block_buffer[block_buffer_planned]; // Begin at buffer planned pointer
+  block_index = plan_next_block_index(block_buffer_planned);
+  while (block_index != block_buffer_head) {
+    current = next;
+    next = &block_buffer[block_index];
+
+    // Any acceleration detected in the forward pass automatically moves the optimal planned
+    // pointer forward, since everything before this is all optimal. In other words, nothing
+    // can improve the plan from the buffer tail to the planned pointer by logic.
+    if (current->entry_speed_sqr < next->entry_speed_sqr) {
+      entry_speed_sqr = current->entry_speed_sqr + 2*current->acceleration*current->millimeters;
+      // If true, current block is full-acceleration and we can move the planned pointer forward.
+      if (entry_speed_sqr < next->entry_speed_sqr) {
+        next->entry_speed_sqr = entry_speed_sqr; // Always <= max_entry_speed_sqr. Backward pass sets this.
+        block_buffer_planned = block_index; // Set optimal plan pointer.
+      }
+    }
+
+    // Any block set at its maximum entry speed also creates an optimal plan up to this
+    // point in the buffer. When the plan is bracketed by either the beginning of the
+    // buffer and a maximum entry speed or two maximum entry speeds, every block in between
+    // cannot logically be further improved. Hence, we don't have to recompute them anymore.
+    if (next->entry_speed_sqr == next->max_entry_speed_sqr) { block_buffer_planned = block_index; }
+    block_index = plan_next_block_index( block_index );
+  }
+}
+
+
+void plan_reset()
+{
+  memset(&pl, 0, sizeof(pl)); // Clear planner struct
+  memset(&prep, 0, sizeof(prep));
+  block_buffer_tail = 0;
+  block_buffer_head = 0; // Empty = tail
+  next_buffer_head = 1; // plan_next_block_index(block_buffer_head)
+  block_buffer_planned = 0; // = block_buffer_tail;
+}
+
+
+void plan_discard_current_block()
+{
+  if (block_buffer_head != block_buffer_tail) { // Discard non-empty buffer.
+    uint8_t block_index = plan_next_block_index( block_buffer_tail );
+    // Push block_buffer_planned pointer, if encountered.
+    if (block_buffer_tail == block_buffer_planned) { block_buffer_planned = block_index; }
+    block_buffer_tail = block_index;
+  }
+}
+
+
+plan_block_t *plan_get_current_block()
+{
+  if (block_buffer_head == block_buffer_tail) { return(NULL); } // Buffer empty
+  return(&block_buffer[block_buffer_tail]);
+}
+
+
+uint8_t plan_get_block_buffer_available()
+{
+  return((BLOCK_BUFFER_SIZE-1) - plan_get_block_buffer_count());
+}
+
+
+// Returns the availability status of the block ring buffer. True, if full.
+uint8_t plan_check_full_buffer()
+{
+  if (block_buffer_tail == next_buffer_head) { return(1); }
+  return(0);
+}
+
+
+uint8_t plan_get_block_buffer_count()
+{
+  if (block_buffer_head >= block_buffer_tail) { return(block_buffer_head-block_buffer_tail); }
+  return(BLOCK_BUFFER_SIZE - (block_buffer_tail-block_buffer_head));
+}
+
+
+/* Add a new linear movement to the buffer. target[N_AXIS] is the signed, absolute target position
+   in millimeters. Feed rate specifies the speed of the motion.
+   All position data passed to the planner must be in terms of machine position to keep the planner
+   independent of any coordinate system changes and offsets, which are handled by the g-code parser.
+   NOTE: Assumes buffer is available. Buffer checks are handled at a higher level by motion_control.
+   In other words, the buffer head is never equal to the buffer tail. */
+void plan_buffer_line(float *target, float feed_rate)
+{
+  // Prepare and initialize new block
+  plan_block_t *block = &block_buffer[block_buffer_head];
+  memset(block, 0, sizeof(plan_block_t)); // Zero all block values.
+
+  // Compute and store initial move distance data.
+  int32_t target_steps[N_AXIS];
+  float unit_vec[N_AXIS], delta_mm;
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) {
+    // Calculate target position in absolute steps, number of steps for each axis, and determine max step events.
+    target_steps[idx] = lround(target[idx]*steps_per_mm[idx]);
+    block->steps[idx] = target_steps[idx]-pl.position[idx];
+    block->step_event_count = max(block->step_event_count, (uint32_t)labs(block->steps[idx]));
+    delta_mm = block->steps[idx]/steps_per_mm[idx];
+    unit_vec[idx] = delta_mm; // Store unit vector numerator. Denominator computed later.
+    block->millimeters += delta_mm*delta_mm;
+  }
+  block->millimeters = sqrt(block->millimeters); // Complete millimeters calculation with sqrt()
+
+  // Bail if this is a zero-length block. Highly unlikely to occur.
+  if (block->step_event_count == 0) { return; }
+
+  // Adjust feed_rate value to mm/min depending on type of rate input (normal, inverse time, or rapids)
+  if (feed_rate < MINIMUM_FEED_RATE) { feed_rate = MINIMUM_FEED_RATE; }
+
+  // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled
+  // down such that no individual axes maximum values are exceeded with respect to the line direction.
+  // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
+  // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
+  float inverse_unit_vec_value;
+  float inverse_millimeters = 1.0/block->millimeters;  // Inverse millimeters to remove multiple float divides
+  float junction_cos_theta = 0;
+  block->acceleration = SOME_LARGE_VALUE; // Scaled down to maximum acceleration later
+  for (idx=0; idx<N_AXIS; idx++) {
+    if (unit_vec[idx] != 0) {  // Avoid divide by zero.
+      unit_vec[idx] *= inverse_millimeters;  // Complete unit vector calculation
+      inverse_unit_vec_value = fabs(1.0/unit_vec[idx]); // Inverse to remove multiple float divides.
+
+      // Check and limit feed rate against max individual axis velocities and accelerations
+      feed_rate = min(feed_rate,max_rate[idx]*inverse_unit_vec_value);
+      block->acceleration = min(block->acceleration,acceleration[idx]*inverse_unit_vec_value);
+
+      // Incrementally compute cosine of angle between previous and current path. Cos(theta) of the junction
+      // between the current move and the previous move is simply the dot product of the two unit vectors,
+      // where prev_unit_vec is negative. Used later to compute maximum junction speed.
+      junction_cos_theta -= pl.previous_unit_vec[idx] * unit_vec[idx];
+    }
+  }
+
+  /* Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
+     Let a circle be tangent to both previous and current path line segments, where the junction
+     deviation is defined as the distance from the junction to the closest edge of the circle,
+     colinear with the circle center. The circular segment joining the two paths represents the
+     path of centripetal acceleration. Solve for max velocity based on max acceleration about the
+     radius of the circle, defined indirectly by junction deviation. This may be also viewed as
+     path width or max_jerk in the previous Grbl version. This approach does not actually deviate
+     from path, but used as a robust way to compute cornering speeds, as it takes into account the
+     nonlinearities of both the junction angle and junction velocity.
+     NOTE: If the junction deviation value is finite, Grbl executes the motions in an exact path
+     mode (G61). If the junction deviation value is zero, Grbl will execute the motion in an exact
+     stop mode (G61.1) manner. In the future, if continuous mode (G64) is desired, the math here
+     is exactly the same. Instead of motioning all the way to junction point, the machine will
+     just follow the arc circle defined here. The Arduino doesn't have the CPU cycles to perform
+     a continuous mode path, but ARM-based microcontrollers most certainly do.
+  */
+  if (block_buffer_head == block_buffer_tail) {
+    // Initialize block entry speed as zero. Assume it will be starting from rest. Planner will correct this later.
+    block->max_junction_speed_sqr = 0.0;
+  } else {
+    // NOTE: Computed without any expensive trig, sin() or acos(), by trig half angle identity of cos(theta).
+    if (junction_cos_theta > 0.999999) {
+      //  For a 0 degree acute junction, just set minimum junction speed.
+      block->max_junction_speed_sqr = MINIMUM_JUNCTION_SPEED*MINIMUM_JUNCTION_SPEED;
+    } else {
+      junction_cos_theta = max(junction_cos_theta,-0.999999); // Check for numerical round-off to avoid divide by zero.
+      float sin_theta_d2 = sqrt(0.5*(1.0-junction_cos_theta)); // Trig half angle identity. Always positive.
+
+      // TODO: Technically, the acceleration used in calculation needs to be limited by the minimum of the
+      // two junctions. However, this shouldn't be a significant problem except in extreme circumstances.
+      block->max_junction_speed_sqr = max( MINIMUM_JUNCTION_SPEED*MINIMUM_JUNCTION_SPEED,
+                                 (block->acceleration * DEFAULT_JUNCTION_DEVIATION * sin_theta_d2)/(1.0-sin_theta_d2) );
+    }
+  }
+
+  // Store block nominal speed
+  block->nominal_speed_sqr = feed_rate*feed_rate; // (mm/min). Always > 0
+
+  // Compute the junction maximum entry based on the minimum of the junction speed and neighboring nominal speeds.
+  block->max_entry_speed_sqr = min(block->max_junction_speed_sqr,
+                                   min(block->nominal_speed_sqr,pl.previous_nominal_speed_sqr));
+
+  // Update previous path unit_vector and nominal speed (squared)
+  memcpy(pl.previous_unit_vec, unit_vec, sizeof(unit_vec)); // pl.previous_unit_vec[] = unit_vec[]
+  pl.previous_nominal_speed_sqr = block->nominal_speed_sqr;
+
+  // Update planner position
+  memcpy(pl.position, target_steps, sizeof(target_steps)); // pl.position[] = target_steps[]
+
+  // New block is all set. Update buffer head and next buffer head indices.
+  block_buffer_head = next_buffer_head;
+  next_buffer_head = plan_next_block_index(block_buffer_head);
+
+  // Finish up by recalculating the plan with the new block.
+  planner_recalculate();
+  rt_exec_set(EXEC_PREP_BUFFER); // Let the realtime loop cut it into segments.
+  TRACE1(TR_PLAN_BLOCK, plan_get_block_buffer_count());
+}
+
+
+// Reset the planner position vectors. Called by the system abort/initialization routine.
+void plan_sync_position()
+{
+  st_get_position(pl.position);
+}
+
+
+/* Prepares step segments from the planner blocks and queues them to the stepper segment ring.
+   Each segment covers DT_SEGMENT of time (or the rest of the block) at a constant step rate.
+   The speed profile is integrated segment by segment from the actual current speed: accelerate
+   towards the nominal speed, but never past the peak from which the block exit speed (the next
+   block's planned entry speed) is still reachable, and decelerate once the remaining distance
+   only just allows it. Because the exit speed is re-read for every segment, blocks appended
+   while this block executes raise its exit speed without any extra bookkeeping.
+   NOTE: Called from the main program only, on EXEC_PREP_BUFFER. Cheap when the segment ring is full. */
+void plan_prep_buffer()
+{
+  while (st_segment_buffer_available()) {
+    plan_block_t *pl_block = plan_get_current_block();
+    if (pl_block == NULL) { return; } // No planner blocks. Exit.
+
+    if (!prep.active) {
+      if (prep.hold && prep.current_speed <= 0.0) { return; } // Held at rest.
+      int8_t idx = st_push_block(pl_block->steps);
+      if (idx < 0) { return; }
+      prep.st_block_index = idx;
+      prep.steps_remaining = pl_block->step_event_count;
+      prep.step_per_mm = prep.steps_remaining/pl_block->millimeters;
+      prep.current_speed = min(prep.current_speed, sqrt(pl_block->entry_speed_sqr));
+      prep.active = 1;
+    }
+    if (prep.hold && prep.current_speed <= 0.0) { return; } // Feed hold complete.
+
+    float v = prep.current_speed;
+    float v_end;
+    float mm_remaining = pl_block->millimeters;
+    float exit_speed_sqr = 0.0;
+    if (!prep.hold) {
+      uint8_t next_index = plan_next_block_index(block_buffer_tail);
+      if (next_index != block_buffer_head) { exit_speed_sqr = block_buffer[next_index].entry_speed_sqr; }
+    }
+    float accel_dv = pl_block->acceleration*DT_SEGMENT;
+    float decel_dist = (v*v - exit_speed_sqr)/(2*pl_block->acceleration);
+
+    if (prep.hold || decel_dist >= mm_remaining) {
+      // Deceleration ramp
+      v_end = v - accel_dv;
+      float v_floor = sqrt(exit_speed_sqr);
+      if (v_end < v_floor) { v_end = v_floor; }
+    } else {
+      float nominal_speed = sqrt(pl_block->nominal_speed_sqr);
+      if (v < nominal_speed) {
+        // Acceleration ramp, capped at the peak of the accelerate/decelerate triangle.
+        float v_peak = sqrt(0.5*(v*v + exit_speed_sqr) + pl_block->acceleration*mm_remaining);
+        v_end = min(v + accel_dv, min(nominal_speed, v_peak));
+      } else {
+        // Cruise, or slow down to a lowered nominal speed.
+        v_end = max(v - accel_dv, nominal_speed);
+      }
+    }
+
+    float dt = DT_SEGMENT;
+    float mm_segment = 0.5*(v + v_end)*dt;
+    uint8_t last = 0;
+    if (mm_segment >= mm_remaining) {
+      mm_segment = mm_remaining;
+      if (v + v_end > 0.0) { dt = 2*mm_remaining/(v + v_end); }
+      last = 1;
+    }
+
+    // Steps are taken by the ceiling of the remaining step count, so the segments of a block
+    // always sum to its step_event_count without drift.
+    float steps_remaining = last ? 0.0 : (mm_remaining - mm_segment)*prep.step_per_mm;
+    uint16_t n_step = ceil(prep.steps_remaining) - ceil(steps_remaining);
+    prep.dt_carry += dt;
+    prep.current_speed = v_end;
+    pl_block->entry_speed_sqr = v_end*v_end;
+    pl_block->millimeters = mm_remaining - mm_segment;
+
+    if (n_step == 0) {
+      // Too slow for a single step in this segment. Carry the time into the next one.
+      if (prep.hold && v_end <= 0.0) { return; }
+      continue;
+    }
+
+    float cycles = ceil(prep.dt_carry*(F_CPU*60.0)/n_step);
+    if (cycles > 0xffffffffUL) { cycles = 0xffffffffUL; }
+    st_push_segment(prep.st_block_index, n_step, (uint32_t)cycles); // Ring checked above.
+    prep.steps_remaining = steps_remaining;
+    prep.dt_carry = 0.0;
+
+    if (last) {
+      prep.active = 0;
+      plan_discard_current_block();
+    }
+  }
+}
+
+
+uint8_t plan_feed_hold()
+{
+  if (plan_get_current_block() == NULL) { return 0; } // Nothing to hold
+  prep.hold = 1;
+  rt_exec_set(EXEC_PREP_BUFFER);
+  return 1;
+}
+
+
+uint8_t plan_is_held() { return(prep.hold); }
+
+
+uint8_t plan_cycle_start()
+{
+  uint8_t resumed = 1;
+  if (prep.hold) {
+    if ((st_get_state() != ST_STATE_IDLE) || ((prep.current_speed > 0.0) && plan_get_current_block())) {
+      // Still decelerating. The ring holds segments at speed, which a replan from rest would
+      // follow with a jump to 0. Only keep the stop going, should the ring have run dry.
+      resumed = 0;
+    } else {
+      // Replan the whole buffer from rest.
+      prep.hold = 0;
+      prep.current_speed = 0.0;
+      plan_block_t *pl_block = plan_get_current_block();
+      if (pl_block != NULL) {
+        pl_block->entry_speed_sqr = 0.0;
+        block_buffer_planned = block_buffer_tail;
+        planner_recalculate();
+      }
+    }
+  }
+  plan_prep_buffer();
+  st_cycle_start();
+  return resumed;
+}
@@ -0,0 +1,129 @@
+/*
+  planner.h - buffers movement commands and manages the acceleration profile plan
+  Part of Grbl
+
+  Copyright (c) 2011-2015 Sungeun K. Jeon
+  Copyright (c) 2009-2011 Simen Svale Skogsrud
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef planner_h
+#define planner_h
+#include <avr/io.h>
+#include "../stepper/stepper.h"
+
+// The number of linear motions that can be in the plan at any give time
+#ifndef BLOCK_BUFFER_SIZE
+  #define BLOCK_BUFFER_SIZE 12
+#endif
+
+// Machine settings. Grbl keeps these in EEPROM settings; here they are build time defaults.
+#ifndef DEFAULT_X_STEPS_PER_MM
+  #define DEFAULT_X_STEPS_PER_MM 250.0
+  #define DEFAULT_Y_STEPS_PER_MM 250.0
+  #define DEFAULT_Z_STEPS_PER_MM 250.0
+#endif
+#ifndef DEFAULT_X_MAX_RATE
+  #define DEFAULT_X_MAX_RATE 500.0 // mm/min
+  #define DEFAULT_Y_MAX_RATE 500.0 // mm/min
+  #define DEFAULT_Z_MAX_RATE 500.0 // mm/min
+#endif
+#ifndef DEFAULT_X_ACCELERATION
+  #define DEFAULT_X_ACCELERATION (10.0*60*60) // 10*60*60 mm/min^2 = 10 mm/sec^2
+  #define DEFAULT_Y_ACCELERATION (10.0*60*60) // 10*60*60 mm/min^2 = 10 mm/sec^2
+  #define DEFAULT_Z_ACCELERATION (10.0*60*60) // 10*60*60 mm/min^2 = 10 mm/sec^2
+#endif
+#ifndef DEFAULT_JUNCTION_DEVIATION
+  #define DEFAULT_JUNCTION_DEVIATION 0.01 // mm
+#endif
+
+// Minimum planner junction speed. Sets the default minimum junction speed the planner plans to at
+// every buffer block junction, except for starting from rest and end of the buffer, which are always
+// zero. This value controls how fast the machine moves through junctions with no regard for acceleration
+// limits or angle between neighboring block line move directions.
+#define MINIMUM_JUNCTION_SPEED 0.0 // (mm/min)
+
+// Sets the minimum feed rate the planner will allow. Any value below it will be set to this minimum
+// value. This also ensures that a planned motion always completes and accounts for any floating-point
+// round-off errors.
+#define MINIMUM_FEED_RATE 1.0 // (mm/min)
+
+// Time length of one step segment prepared by plan_prep_buffer(). The velocity profile is
+// approximated with segments of this length, each at a constant step rate.
+#define ACCELERATION_TICKS_PER_SECOND 100
+#define DT_SEGMENT (1.0/(ACCELERATION_TICKS_PER_SECOND*60.0)) // min/segment
+
+// This struct stores a linear movement of a g-code block motion with its critical "nominal" values
+// are as specified in the source g-code.
+typedef struct {
+  // Fields used by the bresenham algorithm for tracing the line
+  // NOTE: Used by stepper algorithm to execute the block correctly. Do not alter these values.
+  int32_t steps[N_AXIS];    // Signed step count along each axis
+  uint32_t step_event_count; // The maximum step axis count and number of steps required to complete this block.
+
+  // Fields used by the motion planner to manage acceleration
+  float entry_speed_sqr;         // The current planned entry speed at block junction in (mm/min)^2
+  float max_entry_speed_sqr;     // Maximum allowable entry speed based on the minimum of junction limit and
+                                 //   neighboring nominal speeds with overrides in (mm/min)^2
+  float max_junction_speed_sqr;  // Junction entry speed limit based on direction vectors in (mm/min)^2
+  float nominal_speed_sqr;       // Axis-limit adjusted nominal speed for this block in (mm/min)^2
+  float acceleration;            // Axis-limit adjusted line acceleration in (mm/min^2)
+  float millimeters;             // The remaining distance for this block to be executed in (mm)
+} plan_block_t;
+
+
+// Initialize and reset the motion plan subsystem
+void plan_reset();
+
+// Add a new linear movement to the buffer. target[N_AXIS] is the signed, absolute target position
+// in millimeters. Feed rate specifies the speed of the motion.
+// NOTE: The buffer must not be full, see plan_check_full_buffer().
+void plan_buffer_line(float *target, float feed_rate);
+
+// Called when the current block is no longer needed. Discards the block and makes the memory
+// availible for new blocks.
+void plan_discard_current_block();
+
+// Gets the current block. Returns NULL if buffer empty
+plan_block_t *plan_get_current_block();
+
+// Reset the planner position vector (in steps)
+void plan_sync_position();
+
+// Returns the number of active blocks are in the planner buffer.
+uint8_t plan_get_block_buffer_count();
+
+// Returns the number of blocks that can still be added before the buffer is full.
+uint8_t plan_get_block_buffer_available();
+
+// Returns the status of the block ring buffer. True, if buffer is full.
+uint8_t plan_check_full_buffer();
+
+// Fills the stepper segment ring from the planned blocks. Called from the main program on
+// EXEC_PREP_BUFFER, which the stepper interrupt raises whenever it frees a segment.
+void plan_prep_buffer();
+
+// Decelerate the running motion to a stop, keeping the remaining plan. Called on EXEC_FEED_HOLD.
+// Returns false when there was no block to hold.
+uint8_t plan_feed_hold();
+
+// Replan from rest after a feed hold and restart the steppers. Called on EXEC_CYCLE_START.
+// Returns false, changing nothing, while a feed hold is still stopping.
+uint8_t plan_cycle_start();
+
+// Returns true while a feed hold is active.
+uint8_t plan_is_held();
+
+#endif
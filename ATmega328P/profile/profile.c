@@ -0,0 +1,113 @@
+/*
+  profile.c - Statistical sampling profiler, see profile.h
+*/
+
+#include "profile.h"
+
+#ifdef PROFILE
+
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "../timerx8/timercalc.h"
+#include "../util/print.h"
+
+#define PROFILE_CYCLES TIMER_CYCLES_HZ(PROFILE_HZ)
+TIMER2_CTC_ASSERT(PROFILE_CYCLES, 1000);
+_Static_assert(PROFILE_BINS >= 2 && PROFILE_BINS <= 256, "PROFILE_BINS must be 2 to 256");
+
+extern char _etext; // End of the program text, from the linker script
+
+static uint16_t profile_bins[PROFILE_BINS];
+static uint8_t profile_shift; // log2 of the flash words per bin
+
+// Counts one sample. pc is the interrupted word address. Called from the sample ISR only.
+void profile_sample(uint16_t pc) __attribute__((used));
+void profile_sample(uint16_t pc)
+{
+  uint16_t bin = pc >> profile_shift;
+  if (bin >= PROFILE_BINS) { bin = PROFILE_BINS - 1; }
+  if (++profile_bins[bin] == 0xffff) { TIMSK2 &= ~(1<<OCIE2A); } // Full, stop until reported
+}
+
+// The return address sits right above the registers pushed so far, high byte first, so the
+// ISR has to be naked to know where. It saves what the C function may clobber and calls it.
+ISR(TIMER2_COMPA_vect, ISR_NAKED)
+{
+  __asm__ volatile (
+    "push r24\n"
+    "in r24, __SREG__\n"
+    "push r24\n"
+    "push r25\n"
+    "push r30\n"
+    "push r31\n"
+    "in r30, __SP_L__\n"
+    "in r31, __SP_H__\n"
+    "ldd r25, Z+6\n" // Five bytes pushed: PC high at SP+6, low at SP+7
+    "ldd r24, Z+7\n"
+    "push r0\n"
+    "push r1\n"
+    "clr r1\n"
+    "push r18\n"
+    "push r19\n"
+    "push r20\n"
+    "push r21\n"
+    "push r22\n"
+    "push r23\n"
+    "push r26\n"
+    "push r27\n"
+    "%~call profile_sample\n"
+    "pop r27\n"
+    "pop r26\n"
+    "pop r23\n"
+    "pop r22\n"
+    "pop r21\n"
+    "pop r20\n"
+    "pop r19\n"
+    "pop r18\n"
+    "pop r1\n"
+    "pop r0\n"
+    "pop r31\n"
+    "pop r30\n"
+    "pop r25\n"
+    "pop r24\n"
+    "out __SREG__, r24\n"
+    "pop r24\n"
+    "reti\n"
+    ::);
+}
+
+void profile_init()
+{
+  uint16_t words = (uint16_t)&_etext / 2;
+
+  while (((words - 1) >> profile_shift) >= PROFILE_BINS) { profile_shift++; }
+  TCCR2A = (1<<WGM21); // CTC, TOP in OCR2A
+  TCCR2B = TIMER2_CTC_PRESCALER(PROFILE_CYCLES);
+  OCR2A = TIMER2_CTC_TOP(PROFILE_CYCLES);
+  TCNT2 = 0;
+  TIFR2 = (1<<OCF2A);
+  TIMSK2 = (1<<OCIE2A);
+}
+
+void profile_report()
+{
+  uint32_t samples = 0;
+  uint16_t bin;
+  uint8_t n = 0;
+
+  TIMSK2 &= ~(1<<OCIE2A); // Hold sampling, the report is not part of the profile
+  for (bin = 0; bin < PROFILE_BINS; bin++) { samples += profile_bins[bin]; }
+  printPgmFormat(PSTR("[PROF:%u,%u,%lu]\r\n"), PROFILE_HZ, profile_shift, samples);
+  for (bin = 0; bin < PROFILE_BINS; bin++) {
+    if (profile_bins[bin] == 0) { continue; }
+    printPgmFormat(n ? PSTR(",%u=%u") : PSTR("[PBIN:%u=%u"), bin, profile_bins[bin]);
+    profile_bins[bin] = 0;
+    if (++n == 8) { printPgmString(PSTR("]\r\n")); n = 0; }
+  }
+  if (n) { printPgmString(PSTR("]\r\n")); }
+  TCNT2 = 0;
+  TIFR2 = (1<<OCF2A);
+  TIMSK2 |= (1<<OCIE2A);
+}
+
+#endif
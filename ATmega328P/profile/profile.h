@@ -0,0 +1,45 @@
+/*
+  profile.h - Statistical sampling profiler
+
+  Enabled with -DPROFILE. A Timer2 compare interrupt runs PROFILE_HZ times a second, takes the
+  return address of the interrupted code off the stack and counts it in a histogram of
+  PROFILE_BINS bins, each covering 2^shift flash words. profile_init() picks the smallest shift
+  that spreads the program text (up to _etext) over the bins; samples above it (a bootloader,
+  say) count in the last bin. Timer2 then belongs to the profiler: timerx8.c leaves
+  TIMER2_COMPA_vect alone, and dds.c or anything else on Timer2 can not be used alongside.
+
+  The sample interrupt only runs with interrupts enabled, so time in other ISRs and in cli()
+  sections is charged to the instruction they return to. A bin that reaches 0xffff stops the
+  sampling, so the counts stay proportional; at 2 kHz that is after 30 s in a single bin.
+
+  CMD_PROFILE_REPORT prints the histogram and clears it, so each report covers the time since
+  the previous one:
+    [PROF:<hz>,<shift>,<samples>]
+    [PBIN:<bin>=<count>,<bin>=<count>,...]   nonzero bins, up to eight per line
+  tools/profiler.py requests it and maps the bins to the functions in the ELF.
+*/
+
+#ifndef profile_h
+#define profile_h
+#include <avr/io.h>
+
+#ifndef PROFILE_HZ
+  #define PROFILE_HZ 2000
+#endif
+
+// Histogram size, two bytes of SRAM each.
+#ifndef PROFILE_BINS
+  #define PROFILE_BINS 128
+#endif
+
+#ifdef PROFILE
+  // Sets up Timer2 and starts sampling.
+  void profile_init();
+
+  // Prints the histogram and starts a new one. Main loop only.
+  void profile_report();
+#else
+  #define profile_init()
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+/*
+  pt.c - Protothread clock and timers, see pt.h
+*/
+
+#include <avr/interrupt.h>
+#include "pt.h"
+#include "../timerx8/timerx8.h"
+
+static volatile uint16_t pt_ticks;
+
+uint16_t pt_clock()
+{
+  uint8_t sreg = SREG; // Two byte read, the tick may come in between
+  cli();
+  uint16_t ticks = pt_ticks;
+  SREG = sreg;
+  return ticks;
+}
+
+void pt_clock_tick(void)
+{
+  pt_ticks++;
+}
+
+#ifndef TIMER0_OVF_STATIC
+void pt_clock_init()
+{
+  timer0OVFInit(0);
+  timer0SetPrescaler(TIMER_CLK_DIV64);
+  timerAttach(TIMER0OVERFLOW_INT, pt_clock_tick);
+}
+#endif
+
+void pt_timer_set(pt_timer_t *t, uint16_t ticks)
+{
+  t->start = pt_clock();
+  t->interval = ticks;
+}
+
+uint8_t pt_timer_expired(pt_timer_t *t)
+{
+  return ((uint16_t)(pt_clock() - t->start) >= t->interval);
+}
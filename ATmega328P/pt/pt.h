@@ -0,0 +1,138 @@
+/*
+  pt.h - Protothreads: stackless coroutines for multi-step protocols in the main loop
+
+  A protothread is a function that returns at each wait and, when called again, continues
+  after that wait. The resume point is kept in a pt_t, two bytes; all threads share the one
+  stack. So a protocol step can wait for a byte, a flag or a timeout without blocking the main
+  loop, which keeps calling its threads in turn:
+
+    static PT_THREAD(probe(pt_t *pt))
+    {
+      static pt_timer_t timeout;
+      static uint8_t tries;
+      static int c;
+
+      PT_BEGIN(pt);
+      for (tries = 0; tries < 3; tries++) {
+        stream_write(&soft->stream, '?');
+        PT_READ_BYTE(pt, &soft->stream, c, &timeout, PT_MS(100));
+        if (c == '!') { break; }
+      }
+      PT_END(pt);
+    }
+    ...
+    while (1) { probe(&probe_pt); other(&other_pt); protocol_step(); }
+
+  Rules, as for any protothread implementation:
+  - Local variables are not kept across a wait. Use static ones or fields of a struct passed
+    in with the pt_t.
+  - Waits can only be in the thread function itself, not in functions it calls. A nested step
+    is a thread of its own, run with PT_SPAWN().
+  - One wait per source line: the resume points are labels named after __LINE__.
+  Resume points are GCC label addresses, so a thread body may contain switch statements.
+
+  Time is counted in ticks of pt_clock(). pt_clock_init() takes the Timer0 overflow through
+  timerx8.c, one tick per 256*64 cycles (1.024 ms at 16 MHz). Where Timer0 is taken, as by
+  the stepper, call pt_clock_tick() from another periodic interrupt and define PT_TICK_US to
+  its period. Timeouts run up to 65535 ticks, 67 s at 1.024 ms.
+
+  Byte waits go through the stream interface (util/stream.h), so the same thread can talk to
+  the USART, a SoftSerial port or a RAM buffer. Note that the USART RX ring is also read by
+  protocol_main_loop(); a thread that reads serial_stream is for programs that do not run it.
+*/
+
+#ifndef pt_h
+#define pt_h
+#include <avr/io.h>
+#include "../util/stream.h"
+
+#ifndef PT_TICK_US
+  #define PT_TICK_US (256UL * 64 * 1000000 / F_CPU)
+#endif
+
+// Ticks in ms milliseconds, rounded. A constant for a constant ms.
+#define PT_MS(ms) ((uint16_t)(((uint32_t)(ms) * 1000 + PT_TICK_US / 2) / PT_TICK_US))
+
+// Thread return values. A thread is running while PT_SCHEDULE() of its call is true.
+#define PT_WAITING 0
+#define PT_YIELDED 1
+#define PT_EXITED  2
+#define PT_ENDED   3
+
+typedef struct {
+  void *lc; // Resume point, NULL: from the start
+} pt_t;
+
+typedef struct {
+  uint16_t start;
+  uint16_t interval;
+} pt_timer_t;
+
+// Declares a thread function, e.g. static PT_THREAD(name(pt_t *pt, ...)).
+#define PT_THREAD(name_args) uint8_t name_args
+
+// Sets pt to start its thread from the beginning.
+#define PT_INIT(pt) ((pt)->lc = NULL)
+
+#define PT_LC_CONCAT2(a, b) a##b
+#define PT_LC_CONCAT(a, b) PT_LC_CONCAT2(a, b)
+#define PT_LC_SET(pt) \
+  PT_LC_CONCAT(pt_lc_, __LINE__): (pt)->lc = &&PT_LC_CONCAT(pt_lc_, __LINE__)
+
+// Open and close the thread body. Everything in between can wait.
+#define PT_BEGIN(pt) \
+  { uint8_t pt_yielded __attribute__((unused)) = 1; if ((pt)->lc) { goto *(pt)->lc; }
+#define PT_END(pt) \
+  } PT_INIT(pt); return PT_ENDED
+
+// Returns to the caller until cond is true, checked again on each call.
+#define PT_WAIT_UNTIL(pt, cond) \
+  do { PT_LC_SET(pt); if (!(cond)) { return PT_WAITING; } } while (0)
+#define PT_WAIT_WHILE(pt, cond) PT_WAIT_UNTIL(pt, !(cond))
+
+// Returns to the caller once, for the other threads to run.
+#define PT_YIELD(pt) \
+  do { pt_yielded = 0; PT_LC_SET(pt); if (!pt_yielded) { return PT_YIELDED; } } while (0)
+
+// Ends the thread now; the next call starts it from the beginning.
+#define PT_EXIT(pt) do { PT_INIT(pt); return PT_EXITED; } while (0)
+#define PT_RESTART(pt) do { PT_INIT(pt); return PT_WAITING; } while (0)
+
+// True while the thread call f has not ended.
+#define PT_SCHEDULE(f) ((f) < PT_EXITED)
+
+// Runs child thread call f, on child pt, to its end.
+#define PT_WAIT_THREAD(pt, f) PT_WAIT_WHILE(pt, PT_SCHEDULE(f))
+#define PT_SPAWN(pt, child, f) do { PT_INIT(child); PT_WAIT_THREAD(pt, f); } while (0)
+
+// Waits ticks ticks, e.g. PT_DELAY(pt, &t, PT_MS(250)).
+#define PT_DELAY(pt, timer, ticks) \
+  do { pt_timer_set(timer, ticks); PT_WAIT_UNTIL(pt, pt_timer_expired(timer)); } while (0)
+
+// Waits for a byte on stream s for at most ticks ticks. c is the byte, or STREAM_NO_DATA on
+// timeout.
+#define PT_READ_BYTE(pt, s, c, timer, ticks) \
+  do { \
+    pt_timer_set(timer, ticks); \
+    PT_WAIT_UNTIL(pt, stream_available(s) || pt_timer_expired(timer)); \
+    (c) = stream_read(s); \
+  } while (0)
+
+// Ticks since pt_clock_init(), wrapping.
+uint16_t pt_clock();
+
+// Advances the clock one tick. From the periodic interrupt, when not using pt_clock_init().
+void pt_clock_tick(void);
+
+#ifndef TIMER0_OVF_STATIC
+// Starts Timer0 at clk/64 with its overflow as the tick. Before sei().
+void pt_clock_init();
+#endif
+
+// Starts timer t, expiring ticks ticks from now.
+void pt_timer_set(pt_timer_t *t, uint16_t ticks);
+
+// True once timer t has run out.
+uint8_t pt_timer_expired(pt_timer_t *t);
+
+#endif
@@ -0,0 +1,149 @@
+//*****************************************************************************
+// File Name	: pttest.c
+//
+// Title		: example usage of protothreads
+// Revision		: 1.0
+// Notes		: softSerialTest() without the busy loop: the serial bridge, an LED
+//				  blink and an "AT"/"OK" handshake with the device on the soft port
+//				  run as protothreads side by side. Send '?' on the USART to start
+//				  the handshake.
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Revision History:
+// When			Who			Description of change
+// -----------	-----------	-----------------------
+// 19-Oct-2026	flyingyizi		Created the program
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>			// include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h>	// include interrupt support
+#include <avr/pgmspace.h>
+
+#include "../serial/serial.h"
+#include "../util/print.h"
+#include "../softSerial/softSerial.h"
+
+#include "pt.h"
+
+//example
+// int main()
+// {
+//   // Initialize system upon power-up.
+//   serial_init(); // Setup serial baud rate and interrupts
+//   pt_clock_init(); // Timer0 tick for the protothread timers
+//   sei();         // Enable interrupts
+//   ptTest();
+//   return 0;
+// }
+
+static SoftSerial *soft;
+static uint8_t handshake_request;
+
+// Toggles the LED on PB5 every 500 ms.
+static PT_THREAD(blink(pt_t *pt))
+{
+	static pt_timer_t t;
+
+	PT_BEGIN(pt);
+	DDRB |= _BV(DDB5);
+	while (1)
+	{
+		PT_DELAY(pt, &t, PT_MS(500));
+		PORTB ^= _BV(PORTB5);
+	}
+	PT_END(pt);
+}
+
+// Soft port to USART, with a note after 5 s without data.
+static PT_THREAD(soft_to_usart(pt_t *pt))
+{
+	static pt_timer_t t;
+	static int c;
+
+	PT_BEGIN(pt);
+	while (1)
+	{
+		PT_READ_BYTE(pt, &soft->stream, c, &t, PT_MS(5000));
+		if (c == STREAM_NO_DATA) { printPgmString(PSTR("[soft port idle]\r\n")); }
+		else { stream_write(&serial_stream, c); }
+	}
+	PT_END(pt);
+}
+
+// USART to soft port. '?' asks for the handshake instead.
+static PT_THREAD(usart_to_soft(pt_t *pt))
+{
+	static int c;
+
+	PT_BEGIN(pt);
+	while (1)
+	{
+		PT_WAIT_UNTIL(pt, (c = stream_read(&serial_stream)) != STREAM_NO_DATA);
+		if (c == '?') { handshake_request = 1; }
+		else { stream_write(&soft->stream, c); }
+	}
+	PT_END(pt);
+}
+
+// Waits for "OK" on the soft port, 200 ms per character. Exits on a wrong character or a
+// timeout, ends on success.
+static PT_THREAD(expect_ok(pt_t *pt))
+{
+	static pt_timer_t t;
+	static int c;
+
+	PT_BEGIN(pt);
+	PT_READ_BYTE(pt, &soft->stream, c, &t, PT_MS(200));
+	if (c != 'O') { PT_EXIT(pt); }
+	PT_READ_BYTE(pt, &soft->stream, c, &t, PT_MS(200));
+	if (c != 'K') { PT_EXIT(pt); }
+	PT_END(pt);
+}
+
+// Sends "AT" and waits for "OK", three tries. The bridge thread must not read the soft port
+// meanwhile, so it is paused by the caller.
+static PT_THREAD(handshake(pt_t *pt))
+{
+	static pt_t child;
+	static uint8_t tries;
+	static uint8_t ok;
+	static uint8_t result;
+
+	PT_BEGIN(pt);
+	ok = 0;
+	for (tries = 1; (tries <= 3) && !ok; tries++)
+	{
+		stream_write_block_P(&soft->stream, PSTR("AT\r"), 3);
+		PT_INIT(&child);
+		PT_WAIT_UNTIL(pt, !PT_SCHEDULE(result = expect_ok(&child)));
+		ok = (result == PT_ENDED);
+	}
+	printPgmFormat(ok ? PSTR("[handshake ok, %u tries]\r\n") : PSTR("[handshake failed]\r\n"), tries - 1);
+	PT_END(pt);
+}
+
+void ptTest(void)
+{
+	static pt_t blink_pt, soft_pt, usart_pt, handshake_pt;
+
+	printPgmString(PSTR("\r\n\n\nWelcome to the protothread test program!\r\n"));
+
+	soft = NewSoftSerial(PCINTR19 /* RX */, PCINTR20 /* tx */, 57600);
+	begin(soft);
+
+	while (1)
+	{
+		blink(&blink_pt);
+		usart_to_soft(&usart_pt);
+		if (handshake_request)
+		{
+			if (!PT_SCHEDULE(handshake(&handshake_pt))) { handshake_request = 0; }
+		}
+		else
+		{
+			soft_to_usart(&soft_pt);
+		}
+	}
+}
@@ -0,0 +1,8 @@
+#ifndef PTTEST_H
+#define PTTEST_H
+
+#include "pt.h"
+
+void ptTest(void);
+
+#endif
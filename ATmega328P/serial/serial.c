@@ -21,7 +21,9 @@
 
 #include "serial.h"
 #include <avr/interrupt.h>
-volatile uint8_t sys_rt_exec_state = 0;  //global
+#include <string.h>
+#include "../trace/trace.h"
+#include "../load/load.h"
 
 uint8_t serial_rx_buffer[RX_BUFFER_SIZE];
 uint8_t serial_rx_buffer_head = 0;
@@ -31,6 +33,28 @@ uint8_t serial_tx_buffer[TX_BUFFER_SIZE];
 uint8_t serial_tx_buffer_head = 0;
 volatile uint8_t serial_tx_buffer_tail = 0;
 
+#define SERIAL_CHAR_CLASS_ENTRY(c, cls) [(uint8_t)(c)] = (cls),
+#define SERIAL_CHAR_CLASS_CHECK(c, cls) \
+  _Static_assert(!((cls) & CC_REALTIME) || !((cls) & ~(CC_REALTIME|CC_RT_HI|CC_RT_FLAGS)), \
+                 "realtime command flag outside CC_RT_FLAGS");
+SERIAL_REALTIME_CHARS(SERIAL_CHAR_CLASS_CHECK)
+
+// Later initializers override earlier ones, so a realtime character always wins over its line class.
+const uint8_t serial_char_class[256] PROGMEM = {
+  [0x00 ... ' '] = CC_SKIP,
+  ['\n'] = CC_EOL,
+  ['\r'] = CC_EOL,
+  ['/'] = CC_SKIP, // Block delete NOT SUPPORTED. Ignore character.
+  ['('] = CC_COMMENT_OPEN,
+  [')'] = CC_COMMENT_CLOSE,
+  [';'] = CC_COMMENT_EOL,
+  ['a' ... 'z'] = CC_LOWER,
+#ifdef LINE_CHECKSUM
+  ['*'] = CC_CHECKSUM,
+#endif
+  SERIAL_REALTIME_CHARS(SERIAL_CHAR_CLASS_ENTRY)
+};
+
 #ifdef ENABLE_XONXOFF
 volatile uint8_t flow_ctrl = XON_SENT; // Flow control state variable
 #endif
@@ -46,6 +70,13 @@ uint8_t serial_get_rx_buffer_count()
   return (RX_BUFFER_SIZE - (rtail - serial_rx_buffer_head));
 }
 
+// Returns the number of bytes that can still be received before the RX serial buffer is full.
+// The ring keeps one slot empty to tell full from empty.
+uint8_t serial_get_rx_buffer_available()
+{
+  return ((RX_BUFFER_SIZE - 1) - serial_get_rx_buffer_count());
+}
+
 // Returns the number of bytes used in the TX serial buffer.
 // NOTE: Not used except for debugging and ensuring no TX bottlenecks.
 uint8_t serial_get_tx_buffer_count()
@@ -60,6 +91,10 @@ uint8_t serial_get_tx_buffer_count()
 
 void serial_init()
 {
+  // Clear the realtime flags. GPIOR0/1 are only zeroed by a hardware reset.
+  sys_rt_exec_state &= ~EXEC_MASK;
+  sys_rt_exec_state_hi = 0;
+
 // Set baud rate
 #if BAUD_RATE < 57600
   uint16_t UBRR0_value = ((F_CPU / (8L * BAUD_RATE)) - 1) / 2;
@@ -81,8 +116,8 @@ void serial_init()
   // defaults to 8-bit, no parity, 1 stop bit
 }
 
-// Writes one byte to the TX serial buffer. Called by main program.
-// TODO: Check if we can speed this up for writing strings, rather than single bytes.
+// Writes one byte to the TX serial buffer. Called by main program. Strings go through
+// serial_write_block().
 void serial_write(uint8_t data)
 {
   // Calculate next head
@@ -95,7 +130,9 @@ void serial_write(uint8_t data)
   // Wait until there is space in the buffer
   while (next_head == serial_tx_buffer_tail)
   {
-    // TODO: Restructure st_prep_buffer() calls to be executed here during a long print.
+    // Keep the steppers fed and motion commands responsive during a long print. Only the
+    // silent flags are run here, so no handler writes into the buffer behind our back.
+    protocol_execute_realtime_silent();
     //TODO if (sys_rt_exec_state & EXEC_RESET) { return; } // Only check for abort to avoid an endless loop.
   }
 
@@ -107,9 +144,52 @@ void serial_write(uint8_t data)
   UCSR0B |= (1 << UDRIE0);
 }
 
+// Copies a block into the TX serial buffer, as much as fits contiguously per step, with one
+// head update per step. Waits like serial_write() while the buffer is full.
+static void serial_write_bytes(const char *data, uint16_t len, uint8_t pgm)
+{
+  while (len)
+  {
+    uint8_t head = serial_tx_buffer_head;
+    uint8_t tail = serial_tx_buffer_tail;
+    uint8_t n;
+    if (tail > head) { n = tail - head - 1; }
+    else { n = TX_BUFFER_SIZE - head - (tail == 0); } // Up to the end of the buffer
+    if (n == 0)
+    {
+      protocol_execute_realtime_silent(); // Buffer full. See serial_write().
+      continue;
+    }
+    if (n > len) { n = len; }
+
+    if (pgm) { memcpy_P(&serial_tx_buffer[head], data, n); }
+    else { memcpy(&serial_tx_buffer[head], data, n); }
+    data += n;
+    len -= n;
+    head += n;
+    if (head == TX_BUFFER_SIZE) { head = 0; }
+    serial_tx_buffer_head = head;
+
+    UCSR0B |= (1 << UDRIE0);
+  }
+}
+
+// Writes a block of bytes to the TX serial buffer.
+void serial_write_block(const char *data, uint16_t len)
+{
+  serial_write_bytes(data, len, 0);
+}
+
+// Writes a block of bytes stored in flash to the TX serial buffer.
+void serial_write_block_P(const char *data, uint16_t len)
+{
+  serial_write_bytes(data, len, 1);
+}
+
 // Data Register Empty Interrupt handler
 ISR(SERIAL_UDRE)
 {
+  LOAD_ISR_ENTER();
   uint8_t tail = serial_tx_buffer_tail; // Temporary serial_tx_buffer_tail (to optimize for volatile)
 
 #ifdef ENABLE_XONXOFF
@@ -144,6 +224,7 @@ ISR(SERIAL_UDRE)
   {
     UCSR0B &= ~(1 << UDRIE0);
   }
+  LOAD_ISR_EXIT();
 }
 
 // Fetches the first byte in the serial read buffer. Called by main program.
@@ -179,29 +260,26 @@ uint8_t serial_read()
 
 ISR(SERIAL_RX)
 {
+  LOAD_ISR_ENTER();
   uint8_t data = UDR0;
   uint8_t next_head;
 
   // Pick off realtime command characters directly from the serial stream. These characters are
   // not passed into the buffer, but these set system state flag bits for realtime execution.
-  switch (data)
+  uint8_t cls = pgm_read_byte(&serial_char_class[data]);
+  if (cls & CC_REALTIME)
   {
-  case CMD_STATUS_REPORT:
-    bit_true_atomic(sys_rt_exec_state, EXEC_STATUS_REPORT);
-    break; // Set as TRUE
-  case CMD_CYCLE_START:
-    bit_true_atomic(sys_rt_exec_state, EXEC_CYCLE_START);
-    break; // Set as TRUE
-  case CMD_FEED_HOLD:
-    bit_true_atomic(sys_rt_exec_state, EXEC_FEED_HOLD);
-    break; // Set as TRUE
-  case CMD_SAFETY_DOOR:
-    bit_true_atomic(sys_rt_exec_state, EXEC_SAFETY_DOOR);
-    break; // Set as TRUE
-  case CMD_RESET:
-    //TODO:  mc_reset();
-    break; // Call motion control reset routine.
-  default: // Write character to buffer
+    if (cls & CC_RT_HI)
+    {
+      gpior_set_isr(sys_rt_exec_state_hi, cls & CC_RT_FLAGS);
+    }
+    else
+    {
+      gpior_set_isr(sys_rt_exec_state, cls & CC_RT_FLAGS); //TODO: mc_reset() on EXEC_RESET
+    }
+  }
+  else
+  { // Write character to buffer
     next_head = serial_rx_buffer_head + 1;
     if (next_head == RX_BUFFER_SIZE)
     {
@@ -222,8 +300,13 @@ ISR(SERIAL_RX)
       }
 #endif
     }
-    //TODO: else alarm on overflow?
+    else
+    {
+      gpior_set_isr(sys_rt_exec_state_hi, EXEC_HI_RX_OVERFLOW);
+      TRACE0(TR_RX_OVERFLOW);
+    }
   }
+  LOAD_ISR_EXIT();
 }
 
 void serial_reset_read_buffer()
@@ -234,3 +317,32 @@ void serial_reset_read_buffer()
   flow_ctrl = XON_SENT;
 #endif
 }
+
+
+static void serial_stream_write(stream_t *s, uint8_t data)
+{
+  serial_write(data);
+}
+
+static void serial_stream_write_block(stream_t *s, const char *data, uint16_t len, uint8_t pgm)
+{
+  serial_write_bytes(data, len, pgm);
+}
+
+static uint16_t serial_stream_available(stream_t *s)
+{
+  return serial_get_rx_buffer_count();
+}
+
+// SERIAL_NO_DATA is also a valid byte 0xff, so an empty buffer is told by the count.
+static int serial_stream_read(stream_t *s)
+{
+  if (serial_get_rx_buffer_count() == 0) { return STREAM_NO_DATA; }
+  return serial_read();
+}
+
+static const stream_ops_t serial_stream_ops PROGMEM = {
+  serial_stream_write, serial_stream_write_block, serial_stream_available, serial_stream_read
+};
+
+stream_t serial_stream = { &serial_stream_ops };
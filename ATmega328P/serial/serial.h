@@ -22,6 +22,9 @@
 #ifndef serial_h
 #define serial_h
 #include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "../util/gpior.h"
+#include "../util/stream.h"
 
 // Bit field and masking macros
 #define bit(n) (1 << n) 
@@ -32,7 +35,12 @@
 #define bit_false(x,mask) (x) &= ~(mask)
 #define bit_istrue(x,mask) ((x & mask) != 0)
 #define bit_isfalse(x,mask) ((x & mask) == 0)
-volatile uint8_t sys_rt_exec_state;  // Global realtime executor bitflag variable for state management. See EXEC bitmasks.
+// Global realtime executor bitflag variable for state management. See EXEC bitmasks. Lives in
+// GPIOR0, so rt_exec_set()/rt_exec_clear() with one EXEC_* bit are a single sbi/cbi.
+#define sys_rt_exec_state GPIOR0
+#define rt_exec_set(mask) gpior_set(sys_rt_exec_state,mask)
+#define rt_exec_clear(mask) gpior_clear(sys_rt_exec_state,mask)
+#define rt_exec_hi_set(mask) gpior_set(sys_rt_exec_state_hi,mask)
 // Serial baud rate
 // #define BAUD_RATE 115200
 #ifndef BAUD_RATE
@@ -46,24 +54,120 @@ volatile uint8_t sys_rt_exec_state;  // Global realtime executor bitflag variabl
 // that do not and must not exist in the streamed g-code program. ASCII control characters may be 
 // used, if they are available per user setup. Also, extended ASCII codes (>127), which are never in 
 // g-code programs, maybe selected for interface programs.
-// NOTE: If changed, manually update help message in report.c.
-#define CMD_STATUS_REPORT '?'
-#define CMD_FEED_HOLD '!'
-#define CMD_CYCLE_START '~'
-#define CMD_RESET 0x18 // ctrl-x.
-#define CMD_SAFETY_DOOR '@'
+// NOTE: If changed, manually update help message in report.c. The set itself is
+// SERIAL_REALTIME_CHARS below.
+#ifndef CMD_STATUS_REPORT
+  #define CMD_STATUS_REPORT '?'
+#endif
+#ifndef CMD_FEED_HOLD
+  #define CMD_FEED_HOLD '!'
+#endif
+#ifndef CMD_CYCLE_START
+  #define CMD_CYCLE_START '~'
+#endif
+#ifndef CMD_RESET
+  #define CMD_RESET 0x18 // ctrl-x.
+#endif
+#ifndef CMD_SAFETY_DOOR
+  #define CMD_SAFETY_DOOR '@'
+#endif
+#ifndef CMD_TELEMETRY_REPORT
+  #define CMD_TELEMETRY_REPORT 0x83 // Binary status report, with TELEMETRY. See telemetry.h.
+#endif
+#ifndef CMD_MEMORY_REPORT
+  #define CMD_MEMORY_REPORT 0x84 // SRAM usage report, with MEMORY_STATS. See memory.h.
+#endif
+#ifndef CMD_PROFILE_REPORT
+  #define CMD_PROFILE_REPORT 0x85 // Sampling profiler histogram, with PROFILE. See profile.h.
+#endif
+#ifndef CMD_LOAD_REPORT
+  #define CMD_LOAD_REPORT 0x86 // CPU load and main loop statistics, with LOAD_METER. See load.h.
+#endif
 // Define system executor bit map. Used internally by realtime protocol as realtime command flags, 
 // which notifies the main program to execute the specified realtime command asynchronously.
-// NOTE: The system executor uses an unsigned 8-bit volatile variable (8 flag limit.) The default
-// flags are always false, so the realtime protocol only needs to check for a non-zero value to 
-// know when there is a realtime command to execute.
-#define EXEC_STATUS_REPORT  bit(0) // bitmask 00000001
-#define EXEC_CYCLE_START    bit(1) // bitmask 00000010
-#define EXEC_CYCLE_STOP     bit(2) // bitmask 00000100
+// NOTE: The flag set spans two bytes, sys_rt_exec_state (EXEC_*) and sys_rt_exec_state_hi
+// (EXEC_HI_*). The bit index over both bytes is the flag priority: protocol_execute_realtime()
+// dispatches pending flags lowest bit first, so e.g. a feed hold is always handled before a cycle
+// start flagged at the same time. The default flags are always false, so the realtime protocol
+// only needs to check for a non-zero value to know when there is a realtime command to execute.
+#define EXEC_RESET          bit(0) // bitmask 00000001
+#define EXEC_SAFETY_DOOR    bit(1) // bitmask 00000010
+#define EXEC_MOTION_CANCEL  bit(2) // bitmask 00000100
 #define EXEC_FEED_HOLD      bit(3) // bitmask 00001000
-#define EXEC_RESET          bit(4) // bitmask 00010000
-#define EXEC_SAFETY_DOOR    bit(5) // bitmask 00100000
-#define EXEC_MOTION_CANCEL  bit(6) // bitmask 01000000
+#define EXEC_CYCLE_STOP     bit(4) // bitmask 00010000
+#define EXEC_CYCLE_START    bit(5) // bitmask 00100000
+#define EXEC_PREP_BUFFER    bit(6) // bitmask 01000000
+#define EXEC_MASK           0x7f   // GPIOR0 bit 7 is not an executor flag, see gpior.h
+
+#define EXEC_HI_STATUS_REPORT bit(0) // bitmask 00000001
+#define EXEC_HI_RX_OVERFLOW   bit(1) // bitmask 00000010
+#define EXEC_HI_TELEMETRY_REPORT bit(2) // bitmask 00000100
+#define EXEC_HI_MEMORY_REPORT bit(3) // bitmask 00001000
+#define EXEC_HI_PROFILE_REPORT bit(4) // bitmask 00010000
+#define EXEC_HI_LOAD_REPORT   bit(5) // bitmask 00100000
+#define sys_rt_exec_state_hi GPIOR1 // Second byte of the realtime executor flags. See EXEC_HI bitmasks.
+
+// Character classes, one PROGMEM byte per received byte value, shared by ISR(SERIAL_RX) and the
+// line preprocessor in protocol_main_loop(). Each byte costs one lpm and a bit test on both sides.
+// With CC_REALTIME set the entry is a realtime command: CC_RT_HI selects sys_rt_exec_state_hi
+// over sys_rt_exec_state, and the low six bits are the flag mask the ISR ors into it.
+// Otherwise the bits are the line classes below; 0 is a plain g-code character.
+#define CC_EOL            bit(0) // '\n' '\r'
+#define CC_SKIP           bit(1) // Whitespace, control characters, block delete '/'
+#define CC_COMMENT_OPEN   bit(2) // '('
+#define CC_COMMENT_CLOSE  bit(3) // ')'
+#define CC_COMMENT_EOL    bit(4) // ';'
+#define CC_LOWER          bit(5) // 'a'..'z'
+#define CC_CHECKSUM       bit(6) // '*' with LINE_CHECKSUM. Same bit as CC_RT_HI, for line classes only.
+#define CC_RT_HI          bit(6)
+#define CC_REALTIME       bit(7)
+#define CC_RT_FLAGS       0x3f
+#define CC_RT(mask)       (CC_REALTIME | (mask))
+#define CC_RT_HI_FLAG(mask) (CC_REALTIME | CC_RT_HI | (mask))
+
+// The realtime command set: X(character, class). Override from a config header to add, drop or
+// remap commands. Only executor flags within CC_RT_FLAGS can be raised this way.
+#ifdef TELEMETRY
+  #define SERIAL_TELEMETRY_CHARS(X) X(CMD_TELEMETRY_REPORT, CC_RT_HI_FLAG(EXEC_HI_TELEMETRY_REPORT))
+#else
+  #define SERIAL_TELEMETRY_CHARS(X)
+#endif
+#ifdef MEMORY_STATS
+  #define SERIAL_MEMORY_CHARS(X) X(CMD_MEMORY_REPORT, CC_RT_HI_FLAG(EXEC_HI_MEMORY_REPORT))
+#else
+  #define SERIAL_MEMORY_CHARS(X)
+#endif
+#ifdef PROFILE
+  #define SERIAL_PROFILE_CHARS(X) X(CMD_PROFILE_REPORT, CC_RT_HI_FLAG(EXEC_HI_PROFILE_REPORT))
+#else
+  #define SERIAL_PROFILE_CHARS(X)
+#endif
+#ifdef LOAD_METER
+  #define SERIAL_LOAD_CHARS(X) X(CMD_LOAD_REPORT, CC_RT_HI_FLAG(EXEC_HI_LOAD_REPORT))
+#else
+  #define SERIAL_LOAD_CHARS(X)
+#endif
+#ifndef SERIAL_REALTIME_CHARS
+  #define SERIAL_REALTIME_CHARS(X) \
+    X(CMD_RESET,         CC_RT(EXEC_RESET)) \
+    X(CMD_SAFETY_DOOR,   CC_RT(EXEC_SAFETY_DOOR)) \
+    X(CMD_FEED_HOLD,     CC_RT(EXEC_FEED_HOLD)) \
+    X(CMD_CYCLE_START,   CC_RT(EXEC_CYCLE_START)) \
+    X(CMD_STATUS_REPORT, CC_RT_HI_FLAG(EXEC_HI_STATUS_REPORT)) \
+    SERIAL_TELEMETRY_CHARS(X) \
+    SERIAL_MEMORY_CHARS(X) \
+    SERIAL_PROFILE_CHARS(X) \
+    SERIAL_LOAD_CHARS(X)
+#endif
+extern const uint8_t serial_char_class[256] PROGMEM;
+
+// Realtime executor entry points, implemented by the main program. Both are cheap when no flag
+// is pending and may be called from any wait loop. The _silent variant only dispatches the flags
+// in EXEC_SILENT_MASK, whose handlers never print, and is the one used inside the print path.
+#define EXEC_SILENT_MASK (EXEC_RESET|EXEC_SAFETY_DOOR|EXEC_MOTION_CANCEL|EXEC_FEED_HOLD|\
+                          EXEC_CYCLE_STOP|EXEC_CYCLE_START|EXEC_PREP_BUFFER)
+void protocol_execute_realtime();
+void protocol_execute_realtime_silent();
 
 
 
@@ -95,6 +199,12 @@ void serial_init();
 // Writes one byte to the TX serial buffer. Called by main program.
 void serial_write(uint8_t data);
 
+// Writes a block of bytes to the TX serial buffer, filling the free space in bulk.
+void serial_write_block(const char *data, uint16_t len);
+
+// Same, for a block stored in flash.
+void serial_write_block_P(const char *data, uint16_t len);
+
 // Fetches the first byte in the serial read buffer. Called by main program.
 uint8_t serial_read();
 
@@ -104,8 +214,14 @@ void serial_reset_read_buffer();
 // Returns the number of bytes used in the RX serial buffer.
 uint8_t serial_get_rx_buffer_count();
 
+// Returns the number of bytes that can still be received before the RX serial buffer is full.
+uint8_t serial_get_rx_buffer_available();
+
 // Returns the number of bytes used in the TX serial buffer.
 // NOTE: Not used except for debugging and ensuring no TX bottlenecks.
 uint8_t serial_get_tx_buffer_count();
 
+// The USART as a stream, see stream.h. Same buffers as the functions above.
+extern stream_t serial_stream;
+
 #endif
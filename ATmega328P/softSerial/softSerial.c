@@ -91,7 +91,7 @@ static void recv(SoftSerial *p)
         }
         else
         {
-            p->_buffer_overflow = TRUE;
+            gpior_set_isr(GPIOR0, _BV(GPIOR0_SOFTSERIAL_OVERFLOW));
         }
 
         // skip the stop bit
@@ -162,6 +162,28 @@ static void applyDelayParam(SoftSerial *p, long speed)
 }
 
 
+//
+// Stream interface, see stream.h. Each byte is sent with interrupts off, so no block write.
+//
+static void softserial_stream_write(stream_t *s, uint8_t data)
+{
+    write((SoftSerial *)s, data);
+}
+
+static uint16_t softserial_stream_available(stream_t *s)
+{
+    return available((SoftSerial *)s);
+}
+
+static int softserial_stream_read(stream_t *s)
+{
+    return read((SoftSerial *)s);
+}
+
+static const stream_ops_t softserial_stream_ops PROGMEM = {
+    softserial_stream_write, NULL, softserial_stream_available, softserial_stream_read
+};
+
 //
 // Constructor
 //
@@ -178,11 +200,12 @@ SoftSerial *NewSoftSerial(uint8_t rx /* PCINT_NO */,
     SoftSerial *p = (SoftSerial *)malloc(sizeof(SoftSerial));
     Callback *prx = register_pcinterrupt(rx, softserial_interrupt,(void*)p );
 
+    p->stream.ops = &softserial_stream_ops;
     p->_rx_delay_centering = (0);
     p->_rx_delay_intrabit = (0);
     p->_rx_delay_stopbit = (0);
     p->_tx_delay = (0);
-    p->_buffer_overflow = (FALSE);
+    gpior_clear(GPIOR0, _BV(GPIOR0_SOFTSERIAL_OVERFLOW));
 
     p->p_rx = prx;
 
@@ -264,6 +287,15 @@ int read(SoftSerial *p)
     return d;
 }
 
+uint8_t overflow(SoftSerial *p)
+{
+    if (!gpior_test(GPIOR0, _BV(GPIOR0_SOFTSERIAL_OVERFLOW)))
+        return FALSE;
+
+    gpior_clear(GPIOR0, _BV(GPIOR0_SOFTSERIAL_OVERFLOW));
+    return TRUE;
+}
+
 int available(SoftSerial *p)
 {
     return (p->_receive_buffer_tail + _SS_MAX_RX_BUFF - p->_receive_buffer_head) % _SS_MAX_RX_BUFF;
@@ -7,6 +7,8 @@
 #include <stdint.h>
 #include <avr/io.h>
 #include "../pcint/pcint.h"
+#include "../util/gpior.h"
+#include "../util/stream.h"
 
 #define TRUE 1
 #define FALSE 0
@@ -17,6 +19,7 @@
 
 typedef struct SoftSerialT 
 {
+  stream_t stream; // The port as a stream, see stream.h. First member: a SoftSerial* is a stream_t*
   Callback *p_rx;
 
   uint8_t _transmitBitMask;
@@ -28,8 +31,6 @@ typedef struct SoftSerialT
   uint16_t _rx_delay_stopbit;
   uint16_t _tx_delay;
 
-  uint16_t _buffer_overflow:1;
-
   uint8_t _receive_buffer[_SS_MAX_RX_BUFF]; 
   volatile uint8_t _receive_buffer_tail;
   volatile uint8_t _receive_buffer_head;
@@ -46,5 +47,9 @@ int available(SoftSerial *p);
 int read(SoftSerial *p);
 size_t write(SoftSerial *p,uint8_t b);
 
+// Returns TRUE once after the receive buffer overflowed, then clears the flag.
+// NOTE: The flag is one GPIOR0 bit shared by all instances, as only one receives at a time.
+uint8_t overflow(SoftSerial *p);
+
 
 #endif
@@ -0,0 +1,244 @@
+/*! \file softpwm.c \brief Software PWM / RC-servo engine on one timer1 compare channel. */
+//*****************************************************************************
+//
+// File Name	: 'softpwm.c'
+// Title		: Software PWM / RC-servo engine
+// Author		: flyingyizi
+// Created		: 10/19/2026
+// Revised		:
+// Version		: 1.0
+// Target MCU	: Atmel AVR Series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stddef.h>
+
+#include "softpwm.h"
+#include "../timerx8/timerx8.h"
+
+typedef struct SoftPwmChannelT
+{
+    uint8_t port;   // 0:PORTB 1:PORTC 2:PORTD
+    uint8_t mask;
+    uint16_t duty;  // ticks
+} SoftPwmChannel;
+
+static SoftPwmChannel channels[SOFTPWM_MAX_CHANNELS];
+static uint8_t channel_count = 0;
+static uint16_t next_period = SOFTPWM_SERVO_PERIOD;
+
+// Double buffered schedule. The ISR only reads sched[active]; the main program
+// only writes sched[active ^ 1] and sets swap when it is complete.
+static SoftPwmSchedule sched[2];
+static uint8_t start_keep[2][SOFTPWM_PORTS]; // AND masks at period start (duty 0 pins)
+static volatile uint8_t active = 0;
+static volatile uint8_t swap = 0;
+
+// ISR state
+static uint8_t event = 0;   // 0: next match is a period start, n: edge n-1
+static uint16_t base;       // OCR1A value of the current period start
+
+static void softpwm_compare(void)
+{
+    uint8_t i = event;
+    SoftPwmSchedule *s;
+
+    if (i == 0)
+    {
+        // period start: pick up a committed schedule, then switch channels on
+        if (swap)
+        {
+            active ^= 1;
+            swap = 0;
+        }
+        s = &sched[active];
+        uint8_t *k = start_keep[active];
+        PORTB = (PORTB & k[0]) | s->set[0];
+        PORTC = (PORTC & k[1]) | s->set[1];
+        PORTD = (PORTD & k[2]) | s->set[2];
+        base = OCR1A;
+    }
+    else
+    {
+        s = &sched[active];
+        SoftPwmEdge *e = &s->edge[i - 1];
+        PORTB &= e->keep[0];
+        PORTC &= e->keep[1];
+        PORTD &= e->keep[2];
+    }
+
+    if (i < s->count)
+    {
+        OCR1A = base + s->edge[i].at;
+        event = i + 1;
+    }
+    else
+    {
+        OCR1A = base + s->period;
+        event = 0;
+    }
+}
+
+static uint8_t port_index(enum AVRPIN_GROUP gr)
+{
+    return (uint8_t)(gr - PIN_PORTB);
+}
+
+int8_t softpwm_attach(uint8_t PCINT_NO)
+{
+    PinInfo info;
+    if (channel_count >= SOFTPWM_MAX_CHANNELS || NULL == fillPinInfo(&info, PCINT_NO))
+    {
+        return -1;
+    }
+
+    // output, low
+    *(info.p_port) &= ~(info.port_mask);
+    *(info.p_ddr) |= info.ddr_mask;
+
+    SoftPwmChannel *c = &channels[channel_count];
+    c->port = port_index(info.avr_pingroup);
+    c->mask = info.port_mask;
+    c->duty = 0;
+    return (int8_t)(channel_count++);
+}
+
+void softpwm_set(uint8_t ch, uint16_t ticks)
+{
+    if (ch < channel_count)
+    {
+        channels[ch].duty = ticks;
+    }
+}
+
+void softpwm_set_us(uint8_t ch, uint16_t us)
+{
+    softpwm_set(ch, us * SOFTPWM_TICKS_PER_US);
+}
+
+void softpwm_set_period(uint16_t period)
+{
+    // below this the clamped edges would fall after the next period start
+    if (period < SOFTPWM_MIN_PERIOD)
+    {
+        period = SOFTPWM_MIN_PERIOD;
+    }
+    next_period = period;
+}
+
+uint8_t softpwm_pending(void)
+{
+    return swap;
+}
+
+void softpwm_commit(void)
+{
+    uint8_t order[SOFTPWM_MAX_CHANNELS];
+    uint8_t i, j, n = channel_count;
+
+    // Withdraw any pending schedule first. With swap cleared the ISR keeps
+    // using sched[active], so the other buffer is ours until swap is set again.
+    swap = 0;
+    uint8_t idle = active ^ 1;
+    SoftPwmSchedule *s = &sched[idle];
+    uint8_t *k = start_keep[idle];
+    uint16_t period = next_period;
+    uint16_t last = period - SOFTPWM_MIN_GAP;
+
+    // insertion sort channel indices by duty, n is small
+    for (i = 0; i < n; i++)
+    {
+        uint16_t d = channels[i].duty;
+        for (j = i; j > 0 && channels[order[j - 1]].duty > d; j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+
+    for (i = 0; i < SOFTPWM_PORTS; i++)
+    {
+        s->set[i] = 0;
+        k[i] = 0xff;
+    }
+    s->period = period;
+    s->count = 0;
+
+    SoftPwmEdge *e = NULL;
+    for (i = 0; i < n; i++)
+    {
+        SoftPwmChannel *c = &channels[order[i]];
+        uint16_t at = c->duty;
+
+        if (at == 0)
+        {
+            k[c->port] &= ~(c->mask); // held low
+            continue;
+        }
+        s->set[c->port] |= c->mask;
+        if (at >= period)
+        {
+            continue; // held high, no falling edge
+        }
+
+        if (at < SOFTPWM_MIN_GAP)
+        {
+            at = SOFTPWM_MIN_GAP;
+        }
+        else if (at > last)
+        {
+            at = last;
+        }
+
+        // merge with the previous edge if the ISR could not make it in time
+        if (NULL == e || (uint16_t)(at - e->at) >= SOFTPWM_MIN_GAP)
+        {
+            e = &s->edge[s->count++];
+            e->at = at;
+            e->keep[0] = e->keep[1] = e->keep[2] = 0xff;
+        }
+        e->keep[c->port] &= ~(c->mask);
+    }
+
+    swap = 1;
+}
+
+void softpwm_init(uint16_t period)
+{
+    softpwm_set_period(period);
+    softpwm_commit();
+    // make the first schedule active right away
+    active ^= 1;
+    swap = 0;
+    event = 0;
+
+    timer1Mode(0); // normal mode, timer1 runs free
+    timer1ClockSel(SOFTPWM_PRESCALE);
+    timerAttach(TIMER1OUTCOMPAREA_INT, softpwm_compare);
+
+    OCR1A = TCNT1 + SOFTPWM_MIN_GAP;
+    TIFR1 = _BV(OCF1A);   // drop a stale match
+    TIMSK1 |= _BV(OCIE1A);
+}
+
+void softpwm_stop(void)
+{
+    uint8_t i;
+
+    TIMSK1 &= ~_BV(OCIE1A);
+    timerDetach(TIMER1OUTCOMPAREA_INT);
+
+    for (i = 0; i < channel_count; i++)
+    {
+        SoftPwmChannel *c = &channels[i];
+        if (c->port == 0)
+            PORTB &= ~(c->mask);
+        else if (c->port == 1)
+            PORTC &= ~(c->mask);
+        else
+            PORTD &= ~(c->mask);
+    }
+}
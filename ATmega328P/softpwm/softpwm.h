@@ -0,0 +1,115 @@
+/*! \file softpwm.h \brief Software PWM / RC-servo engine on one timer1 compare channel. */
+//*****************************************************************************
+//
+// File Name	: 'softpwm.h'
+// Title		: Software PWM / RC-servo engine
+// Author		: flyingyizi
+// Created		: 10/19/2026
+// Revised		:
+// Version		: 1.0
+// Target MCU	: Atmel AVR Series
+// Editor Tabs	: 4
+//
+// Notes:	Drives up to SOFTPWM_MAX_CHANNELS PWM (or RC-servo) outputs on
+//			arbitrary GPIO pins from the timer1 output compare A interrupt.
+//
+//			Timer1 runs free in normal mode. At the start of each period every
+//			channel with a non-zero duty is switched on with one precomputed
+//			mask per port. Channel edges are pre-sorted into a schedule, so
+//			each following compare interrupt only clears a precomputed port
+//			mask and loads the next OCR1A value. Channels with the same duty
+//			share one edge, so the interrupt cost scales with the number of
+//			distinct edges, not with a fixed tick rate.
+//
+//			Duty updates are double buffered: softpwm_set() only records the
+//			new value, softpwm_commit() builds the next schedule in the idle
+//			buffer and the interrupt swaps it in at the next period start.
+//
+//			NOTE: the interrupt does read-modify-write on PORTB/PORTC/PORTD.
+//			Main program writes to other pins of these ports must use single
+//			sbi/cbi instructions or be done with interrupts disabled.
+//
+//*****************************************************************************
+
+#ifndef SOFTPWM_H
+#define SOFTPWM_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "../pcint/pcint.h"
+
+#ifndef SOFTPWM_MAX_CHANNELS
+#define SOFTPWM_MAX_CHANNELS 16
+#endif
+
+// timer1 runs at F_CPU/8, i.e. 0.5us per tick on a 16MHz part
+#define SOFTPWM_PRESCALE TIMER_CLK_DIV8
+#define SOFTPWM_TICKS_PER_US (F_CPU / 8 / 1000000)
+
+// Edges closer than this many ticks are merged into one compare event. The
+// interrupt (entry, dispatch and exit) must finish before the next edge is due,
+// otherwise the compare match is missed for a whole timer1 wrap.
+#ifndef SOFTPWM_MIN_GAP
+#define SOFTPWM_MIN_GAP 24
+#endif
+
+// Shortest period: room for one edge SOFTPWM_MIN_GAP after the period start and
+// SOFTPWM_MIN_GAP before the next one. Shorter periods are raised to it.
+#define SOFTPWM_MIN_PERIOD (2 * SOFTPWM_MIN_GAP)
+
+// standard RC-servo frame: 20ms
+#define SOFTPWM_SERVO_PERIOD (20000 * SOFTPWM_TICKS_PER_US)
+
+#define SOFTPWM_PORTS 3 // PORTB, PORTC, PORTD
+
+typedef struct SoftPwmEdgeT
+{
+    uint16_t at;                    // ticks from period start
+    uint8_t keep[SOFTPWM_PORTS];    // AND masks applied to PORTB/PORTC/PORTD
+} SoftPwmEdge;
+
+typedef struct SoftPwmScheduleT
+{
+    uint16_t period;                // period length in ticks
+    uint8_t count;                  // number of distinct edges
+    uint8_t set[SOFTPWM_PORTS];     // OR masks applied at period start
+    SoftPwmEdge edge[SOFTPWM_MAX_CHANNELS];
+} SoftPwmSchedule;
+
+/*! \brief Start the engine on timer1 compare A.
+ *
+ *  \param period	PWM period in timer ticks (SOFTPWM_MIN_PERIOD..65535),
+ *  				e.g. SOFTPWM_SERVO_PERIOD
+ */
+void softpwm_init(uint16_t period);
+
+//! Stop the engine and drive all attached pins low.
+void softpwm_stop(void);
+
+/*! \brief Attach a pin to the next free channel and make it an output (low).
+ *
+ *  \param PCINT_NO	The pin, refer PCINTRx define in pcint.h
+ *  \return channel number, or -1 if the pin is invalid or no channel is free
+ */
+int8_t softpwm_attach(uint8_t PCINT_NO);
+
+//! Record the duty of a channel in ticks. Takes effect on softpwm_commit().
+void softpwm_set(uint8_t ch, uint16_t ticks);
+
+//! Record a servo pulse width in microseconds. Takes effect on softpwm_commit().
+void softpwm_set_us(uint8_t ch, uint16_t us);
+
+//! Change the period, at least SOFTPWM_MIN_PERIOD. Takes effect on softpwm_commit().
+void softpwm_set_period(uint16_t period);
+
+/*! \brief Build the schedule from the recorded duties and hand it to the ISR.
+ *
+ *  The new schedule becomes active at the next period start. Calling it again
+ *  before the swap simply replaces the pending schedule.
+ */
+void softpwm_commit(void);
+
+//! Returns 1 while a committed schedule is still waiting for the period start.
+uint8_t softpwm_pending(void);
+
+#endif
@@ -0,0 +1,69 @@
+//*****************************************************************************
+// File Name	: softpwmtest.c
+//
+// Title		: example usage of software PWM / servo library functions
+// Revision		: 1.0
+// Notes		:
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Revision History:
+// When			Who			Description of change
+// -----------	-----------	-----------------------
+// 19-Oct-2026	flyingyizi		Created the program
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>		   // include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h> // include interrupt support
+
+#include <util/delay.h>
+#include "../serial/serial.h"
+#include "../util/print.h"
+#include <avr/pgmspace.h>
+
+#include "softpwm.h"
+
+//example
+// int main()
+// {
+//   // Initialize system upon power-up.
+//   serial_init(); // Setup serial baud rate and interrupts
+//   sei();         // Enable interrupts
+//   softpwmTest();
+//   return 0;
+// }
+
+// 12 servos on PORTD2..7 and PORTC0..5, swept in opposite directions
+void softpwmTest(void)
+{
+    static const uint8_t pins[] = {
+        PCINTR18, PCINTR19, PCINTR20, PCINTR21, PCINTR22, PCINTR23,
+        PCINTR8, PCINTR9, PCINTR10, PCINTR11, PCINTR12, PCINTR13};
+    uint8_t i, n = 0;
+
+    printPgmString(PSTR("\r\n\n\nWelcome to the software PWM library test program!\r\n"));
+
+    for (i = 0; i < sizeof(pins); i++)
+    {
+        if (softpwm_attach(pins[i]) >= 0)
+            n++;
+    }
+    softpwm_init(SOFTPWM_SERVO_PERIOD);
+
+    uint16_t us = 1000;
+    int8_t step = 10;
+    while (1)
+    {
+        for (i = 0; i < n; i++)
+        {
+            softpwm_set_us(i, (i & 1) ? (3000 - us) : us);
+        }
+        softpwm_commit();
+
+        _delay_ms(20);
+        us += step;
+        if (us >= 2000 || us <= 1000)
+            step = -step;
+    }
+}
@@ -0,0 +1,8 @@
+#ifndef SOFTPWMTEST_H
+#define SOFTPWMTEST_H
+
+#include "softpwm.h"
+
+void softpwmTest(void);
+
+#endif
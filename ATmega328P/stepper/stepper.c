@@ -0,0 +1,430 @@
+/*
+  stepper.c - stepper motor driver: executes motion plans using stepper motors
+  Part of Grbl
+
+  Copyright (c) 2011-2015 Sungeun K. Jeon
+  Copyright (c) 2009-2011 Simen Svale Skogsrud
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <avr/interrupt.h>
+#include <string.h>
+#include "stepper.h"
+#include "../serial/serial.h"
+#include "../timerx8/timerx8.h"
+#include "../trace/trace.h"
+#include "../load/load.h"
+
+// Stores the step counts of a block, pre-shifted by MAX_AMASS_LEVEL, so the
+// interrupt can derive the counts for any AMASS level with a right shift. The ring
+// is one shorter than the segment ring, so a block is never overwritten while a
+// queued segment still refers to it.
+typedef struct {
+  uint32_t steps[N_AXIS];
+  uint32_t step_event_count;
+  uint8_t direction_bits;
+} st_block_t;
+static st_block_t st_block_buffer[SEGMENT_BUFFER_SIZE-1];
+
+// Primary stepper segment ring buffer. Contains small, short line segments for the stepper
+// algorithm to execute, which are "checked-out" incrementally from the main program.
+typedef struct {
+  uint16_t n_step;          // Number of step events to be executed for this segment
+  uint8_t st_block_index;   // Stepper block data index. Uses this information to execute this segment.
+  uint16_t cycles_per_tick; // Step distance traveled per ISR tick, aka step rate.
+  uint8_t amass_level;      // Indicates AMASS level for the ISR to execute this segment
+  uint8_t prescaler;        // Timer1 clock select, 1:clk 2:clk/8 3:clk/64
+} segment_t;
+static segment_t segment_buffer[SEGMENT_BUFFER_SIZE];
+
+// Stepper ISR data struct. Contains the running data for the main stepper ISR.
+typedef struct {
+  // Used by the bresenham line algorithm
+  uint32_t counter_x,        // Counter variables for the bresenham line tracer
+           counter_y,
+           counter_z;
+
+  uint8_t execute_step;     // Flags step execution for each interrupt.
+  uint8_t step_pulse_time;  // Step pulse reset time after step rise
+  uint8_t step_outbits;         // The next stepping-bits to be output
+  uint8_t dir_outbits;
+  uint32_t steps[N_AXIS];
+
+  uint16_t step_count;       // Steps remaining in line segment motion
+  uint8_t exec_block_index; // Tracks the current st_block index. Change indicates new block.
+  st_block_t *exec_block;   // Pointer to the block data for the segment being executed
+  segment_t *exec_segment;  // Pointer to the segment being executed
+} stepper_t;
+static stepper_t st;
+
+// Step segment ring buffer indices
+static volatile uint8_t segment_buffer_tail;
+static uint8_t segment_buffer_head;
+static uint8_t segment_next_head;
+static uint8_t st_block_head;
+
+static volatile uint8_t busy;   // Used to avoid ISR nesting of the "Stepper Driver Interrupt". Should never occur though.
+static volatile uint8_t st_state;
+static volatile int32_t st_position[N_AXIS]; // Machine position in steps.
+
+static const uint8_t step_bit[N_AXIS] = { 1<<X_STEP_BIT, 1<<Y_STEP_BIT, 1<<Z_STEP_BIT };
+static const uint8_t direction_bit[N_AXIS] = { 1<<X_DIRECTION_BIT, 1<<Y_DIRECTION_BIT, 1<<Z_DIRECTION_BIT };
+
+
+/*    BLOCK VELOCITY PROFILE DEFINITION
+          __________________________
+         /|                        |\     _________________         ^
+        / |                        | \   /|               |\        |
+       /  |                        |  \ / |               | \       s
+      /   |                        |   |  |               |  \      p
+     /    |                        |   |  |               |   \     e
+    +-----+------------------------+---+--+---------------+----+    e
+    |               BLOCK 1            ^      BLOCK 2          |    d
+                                       |
+                  time ----->      EXAMPLE: Block 2 entry speed is at max junction velocity
+
+  The segment ring holds short pieces of such profiles, each at a constant step rate.
+  Whoever fills it (the planner) is responsible for the acceleration; this module only
+  emits the step events of each segment evenly spaced in time.
+
+  Each interrupt first outputs the step bits computed by the previous interrupt, then
+  starts timer0 to reset the step pins after the pulse time, and then runs the
+  Bresenham tracer for the next step event. The step output is therefore one tick late
+  but jitter free, independent of how long the tracer takes.
+*/
+
+
+// Stepper state initialization. Cycle should only start if the st.cycle_start flag is
+// enabled. Startup init and limits call this function but shouldn't start the cycle.
+void st_wake_up()
+{
+  // Enable stepper drivers.
+  STEPPERS_DISABLE_PORT &= ~(1<<STEPPERS_DISABLE_BIT);
+
+  // Initialize step pulse timing from settings. Timer0 counts at F_CPU/8 and the
+  // pulse ends on its overflow.
+  st.step_pulse_time = -(((STEP_PULSE_MICROSECONDS-2)*TICKS_PER_MICROSECOND) >> 3);
+
+  // Enable Stepper Driver Interrupt
+  TIMSK1 |= (1<<OCIE1A);
+}
+
+
+// Stepper shutdown
+void st_go_idle()
+{
+  // Disable Stepper Driver Interrupt. Allow Stepper Port Reset Interrupt to finish, if active.
+  TIMSK1 &= ~(1<<OCIE1A); // Disable Timer1 interrupt
+  TCCR1B = (TCCR1B & ~((1<<CS12) | (1<<CS11))) | (1<<CS10); // Reset clock to no prescaling.
+  busy = 0;
+
+  // Keep the drivers enabled to hold position. Use STEPPERS_DISABLE_PORT to free the axes.
+}
+
+
+/* "The Stepper Driver Interrupt" - This timer interrupt is the workhorse of Grbl. Grbl employs
+   the venerable Bresenham line algorithm to manage and exactly synchronize multi-axis moves.
+   Unlike the popular DDA algorithm, the Bresenham algorithm is not susceptible to numerical
+   round-off errors and only requires fast integer counters, meaning low computational overhead
+   and maximizing the Arduino's capabilities.
+   NOTE: Normally attached through timerAttach(). Define TIMER1_COMPA_STATIC (and
+   TIMER0_OVF_STATIC for the pulse reset) in DEFS to bind the vectors directly and save the
+   dispatch overhead at high step rates.
+*/
+#ifdef TIMER1_COMPA_STATIC
+ISR(TIMER1_COMPA_vect)
+#else
+static void st_step_interrupt(void)
+#endif
+{
+  if (busy) { return; } // The busy-flag is used to avoid reentering this interrupt
+  LOAD_ISR_ENTER(); // Before the sei() below, so nested interrupts count once
+
+  // Set the direction pins a couple of nanoseconds before we step the steppers
+  DIRECTION_PORT = (DIRECTION_PORT & ~DIRECTION_MASK) | (st.dir_outbits & DIRECTION_MASK);
+
+  // Then pulse the stepping pins
+  STEP_PORT = (STEP_PORT & ~STEP_MASK) | st.step_outbits;
+
+  // Enable step pulse reset timer so that The Stepper Port Reset Interrupt can reset the signal after
+  // exactly settings.pulse_microseconds microseconds, independent of the main Timer1 prescaler.
+  TCNT0 = st.step_pulse_time; // Reload Timer0 counter
+  TCCR0B = (1<<CS01); // Begin Timer0. Full speed, 1/8 prescaler
+
+  busy = 1;
+  sei(); // Re-enable interrupts to allow Stepper Port Reset Interrupt to fire on-time.
+         // NOTE: The remaining code in this ISR will finish before returning to main program.
+
+  // If there is no step segment, attempt to pop one from the stepper buffer
+  if (st.exec_segment == NULL) {
+    // Anything in the buffer? If so, load and initialize next step segment.
+    if (segment_buffer_head != segment_buffer_tail && st_state == ST_STATE_CYCLE) {
+      // Initialize new step segment and load number of steps to execute
+      st.exec_segment = &segment_buffer[segment_buffer_tail];
+
+      // Initialize step segment timing per step and load number of steps to execute.
+      TCCR1B = (TCCR1B & ~(0x07<<CS10)) | (st.exec_segment->prescaler<<CS10);
+      OCR1A = st.exec_segment->cycles_per_tick;
+      st.step_count = st.exec_segment->n_step; // NOTE: Can sometimes be zero when moving slow.
+      TRACE2(TR_ST_SEGMENT, segment_buffer_tail, st.exec_segment->n_step);
+
+      // If the new segment starts a new planner block, initialize stepper variables and counters.
+      // NOTE: When the segment data index changes, this indicates a new planner block.
+      if ( st.exec_block_index != st.exec_segment->st_block_index ) {
+        st.exec_block_index = st.exec_segment->st_block_index;
+        st.exec_block = &st_block_buffer[st.exec_block_index];
+
+        // Initialize Bresenham line and distance counters
+        st.counter_x = st.counter_y = st.counter_z = (st.exec_block->step_event_count >> 1);
+      }
+      st.dir_outbits = st.exec_block->direction_bits ^ DIR_INVERT_MASK;
+
+      // With AMASS enabled, adjust Bresenham axis increment counters according to AMASS level.
+      st.steps[X_AXIS] = st.exec_block->steps[X_AXIS] >> st.exec_segment->amass_level;
+      st.steps[Y_AXIS] = st.exec_block->steps[Y_AXIS] >> st.exec_segment->amass_level;
+      st.steps[Z_AXIS] = st.exec_block->steps[Z_AXIS] >> st.exec_segment->amass_level;
+
+    } else {
+      // Segment buffer empty, or a feed hold reached the segment boundary. Shutdown.
+      st_go_idle();
+      st_state = (segment_buffer_head != segment_buffer_tail) ? ST_STATE_QUEUED : ST_STATE_IDLE;
+      rt_exec_set(EXEC_CYCLE_STOP); // Flag main program for cycle end
+      LOAD_ISR_EXIT();
+      return; // Nothing to do but exit.
+    }
+  }
+
+  // Reset step out bits.
+  st.step_outbits = 0;
+
+  // Execute step displacement profile by Bresenham line algorithm
+  st.counter_x += st.steps[X_AXIS];
+  if (st.counter_x > st.exec_block->step_event_count) {
+    st.step_outbits |= (1<<X_STEP_BIT);
+    st.counter_x -= st.exec_block->step_event_count;
+    if (st.exec_block->direction_bits & (1<<X_DIRECTION_BIT)) { st_position[X_AXIS]--; }
+    else { st_position[X_AXIS]++; }
+  }
+  st.counter_y += st.steps[Y_AXIS];
+  if (st.counter_y > st.exec_block->step_event_count) {
+    st.step_outbits |= (1<<Y_STEP_BIT);
+    st.counter_y -= st.exec_block->step_event_count;
+    if (st.exec_block->direction_bits & (1<<Y_DIRECTION_BIT)) { st_position[Y_AXIS]--; }
+    else { st_position[Y_AXIS]++; }
+  }
+  st.counter_z += st.steps[Z_AXIS];
+  if (st.counter_z > st.exec_block->step_event_count) {
+    st.step_outbits |= (1<<Z_STEP_BIT);
+    st.counter_z -= st.exec_block->step_event_count;
+    if (st.exec_block->direction_bits & (1<<Z_DIRECTION_BIT)) { st_position[Z_AXIS]--; }
+    else { st_position[Z_AXIS]++; }
+  }
+
+  st.step_count--; // Decrement step events count
+  if (st.step_count == 0) {
+    // Segment is complete. Discard current segment and advance segment indexing.
+    st.exec_segment = NULL;
+    uint8_t tail = segment_buffer_tail + 1;
+    if (tail == SEGMENT_BUFFER_SIZE) { tail = 0; }
+    segment_buffer_tail = tail;
+    rt_exec_set(EXEC_PREP_BUFFER); // Flag main program to refill the ring
+  }
+
+  st.step_outbits ^= STEP_INVERT_MASK;  // Apply step port invert mask
+  busy = 0;
+  LOAD_ISR_EXIT();
+}
+
+
+/* The Stepper Port Reset Interrupt: Timer0 OVF interrupt handles the falling edge of the step
+   pulse. This should always trigger before the next Timer1 COMPA interrupt and independently
+   finish, if Timer1 is disabled after completing a move.
+*/
+#ifdef TIMER0_OVF_STATIC
+ISR(TIMER0_OVF_vect)
+#else
+static void st_reset_interrupt(void)
+#endif
+{
+  // Reset stepping pins (leave the direction pins)
+  STEP_PORT = (STEP_PORT & ~STEP_MASK) | (STEP_INVERT_MASK & STEP_MASK);
+  TCCR0B = 0; // Disable Timer0 to prevent re-entering this interrupt when it's not needed.
+}
+
+
+// Reset and clear stepper subsystem variables
+void st_reset()
+{
+  // Initialize stepper driver idle state.
+  st_go_idle();
+
+  memset(&st, 0, sizeof(st));
+  st.exec_segment = NULL;
+  st.exec_block_index = SEGMENT_BUFFER_SIZE; // Invalid index, forces a block load.
+  segment_buffer_tail = 0;
+  segment_buffer_head = 0; // empty = tail
+  segment_next_head = 1;
+  st_block_head = 0;
+  st_state = ST_STATE_IDLE;
+
+  // Initialize step and direction port pins.
+  st.dir_outbits = DIR_INVERT_MASK;
+  STEP_PORT = (STEP_PORT & ~STEP_MASK) | (STEP_INVERT_MASK & STEP_MASK);
+  DIRECTION_PORT = (DIRECTION_PORT & ~DIRECTION_MASK) | (DIR_INVERT_MASK & DIRECTION_MASK);
+}
+
+
+// Initialize and start the stepper motor subsystem
+void stepper_init()
+{
+  // Configure step and direction interface pins
+  STEP_DDR |= STEP_MASK;
+  STEPPERS_DISABLE_DDR |= 1<<STEPPERS_DISABLE_BIT;
+  DIRECTION_DDR |= DIRECTION_MASK;
+
+  // Configure Timer 1: Stepper Driver Interrupt
+  TCCR1B &= ~(1<<WGM13); // waveform generation = 0100 = CTC
+  TCCR1B |=  (1<<WGM12);
+  TCCR1A &= ~((1<<WGM11) | (1<<WGM10));
+  TCCR1A &= ~((1<<COM1A1) | (1<<COM1A0) | (1<<COM1B1) | (1<<COM1B0)); // Disconnect OC1 output
+  // TCCR1B = (TCCR1B & ~((1<<CS12) | (1<<CS11))) | (1<<CS10); // Set in st_go_idle().
+  // TIMSK1 &= ~(1<<OCIE1A);  // Set in st_go_idle().
+
+  // Configure Timer 0: Stepper Port Reset Interrupt
+  TIMSK0 &= ~((1<<OCIE0B) | (1<<OCIE0A) | (1<<TOIE0)); // Disconnect OC0 outputs and OVF interrupt.
+  TCCR0A = 0; // Normal operation
+  TCCR0B = 0; // Disable Timer0 until needed
+  TIMSK0 |= (1<<TOIE0); // Enable Timer0 overflow interrupt
+
+#ifndef TIMER1_COMPA_STATIC
+  timerAttach(TIMER1OUTCOMPAREA_INT, st_step_interrupt);
+#endif
+#ifndef TIMER0_OVF_STATIC
+  timerAttach(TIMER0OVERFLOW_INT, st_reset_interrupt);
+#endif
+
+  st_reset();
+}
+
+
+// Returns the number of free slots in the segment ring.
+uint8_t st_segment_buffer_available()
+{
+  uint8_t tail = segment_buffer_tail; // Copy to limit multiple calls to volatile
+  if (segment_buffer_head >= tail) {
+    return (SEGMENT_BUFFER_SIZE-1) - (segment_buffer_head - tail);
+  }
+  return (tail - segment_buffer_head) - 1;
+}
+
+
+int8_t st_push_block(const int32_t *steps)
+{
+  if (segment_buffer_tail == segment_next_head) { return -1; } // Segment ring full.
+
+  uint8_t idx = st_block_head;
+  st_block_t *b = &st_block_buffer[idx];
+  uint8_t i;
+  uint32_t count = 0;
+
+  b->direction_bits = 0;
+  for (i=0; i<N_AXIS; i++) {
+    uint32_t n;
+    if (steps[i] < 0) { n = -steps[i]; b->direction_bits |= direction_bit[i]; }
+    else { n = steps[i]; }
+    b->steps[i] = n << MAX_AMASS_LEVEL;
+    if (n > count) { count = n; }
+  }
+  b->step_event_count = count << MAX_AMASS_LEVEL;
+
+  if (++st_block_head == (SEGMENT_BUFFER_SIZE-1)) { st_block_head = 0; }
+  return idx;
+}
+
+
+uint8_t st_push_segment(uint8_t block_index, uint16_t n_step, uint32_t cycles_per_step)
+{
+  if (segment_buffer_tail == segment_next_head) { return 0; } // Segment ring full.
+
+  segment_t *prep_segment = &segment_buffer[segment_buffer_head];
+  prep_segment->st_block_index = block_index;
+
+  // Compute step timing and multi-axis smoothing level.
+  // NOTE: AMASS overdrives the timer with each level, so only one prescalar is required.
+  uint32_t cycles = cycles_per_step;
+  if (cycles < AMASS_LEVEL1) { prep_segment->amass_level = 0; }
+  else {
+    if (cycles < AMASS_LEVEL2) { prep_segment->amass_level = 1; }
+    else if (cycles < AMASS_LEVEL3) { prep_segment->amass_level = 2; }
+    else { prep_segment->amass_level = 3; }
+    cycles >>= prep_segment->amass_level;
+    n_step <<= prep_segment->amass_level;
+  }
+  prep_segment->n_step = n_step;
+  if (cycles < (1UL << 16)) { // < 65536 (4.1ms @ 16MHz)
+    prep_segment->prescaler = 1; // prescaler: 0
+    prep_segment->cycles_per_tick = cycles;
+  } else if (cycles < (1UL << 19)) { // < 524288 (32.8ms@16MHz)
+    prep_segment->prescaler = 2; // prescaler: 8
+    prep_segment->cycles_per_tick = cycles >> 3;
+  } else {
+    prep_segment->prescaler = 3; // prescaler: 64
+    if (cycles < (1UL << 22)) { // < 4194304 (262ms@16MHz)
+      prep_segment->cycles_per_tick =  cycles >> 6;
+    } else { // Just set the slowest speed possible. (Around 4 step/sec.)
+      prep_segment->cycles_per_tick = 0xffff;
+    }
+  }
+
+  // Segment complete! Increment segment buffer indices.
+  segment_buffer_head = segment_next_head;
+  if ( ++segment_next_head == SEGMENT_BUFFER_SIZE ) { segment_next_head = 0; }
+  return 1;
+}
+
+
+// Starts or resumes the cycle if there is anything to run. Called on EXEC_CYCLE_START.
+void st_cycle_start()
+{
+  if (st_state == ST_STATE_IDLE || st_state == ST_STATE_QUEUED) {
+    if (segment_buffer_head != segment_buffer_tail) {
+      st_state = ST_STATE_CYCLE;
+      st_wake_up();
+    }
+  }
+}
+
+
+// Stops stepping at the next segment boundary. Called on EXEC_FEED_HOLD.
+// NOTE: Segments run at a constant rate, so the motion stops from the speed of the current
+// segment. A deceleration to zero must come from whoever fills the segment ring.
+void st_feed_hold()
+{
+  if (st_state == ST_STATE_CYCLE) { st_state = ST_STATE_HOLD; }
+}
+
+
+uint8_t st_get_state() { return st_state; }
+
+
+void st_get_position(int32_t *position)
+{
+  uint8_t sreg = SREG;
+  cli();
+  position[X_AXIS] = st_position[X_AXIS];
+  position[Y_AXIS] = st_position[Y_AXIS];
+  position[Z_AXIS] = st_position[Z_AXIS];
+  SREG = sreg;
+}
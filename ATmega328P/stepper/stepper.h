@@ -0,0 +1,128 @@
+/*
+  stepper.h - stepper motor driver: executes motion plans of stepper.c using the stepper motors
+  Part of Grbl
+
+  Copyright (c) 2011-2015 Sungeun K. Jeon
+  Copyright (c) 2009-2011 Simen Svale Skogsrud
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef stepper_h
+#define stepper_h
+#include <avr/io.h>
+
+#define N_AXIS 3 // Number of axes
+#define X_AXIS 0 // Axis indexing value. Must start with 0 and be continuous.
+#define Y_AXIS 1
+#define Z_AXIS 2
+
+// Define step pulse output pins. NOTE: All step bit pins must be on the same port.
+#ifndef STEP_DDR
+  #define STEP_DDR        DDRD
+  #define STEP_PORT       PORTD
+  #define X_STEP_BIT      2  // Uno Digital Pin 2
+  #define Y_STEP_BIT      3  // Uno Digital Pin 3
+  #define Z_STEP_BIT      4  // Uno Digital Pin 4
+#endif
+#define STEP_MASK       ((1<<X_STEP_BIT)|(1<<Y_STEP_BIT)|(1<<Z_STEP_BIT)) // All step bits
+
+// Define step direction output pins. NOTE: All direction pins must be on the same port.
+#ifndef DIRECTION_DDR
+  #define DIRECTION_DDR     DDRD
+  #define DIRECTION_PORT    PORTD
+  #define X_DIRECTION_BIT   5  // Uno Digital Pin 5
+  #define Y_DIRECTION_BIT   6  // Uno Digital Pin 6
+  #define Z_DIRECTION_BIT   7  // Uno Digital Pin 7
+#endif
+#define DIRECTION_MASK    ((1<<X_DIRECTION_BIT)|(1<<Y_DIRECTION_BIT)|(1<<Z_DIRECTION_BIT)) // All direction bits
+
+// Define stepper driver enable/disable output pin.
+#ifndef STEPPERS_DISABLE_DDR
+  #define STEPPERS_DISABLE_DDR    DDRB
+  #define STEPPERS_DISABLE_PORT   PORTB
+  #define STEPPERS_DISABLE_BIT    0  // Uno Digital Pin 8
+#endif
+#define STEPPERS_DISABLE_MASK (1<<STEPPERS_DISABLE_BIT)
+
+// Port invert masks and step pulse length. Grbl keeps these in settings; here they are
+// build time options.
+#ifndef STEP_INVERT_MASK
+  #define STEP_INVERT_MASK 0
+#endif
+#ifndef DIR_INVERT_MASK
+  #define DIR_INVERT_MASK 0
+#endif
+#ifndef STEP_PULSE_MICROSECONDS
+  #define STEP_PULSE_MICROSECONDS 10
+#endif
+
+#define TICKS_PER_MICROSECOND (F_CPU/1000000)
+
+// Number of precomputed step segments. The ring is filled by the main program
+// (st_push_segment) and drained by the stepper interrupt.
+#ifndef SEGMENT_BUFFER_SIZE
+  #define SEGMENT_BUFFER_SIZE 6
+#endif
+
+// Adaptive Multi-Axis Step Smoothing (AMASS) levels. At low step rates the interrupt
+// runs at 2^level times the step rate, so the Bresenham error on the non-dominant
+// axes shrinks accordingly. The thresholds are the step periods, in CPU cycles,
+// above which the next level kicks in.
+#define MAX_AMASS_LEVEL 3
+#define AMASS_LEVEL1 (F_CPU/8000) // Over-drives ISR (x2). Defined as F_CPU/(Cutoff frequency in Hz)
+#define AMASS_LEVEL2 (F_CPU/4000) // Over-drives ISR (x4)
+#define AMASS_LEVEL3 (F_CPU/2000) // Over-drives ISR (x8)
+
+// Stepper execution states.
+#define ST_STATE_IDLE   0 // Nothing to run.
+#define ST_STATE_CYCLE  1 // Stepping through the segment ring.
+#define ST_STATE_HOLD   2 // Feed hold requested, stopping at the next segment boundary.
+#define ST_STATE_QUEUED 3 // Held with segments pending. Resumed by cycle start.
+
+// Initialize and setup the stepper motor subsystem
+void stepper_init();
+
+// Enable steppers, but cycle does not start unless called by motion control or realtime command.
+void st_wake_up();
+
+// Immediately disables steppers
+void st_go_idle();
+
+// Reset the stepper subsystem variables and empty the segment ring.
+void st_reset();
+
+// Queue a new block of step counts for the following segments. Returns the block index
+// to pass to st_push_segment(), or -1 if the segment ring is full. Every block must
+// receive at least one segment before the next block is pushed.
+int8_t st_push_block(const int32_t *steps);
+
+// Queue a segment of n_step step events of the given block, one step event every
+// cycles_per_step CPU cycles. Returns 0 if the segment ring is full.
+uint8_t st_push_segment(uint8_t block_index, uint16_t n_step, uint32_t cycles_per_step);
+
+// Returns the number of free slots in the segment ring.
+uint8_t st_segment_buffer_available();
+
+// Realtime command entry points, called from protocol_execute_realtime().
+void st_cycle_start();
+void st_feed_hold();
+
+// Returns the current ST_STATE_*.
+uint8_t st_get_state();
+
+// Copies the machine position in steps.
+void st_get_position(int32_t *position);
+
+#endif
@@ -0,0 +1,97 @@
+/*
+  telemetry.c - Binary telemetry frames, see telemetry.h
+*/
+
+#include "telemetry.h"
+
+#ifdef TELEMETRY
+
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include "../serial/serial.h"
+
+_Static_assert(TLM_MAX_PAYLOAD + 2 < 254, "telemetry frame needs more than one COBS code");
+
+#define TLM_DESCRIPTOR_ENTRY(id, desc) \
+  static const char tlm_descriptor_##id[] PROGMEM = desc; \
+  _Static_assert(sizeof(desc) + 1 <= TLM_MAX_PAYLOAD, "telemetry descriptor too long"); \
+  _Static_assert((id) >= 1 && (id) <= 8, "telemetry schema id out of range");
+TELEMETRY_SCHEMAS(TLM_DESCRIPTOR_ENTRY)
+#define TLM_DESCRIPTOR_INDEX(id, desc) [id] = tlm_descriptor_##id,
+static const char * const tlm_descriptors[9] PROGMEM = {
+  TELEMETRY_SCHEMAS(TLM_DESCRIPTOR_INDEX)
+};
+
+static uint8_t tlm_buffer[TLM_MAX_PAYLOAD + 2]; // Payload and CRC
+static uint8_t tlm_length;   // Bytes in tlm_buffer, 0xff once the frame overflowed
+static uint8_t tlm_described; // Schemas whose descriptor frame has been sent, bit id-1
+
+// Writes buffer as one COBS frame between two zero delimiters. Each zero-free run goes out
+// as its length+1 and the run itself; the zero after it is implied. len < 254, so no run
+// needs the 0xff code.
+static void tlm_write_frame(const uint8_t *p, uint8_t len)
+{
+  serial_write(0);
+  for (;;) {
+    uint8_t run = 0;
+    while ((run < len) && p[run]) { run++; }
+    serial_write(run + 1);
+    serial_write_block((const char *)p, run);
+    if (run == len) { break; }
+    p += run + 1; // Skip the zero
+    len -= run + 1;
+  }
+  serial_write(0);
+}
+
+static void tlm_finish()
+{
+  uint16_t crc = 0;
+  uint8_t i;
+
+  for (i = 0; i < tlm_length; i++) { crc = _crc_xmodem_update(crc, tlm_buffer[i]); }
+  tlm_buffer[tlm_length++] = crc >> 8;
+  tlm_buffer[tlm_length++] = crc;
+  tlm_write_frame(tlm_buffer, tlm_length);
+}
+
+void tlm_put(const void *data, uint8_t len)
+{
+  const uint8_t *p = data;
+  if ((tlm_length > TLM_MAX_PAYLOAD) || (len > TLM_MAX_PAYLOAD - tlm_length)) {
+    tlm_length = 0xff;
+    return;
+  }
+  while (len--) { tlm_buffer[tlm_length++] = *p++; }
+}
+
+void tlm_begin(uint8_t schema)
+{
+  uint8_t mask = 1 << (schema - 1);
+  if (!(tlm_described & mask)) {
+    const char *desc = pgm_read_ptr(&tlm_descriptors[schema]);
+    char c;
+    tlm_described |= mask;
+    tlm_length = 0;
+    tlm_buffer[tlm_length++] = 0; // Descriptor frame
+    tlm_buffer[tlm_length++] = schema;
+    while ((c = pgm_read_byte(desc++))) { tlm_buffer[tlm_length++] = c; }
+    tlm_finish();
+  }
+  tlm_length = 0;
+  tlm_buffer[tlm_length++] = schema;
+}
+
+uint8_t tlm_begin_size(uint8_t schema)
+{
+  if (tlm_described & (1 << (schema - 1))) { return 0; }
+  // Zero delimiters, COBS code, the 0 and schema id, CRC
+  return strlen_P(pgm_read_ptr(&tlm_descriptors[schema])) + 7;
+}
+
+void tlm_end()
+{
+  if (tlm_length <= TLM_MAX_PAYLOAD) { tlm_finish(); }
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+  telemetry.h - Binary telemetry frames alongside the ASCII protocol
+
+  Enabled with -DTELEMETRY. A frame is 0x00, the COBS encoding of <schema id> <fields> <CRC-16>,
+  then 0x00. COBS removes every zero from the encoded bytes, and ASCII text never contains a
+  zero, so frames and text lines share the TX ring and the host splits them on the zeros. The
+  leading zero also resyncs a host that joined in the middle of a frame. The CRC is CRC-16/XMODEM
+  (avr-libc _crc_xmodem_update()) over the schema id and fields, sent high byte first.
+
+  Fields are little-endian, as the AVR stores them. Each schema is a PROGMEM descriptor,
+  "<name>:<field>,<field>..." where a field is a type letter and a name: B/b u8/i8, H/h u16/i16,
+  I/i u32/i32, q Q16.16. The first frame of a schema after reset is preceded by a descriptor
+  frame (schema id 0, then the id and the descriptor text), so tools/telemetry.py can decode
+  a stream without the firmware source.
+*/
+
+#ifndef telemetry_h
+#define telemetry_h
+#include <avr/io.h>
+
+// Payload bytes per frame: schema id and fields. Must stay below 254, so one COBS code covers
+// every zero-free run.
+#ifndef TLM_MAX_PAYLOAD
+  #define TLM_MAX_PAYLOAD 40
+#endif
+
+// Schemas: X(id, descriptor). Ids 1 to 8.
+#define TLM_SCHEMA_STATUS 1
+#define TLM_SCHEMA_TRACE 2 // Trace records, see trace.h. Not a field list.
+#define TELEMETRY_SCHEMAS(X) \
+  X(TLM_SCHEMA_STATUS, "status:Bstate,qx,qy,qz,Bplan,Brx") \
+  X(TLM_SCHEMA_TRACE,  "trace:")
+
+// Starts a frame of the given schema. Fields follow with tlm_put() and the typed helpers.
+void tlm_begin(uint8_t schema);
+
+// Bytes tlm_begin(schema) writes before the frame itself: the descriptor frame the first time,
+// 0 after that. For callers that must not wait for TX room.
+uint8_t tlm_begin_size(uint8_t schema);
+
+// Appends a field. Fields past TLM_MAX_PAYLOAD drop the whole frame.
+void tlm_put(const void *data, uint8_t len);
+static inline void tlm_u8(uint8_t v)   { tlm_put(&v, 1); }
+static inline void tlm_u16(uint16_t v) { tlm_put(&v, 2); }
+static inline void tlm_u32(uint32_t v) { tlm_put(&v, 4); }
+
+// Appends the CRC and writes the COBS frame into the TX ring.
+void tlm_end();
+
+#endif
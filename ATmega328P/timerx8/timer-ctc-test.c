@@ -23,6 +23,7 @@
 #include "../util/print.h"
 
 #include "timerx8.h"  // include timer function library (timing, PWM, etc)
+#include "timercalc.h"  // compile-time prescaler/TOP solver
 
 #define sbi(reg, bit) (reg |= (_BV(bit)))
 #define cbi(reg, bit) (reg &= ~(_BV(bit)))
@@ -243,3 +244,22 @@ void timer0_CTC_ISR_test(void) {
 
   while(1);
 }
+
+// 测试 中断ctc, 由 timercalc.h 在编译期算出预分频和OCR0A
+// 1kHz control-loop rate; the build fails if it cannot be hit exactly
+#define LOOP_CYCLES TIMER_CYCLES_HZ(1000)
+TIMER0_CTC_ASSERT(LOOP_CYCLES, 0);
+
+void timer0_CTC_rate_test(void) {
+  // set OC0A to output  (PCINT22/OC0A/AIN0) PD6
+  DDRD |= _BV(DDD6);
+  abc = 0;
+  timerAttach(TIMER0OUTCOMPAREA_INT, __userFunc);
+
+  timer0ClockSel(TIMER_CLK_STOP);  // stop
+  timer0Mode(2 /* ctc mode */);
+  // TIMER_CLK_DIV64, OCR0A = 249
+  timer0COMPA_INT_Init(TIMER0_CTC_PRESCALER(LOOP_CYCLES), 0, TIMER0_CTC_TOP(LOOP_CYCLES));
+
+  while(1);
+}
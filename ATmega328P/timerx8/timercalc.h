@@ -0,0 +1,154 @@
+/*! \file timercalc.h \brief Compile-time prescaler/TOP solver for timer CTC and PWM setup. */
+//*****************************************************************************
+//
+// File Name	: 'timercalc.h'
+// Title		: Compile-time frequency-to-register solver for ATmegaXX8 timers
+// Author		: flyingyizi
+// Created		: 10/19/2026
+// Revised		:
+// Version		: 1.0
+// Target MCU	: Atmel AVR Series
+// Editor Tabs	: 4
+//
+///	\ingroup driver_avr
+/// \par Overview
+///		Picking a prescaler and a TOP value by hand for a wanted rate is
+///	error prone. The macros below take a target frequency (Hz) or period
+///	(us), pick the smallest prescaler whose TOP still fits the timer (i.e.
+///	the best resolution) and yield the clock select value, the TOP and the
+///	resulting error. Everything folds to constants, so no setup math is
+///	left at runtime and timer0GetPrescaler() is not needed.
+///
+///	The input is given in CPU cycles per period; use TIMER_CYCLES_HZ() or
+///	TIMER_CYCLES_US() to get it. For CTC and fast PWM with TOP in OCRnA/ICR1
+///	one period is div*(TOP+1) cycles; for phase correct PWM it is 2*div*TOP.
+///
+/// \code
+///	#define LOOP_CYCLES TIMER_CYCLES_HZ(1000)
+///	TIMER0_CTC_ASSERT(LOOP_CYCLES, 0);	// exact 1kHz or fail the build
+///	timer0COMPA_INT_Init(TIMER0_CTC_PRESCALER(LOOP_CYCLES), 0, TIMER0_CTC_TOP(LOOP_CYCLES));
+///	timer0Mode(2);
+/// \endcode
+///
+//*****************************************************************************
+//@{
+
+#ifndef TIMERCALC_H
+#define TIMERCALC_H
+
+#include "timerx8.h"
+
+// cycles per period for a frequency or a period, rounded to nearest
+#define TIMER_CYCLES_HZ(hz) ((((unsigned long)F_CPU) + ((unsigned long)(hz)) / 2) / ((unsigned long)(hz)))
+#define TIMER_CYCLES_US(us) ((unsigned long)(((unsigned long long)F_CPU * (us) + 500000ULL) / 1000000ULL))
+
+// TOP for one divisor: CTC / fast PWM (period = div*(TOP+1))
+#define TIMER_TOP_CTC(cycles, div) (((cycles) + (div) / 2) / TIMER_DIV_NZ(div) - 1)
+// TOP for one divisor: phase correct PWM (period = 2*div*TOP)
+#define TIMER_TOP_PC(cycles, div) (((cycles) + (div)) / (2UL * TIMER_DIV_NZ(div)))
+// a divisor of 0 means "no prescaler fits"; keep the expressions defined anyway
+#define TIMER_DIV_NZ(div) ((div) ? (div) : 1UL)
+
+#define TIMER_FITS(top, max) ((top) >= 1 && (top) <= (max))
+
+// Divisor chosen for timer0/timer1 (prescaler set 1,8,64,256,1024); 0 if none fits
+#define TIMER_DIV5(cycles, max, T)                                    \
+    (TIMER_FITS(T(cycles, 1UL), max) ? 1UL :                          \
+     TIMER_FITS(T(cycles, 8UL), max) ? 8UL :                          \
+     TIMER_FITS(T(cycles, 64UL), max) ? 64UL :                        \
+     TIMER_FITS(T(cycles, 256UL), max) ? 256UL :                      \
+     TIMER_FITS(T(cycles, 1024UL), max) ? 1024UL : 0UL)
+
+// Divisor chosen for timer2 (prescaler set 1,8,32,64,128,256,1024); 0 if none fits
+#define TIMER_DIV7(cycles, max, T)                                    \
+    (TIMER_FITS(T(cycles, 1UL), max) ? 1UL :                          \
+     TIMER_FITS(T(cycles, 8UL), max) ? 8UL :                          \
+     TIMER_FITS(T(cycles, 32UL), max) ? 32UL :                        \
+     TIMER_FITS(T(cycles, 64UL), max) ? 64UL :                        \
+     TIMER_FITS(T(cycles, 128UL), max) ? 128UL :                      \
+     TIMER_FITS(T(cycles, 256UL), max) ? 256UL :                      \
+     TIMER_FITS(T(cycles, 1024UL), max) ? 1024UL : 0UL)
+
+// divisor -> clock select value
+#define TIMER_CLK5(div)                                               \
+    ((div) == 1 ? TIMER_CLK_DIV1 : (div) == 8 ? TIMER_CLK_DIV8 :      \
+     (div) == 64 ? TIMER_CLK_DIV64 : (div) == 256 ? TIMER_CLK_DIV256 : \
+     (div) == 1024 ? TIMER_CLK_DIV1024 : TIMER_CLK_STOP)
+#define TIMER_CLK7(div)                                                   \
+    ((div) == 1 ? TIMERRTC_CLK_DIV1 : (div) == 8 ? TIMERRTC_CLK_DIV8 :    \
+     (div) == 32 ? TIMERRTC_CLK_DIV32 : (div) == 64 ? TIMERRTC_CLK_DIV64 : \
+     (div) == 128 ? TIMERRTC_CLK_DIV128 : (div) == 256 ? TIMERRTC_CLK_DIV256 : \
+     (div) == 1024 ? TIMERRTC_CLK_DIV1024 : TIMERRTC_CLK_STOP)
+
+// error of the achieved period against the wanted one, in cycles and in ppm
+#define TIMER_ERR_CTC(cycles, div) ((long)((div) * (TIMER_TOP_CTC(cycles, div) + 1)) - (long)(cycles))
+#define TIMER_ERR_PC(cycles, div) ((long)(2 * (div) * TIMER_TOP_PC(cycles, div)) - (long)(cycles))
+#define TIMER_PPM(err, cycles) ((long)(((long long)(err) * 1000000LL) / (long long)(cycles)))
+#define TIMER_ABS(x) ((x) < 0 ? -(x) : (x))
+
+// compile time check, also usable at file scope
+#if defined(__cplusplus) && __cplusplus >= 201103L
+#define TIMER_STATIC_ASSERT(cond, msg) static_assert(cond, msg)
+#elif defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6))
+#define TIMER_STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)
+#else
+#define TIMER_STATIC_ASSERT_CAT_(a, b) a##b
+#define TIMER_STATIC_ASSERT_CAT(a, b) TIMER_STATIC_ASSERT_CAT_(a, b)
+#define TIMER_STATIC_ASSERT(cond, msg) \
+    typedef char TIMER_STATIC_ASSERT_CAT(timer_static_assert_, __LINE__)[(cond) ? 1 : -1]
+#endif
+
+/// @name timer0 (8 bit) CTC / fast PWM with TOP in OCR0A (modes 2 and 7)
+//@{
+#define TIMER0_CTC_DIV(cycles) TIMER_DIV5(cycles, 255UL, TIMER_TOP_CTC)
+#define TIMER0_CTC_PRESCALER(cycles) TIMER_CLK5(TIMER0_CTC_DIV(cycles))
+#define TIMER0_CTC_TOP(cycles) ((uint8_t)TIMER_TOP_CTC(cycles, TIMER0_CTC_DIV(cycles)))
+#define TIMER0_CTC_ERR(cycles) TIMER_ERR_CTC(cycles, TIMER0_CTC_DIV(cycles))
+#define TIMER0_CTC_PPM(cycles) TIMER_PPM(TIMER0_CTC_ERR(cycles), cycles)
+#define TIMER0_CTC_ASSERT(cycles, max_ppm)                                          \
+    TIMER_STATIC_ASSERT(TIMER0_CTC_DIV(cycles) != 0 &&                              \
+                        TIMER_ABS(TIMER0_CTC_PPM(cycles)) <= (max_ppm),             \
+                        "timer0: rate not reachable within tolerance")
+//@}
+
+/// @name timer1 (16 bit) CTC / fast PWM with TOP in OCR1A or ICR1 (modes 4, 12, 14, 15)
+//@{
+#define TIMER1_CTC_DIV(cycles) TIMER_DIV5(cycles, 65535UL, TIMER_TOP_CTC)
+#define TIMER1_CTC_PRESCALER(cycles) TIMER_CLK5(TIMER1_CTC_DIV(cycles))
+#define TIMER1_CTC_TOP(cycles) ((uint16_t)TIMER_TOP_CTC(cycles, TIMER1_CTC_DIV(cycles)))
+#define TIMER1_CTC_ERR(cycles) TIMER_ERR_CTC(cycles, TIMER1_CTC_DIV(cycles))
+#define TIMER1_CTC_PPM(cycles) TIMER_PPM(TIMER1_CTC_ERR(cycles), cycles)
+#define TIMER1_CTC_ASSERT(cycles, max_ppm)                                          \
+    TIMER_STATIC_ASSERT(TIMER1_CTC_DIV(cycles) != 0 &&                              \
+                        TIMER_ABS(TIMER1_CTC_PPM(cycles)) <= (max_ppm),             \
+                        "timer1: rate not reachable within tolerance")
+//@}
+
+/// @name timer1 (16 bit) phase correct PWM with TOP in OCR1A or ICR1 (modes 10, 11)
+//@{
+#define TIMER1_PC_DIV(cycles) TIMER_DIV5(cycles, 65535UL, TIMER_TOP_PC)
+#define TIMER1_PC_PRESCALER(cycles) TIMER_CLK5(TIMER1_PC_DIV(cycles))
+#define TIMER1_PC_TOP(cycles) ((uint16_t)TIMER_TOP_PC(cycles, TIMER1_PC_DIV(cycles)))
+#define TIMER1_PC_ERR(cycles) TIMER_ERR_PC(cycles, TIMER1_PC_DIV(cycles))
+#define TIMER1_PC_PPM(cycles) TIMER_PPM(TIMER1_PC_ERR(cycles), cycles)
+#define TIMER1_PC_ASSERT(cycles, max_ppm)                                           \
+    TIMER_STATIC_ASSERT(TIMER1_PC_DIV(cycles) != 0 &&                               \
+                        TIMER_ABS(TIMER1_PC_PPM(cycles)) <= (max_ppm),              \
+                        "timer1: PWM rate not reachable within tolerance")
+//@}
+
+/// @name timer2 (8 bit, RTC prescaler set) CTC / fast PWM with TOP in OCR2A
+//@{
+#define TIMER2_CTC_DIV(cycles) TIMER_DIV7(cycles, 255UL, TIMER_TOP_CTC)
+#define TIMER2_CTC_PRESCALER(cycles) TIMER_CLK7(TIMER2_CTC_DIV(cycles))
+#define TIMER2_CTC_TOP(cycles) ((uint8_t)TIMER_TOP_CTC(cycles, TIMER2_CTC_DIV(cycles)))
+#define TIMER2_CTC_ERR(cycles) TIMER_ERR_CTC(cycles, TIMER2_CTC_DIV(cycles))
+#define TIMER2_CTC_PPM(cycles) TIMER_PPM(TIMER2_CTC_ERR(cycles), cycles)
+#define TIMER2_CTC_ASSERT(cycles, max_ppm)                                          \
+    TIMER_STATIC_ASSERT(TIMER2_CTC_DIV(cycles) != 0 &&                              \
+                        TIMER_ABS(TIMER2_CTC_PPM(cycles)) <= (max_ppm),             \
+                        "timer2: rate not reachable within tolerance")
+//@}
+
+#endif
+//@}
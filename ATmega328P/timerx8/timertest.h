@@ -4,5 +4,6 @@
 #include "timerx8.h"
 
 void timer1Test(void);
+void timer0_CTC_rate_test(void);
 
 #endif
\ No newline at end of file
@@ -297,6 +297,10 @@ void timer1PWMBSet(uint16_t pwmDuty)
 	OCR1B = pwmDuty;
 }
 
+// TIMERx_OVF_STATIC / TIMERx_COMPx_STATIC: another module (e.g. dds.c,
+// stepper.c) binds the vector directly for the shortest possible latency;
+// timerAttach() has no effect on it then.
+#ifndef TIMER0_OVF_STATIC
 //! Interrupt handler for tcnt0 overflow interrupt//(SIG_OVERFLOW0)
 ISR(TIMER0_OVF_vect)
 {
@@ -309,7 +313,9 @@ ISR(TIMER0_OVF_vect)
 	if (TimerIntFunc[TIMER0OVERFLOW_INT])
 		TimerIntFunc[TIMER0OVERFLOW_INT]();
 }
+#endif
 
+#ifndef TIMER1_OVF_STATIC
 //! Interrupt handler for tcnt1 overflow interrupt(SIG_OVERFLOW1)
 ISR(TIMER1_OVF_vect)
 {
@@ -317,11 +323,13 @@ ISR(TIMER1_OVF_vect)
 	if (TimerIntFunc[TIMER1OVERFLOW_INT])
 		TimerIntFunc[TIMER1OVERFLOW_INT]();
 }
+#endif
 
 #ifdef TCNT2 // support timer2 only if it exists
 //! Interrupt handler for tcnt2 overflow interrupt
 
 // (SIG_OVERFLOW2)
+#ifndef TIMER2_OVF_STATIC
 ISR(TIMER2_OVF_vect)
 {
 	Timer2Reg0++; // increment low-order counter
@@ -331,6 +339,7 @@ ISR(TIMER2_OVF_vect)
 		TimerIntFunc[TIMER2OVERFLOW_INT]();
 }
 #endif
+#endif
 
 #if  defined(OCR0)
 // include support for Output Compare 0 for new AVR processors that support it
@@ -350,7 +359,6 @@ ISR(TIMER0_COMPA_vect)
 }
 ISR(TIMER0_COMPB_vect)
 {
-	Timer0_b_cmpReg++;
 	// if a user function is defined, execute it
 	if (TimerIntFunc[TIMER0OUTCOMPAREB_INT])
 		TimerIntFunc[TIMER0OUTCOMPAREB_INT]();
@@ -358,6 +366,7 @@ ISR(TIMER0_COMPB_vect)
 #endif
 
 
+#ifndef TIMER1_COMPA_STATIC
 //! Interrupt handler for CutputCompare1A match (OC1A) interrupt(SIG_OUTPUT_COMPARE1A)
 ISR(TIMER1_COMPA_vect)
 {
@@ -365,6 +374,7 @@ ISR(TIMER1_COMPA_vect)
 	if (TimerIntFunc[TIMER1OUTCOMPAREA_INT])
 		TimerIntFunc[TIMER1OUTCOMPAREA_INT]();
 }
+#endif
 
 //! Interrupt handler for OutputCompare1B match (OC1B) interrupt(SIG_OUTPUT_COMPARE1B)
 ISR(TIMER1_COMPB_vect)
@@ -385,12 +395,15 @@ ISR(TIMER1_CAPT_vect)
 //! Interrupt handler for OutputCompare2A match (OC2A) interrupt
 
 // (SIG_OUTPUT_COMPARE2A)
+// With PROFILE the vector belongs to the sampling profiler (profile.c).
+#if !defined(TIMER2_COMPA_STATIC) && !defined(PROFILE)
 ISR(TIMER2_COMPA_vect)
 {
 	// if a user function is defined, execute it
 	if (TimerIntFunc[TIMER2OUTCOMPARE_INT])
 		TimerIntFunc[TIMER2OUTCOMPARE_INT]();
 }
+#endif
 
 //! Interrupt handler for OutputCompare2B match (OC2B) interrupt(SIG_OUTPUT_COMPARE2B)
 ISR(TIMER2_COMPB_vect)
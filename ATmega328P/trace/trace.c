@@ -0,0 +1,88 @@
+/*
+  trace.c - Deferred binary trace log, see trace.h
+*/
+
+#include "trace.h"
+
+#ifdef TRACE
+
+#include <avr/interrupt.h>
+#include "../serial/serial.h"
+#include "../telemetry/telemetry.h"
+
+_Static_assert((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0 && TRACE_BUFFER_SIZE <= 256,
+               "TRACE_BUFFER_SIZE must be a power of two up to 256");
+_Static_assert(TR_COUNT <= 256, "too many trace formats for a one byte id");
+
+#define TRACE_MASK (TRACE_BUFFER_SIZE - 1)
+
+// The format strings, id order, in a section without the alloc flag: it stays in the ELF for
+// tools/trace.py and never reaches flash.
+#define TRACE_FORMAT_ASM(id, format) ".asciz " #format "\n"
+__asm__(".pushsection .trace_fmt,\"\",@progbits\n"
+        TRACE_FORMATS(TRACE_FORMAT_ASM)
+        ".popsection\n");
+
+// Records are <length> <id> <arguments>. The length byte stays in the ring, so trace_drain()
+// can send whole records only.
+static uint8_t trace_buffer[TRACE_BUFFER_SIZE];
+static volatile uint8_t trace_head; // Written by trace_write(), any context
+static volatile uint8_t trace_tail; // Written by trace_drain()
+static volatile uint8_t trace_dropped;
+
+void trace_write(const void *record, uint8_t len)
+{
+  const uint8_t *p = record;
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t head = trace_head;
+  if ((uint8_t)((trace_tail - head - 1) & TRACE_MASK) <= len) {
+    if (trace_dropped != 0xff) { trace_dropped++; }
+  } else {
+    trace_buffer[head] = len;
+    do {
+      head = (head + 1) & TRACE_MASK;
+      trace_buffer[head] = *p++;
+    } while (--len);
+    trace_head = (head + 1) & TRACE_MASK;
+  }
+  SREG = sreg;
+}
+
+// Frame overhead on the wire: zero delimiters, COBS code, schema id, drop count, CRC.
+#define TRACE_FRAME_OVERHEAD 7
+
+void trace_drain()
+{
+  uint8_t tail = trace_tail;
+  uint8_t head = trace_head;
+  if ((tail == head) && !trace_dropped) { return; }
+
+  uint16_t room = (TX_BUFFER_SIZE - 1) - serial_get_tx_buffer_count();
+  uint8_t overhead = TRACE_FRAME_OVERHEAD + tlm_begin_size(TLM_SCHEMA_TRACE); // First frame: descriptor
+  if (room < overhead + 1) { return; } // Not even a one byte record
+  room -= overhead;
+  if (room > TLM_MAX_PAYLOAD - 2) { room = TLM_MAX_PAYLOAD - 2; } // Schema id and drop count
+
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t dropped = trace_dropped;
+  trace_dropped = 0;
+  SREG = sreg;
+  tlm_begin(TLM_SCHEMA_TRACE);
+  tlm_u8(dropped);
+  while (tail != head) {
+    uint8_t len = trace_buffer[tail];
+    if (len > room) { break; }
+    room -= len;
+    do {
+      tail = (tail + 1) & TRACE_MASK;
+      tlm_u8(trace_buffer[tail]);
+    } while (--len);
+    tail = (tail + 1) & TRACE_MASK;
+  }
+  trace_tail = tail;
+  tlm_end();
+}
+
+#endif
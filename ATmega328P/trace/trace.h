@@ -0,0 +1,70 @@
+/*
+  trace.h - Deferred binary trace log
+
+  Enabled with -DTRACE (needs -DTELEMETRY). TRACE0()..TRACE3() store a one byte format id and
+  the raw argument bytes in a RAM ring, with interrupts off for the copy only, so they are safe
+  from ISRs and cost tens of cycles. Nothing is formatted on the MCU. trace_drain(), called
+  from the idle point of the main loop, moves whole records into telemetry frames
+  (TLM_SCHEMA_TRACE) as far as the TX ring has room right now; it does not wait for it. When
+  the ring is full, events are dropped and counted, and the count goes out with the next frame.
+
+  The format strings are kept in the non-loaded ELF section .trace_fmt, in id order, so they
+  take no flash. tools/trace.py reads them from Debug/bin/<BIN>.elf and rebuilds the messages.
+  Arguments are stored with the size of their C type and printed by the host with the format:
+  %hhu/%hhd/%hhx/%c for 8 bits, %u/%d/%x for 16, %lu/%ld/%lx for 32. Cast where they differ.
+*/
+
+#ifndef trace_h
+#define trace_h
+#include <avr/io.h>
+
+#if defined(TRACE) && !defined(TELEMETRY)
+  #error "TRACE sends its records in telemetry frames, define TELEMETRY too"
+#endif
+
+// Ring size in bytes, a power of two. Each record takes its size plus one.
+#ifndef TRACE_BUFFER_SIZE
+  #define TRACE_BUFFER_SIZE 128
+#endif
+
+// Trace points: X(id, format). Ids are assigned in order from 1, and the formats go to
+// .trace_fmt in the same order.
+#define TRACE_FORMATS(X) \
+  X(TR_RX_OVERFLOW, "serial: RX overflow") \
+  X(TR_PLAN_BLOCK,  "plan: block queued, %hhu in buffer") \
+  X(TR_ST_SEGMENT,  "st: segment %hhu, %u steps")
+
+#define TRACE_ID_ENUM(id, format) id,
+enum { TR_NONE, TRACE_FORMATS(TRACE_ID_ENUM) TR_COUNT };
+
+#ifdef TRACE
+  // Appends one record. Any context, interrupts on or off.
+  void trace_write(const void *record, uint8_t len);
+
+  // Sends buffered records if the TX ring has room. Main loop only.
+  void trace_drain();
+
+  #define TRACE0(id) do { uint8_t trace_r = (id); trace_write(&trace_r, 1); } while (0)
+  #define TRACE1(id,a) do { \
+      struct __attribute__((packed)) { uint8_t i; __typeof__(a) a0; } trace_r = { (id), (a) }; \
+      trace_write(&trace_r, sizeof(trace_r)); \
+    } while (0)
+  #define TRACE2(id,a,b) do { \
+      struct __attribute__((packed)) { uint8_t i; __typeof__(a) a0; __typeof__(b) a1; } \
+        trace_r = { (id), (a), (b) }; \
+      trace_write(&trace_r, sizeof(trace_r)); \
+    } while (0)
+  #define TRACE3(id,a,b,c) do { \
+      struct __attribute__((packed)) { uint8_t i; __typeof__(a) a0; __typeof__(b) a1; __typeof__(c) a2; } \
+        trace_r = { (id), (a), (b), (c) }; \
+      trace_write(&trace_r, sizeof(trace_r)); \
+    } while (0)
+#else
+  #define trace_drain()
+  #define TRACE0(id) do {} while (0)
+  #define TRACE1(id,a) do {} while (0)
+  #define TRACE2(id,a,b) do {} while (0)
+  #define TRACE3(id,a,b,c) do {} while (0)
+#endif
+
+#endif
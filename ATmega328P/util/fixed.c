@@ -0,0 +1,136 @@
+/*
+  fixed.c - Q-format binary fixed point, see fixed.h
+*/
+
+#include "fixed.h"
+#include <avr/pgmspace.h>
+#include "report.h"
+
+#define FIXED_MAX INT32_MAX
+#define FIXED_MIN INT32_MIN
+
+// Saturates a 64-bit intermediate to int32.
+static int32_t fixed_saturate(int64_t v)
+{
+  if (v > FIXED_MAX) { return(FIXED_MAX); }
+  if (v < FIXED_MIN) { return(FIXED_MIN); }
+  return(v);
+}
+
+// The 32x32 product widens to 64 bits, which avr-gcc does with the hardware multiplier
+// (__mulsidi3). Only the shift and the rounding touch all 8 bytes.
+int32_t fixed_mul(int32_t a, int32_t b, uint8_t frac)
+{
+  int64_t p = (int64_t)a * b;
+  if (frac) { p += (int64_t)1 << (frac - 1); }
+  return(fixed_saturate(p >> frac));
+}
+
+// Unsigned (n << frac) / d, rounded. One 32-bit division for the integer part, then one
+// restoring shift-and-subtract step per fraction bit, so the 64-bit division of libgcc is never
+// linked. r < d <= 2^31 keeps r << 1 inside 32 bits. Returns more than 2^31 on overflow.
+static uint32_t fixed_udiv(uint32_t n, uint32_t d, uint8_t frac)
+{
+  uint32_t q = 0;
+  uint32_t r = n;
+  if (n >= d) {
+    q = n / d;
+    r = n - q*d;
+    if (q > (0x80000000UL >> frac)) { return(0xffffffffUL); }
+  }
+  while (frac--) {
+    q <<= 1;
+    r <<= 1;
+    if (r >= d) {
+      r -= d;
+      q |= 1;
+    }
+  }
+  if ((r << 1) >= d) { q++; } // Round to nearest
+  return(q);
+}
+
+int32_t fixed_div(int32_t a, int32_t b, uint8_t frac)
+{
+  uint8_t negative = (a < 0) != (b < 0);
+  uint32_t n = (a < 0) ? -(uint32_t)a : (uint32_t)a;
+  uint32_t d = (b < 0) ? -(uint32_t)b : (uint32_t)b;
+  uint32_t q;
+
+  if (d == 0) { return((a < 0) ? FIXED_MIN : FIXED_MAX); }
+  q = fixed_udiv(n, d, frac);
+  if (negative) { return((q >= 0x80000000UL) ? FIXED_MIN : -(int32_t)q); }
+  return((q > FIXED_MAX) ? FIXED_MAX : (int32_t)q);
+}
+
+q8_8_t q8_8_div(q8_8_t a, q8_8_t b)
+{
+  int32_t q = fixed_div(a, b, Q8_8_FRAC);
+  if (q > INT16_MAX) { return(INT16_MAX); }
+  if (q < INT16_MIN) { return(INT16_MIN); }
+  return(q);
+}
+
+static const uint32_t fixed_pow10[10] PROGMEM = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+int32_t fixed_from_decimal(int32_t value, uint8_t decimals, uint8_t frac)
+{
+  return(fixed_div(value, pgm_read_dword(&fixed_pow10[decimals]), frac));
+}
+
+int32_t fixed_to_decimal(int32_t a, uint8_t frac, uint8_t decimals)
+{
+  return(fixed_mul(a, pgm_read_dword(&fixed_pow10[decimals]), frac));
+}
+
+uint8_t fixed_parse(const char *line, uint8_t *char_counter, int32_t *value, uint8_t frac)
+{
+  const char *ptr = line + *char_counter;
+  uint32_t intval = 0;
+  uint32_t fracval = 0;   // Fraction digits as an integer,
+  uint8_t frac_digits = 0; // over 10^frac_digits
+  uint8_t isnegative = 0;
+  uint8_t isdecimal = 0;
+  uint8_t ndigit = 0;
+  uint8_t c = *ptr++;
+
+  if (c == '-') {
+    isnegative = 1;
+    c = *ptr++;
+  } else if (c == '+') {
+    c = *ptr++;
+  }
+
+  for (;;) {
+    c -= '0';
+    if (c <= 9) {
+      ndigit++;
+      if (!isdecimal) {
+        // Up to 0x0CCCCCCC the next digit can not wrap 32 bits: 10*0x0CCCCCCC + 9 = 0x80000001.
+        // Larger values are out of range for any frac anyway.
+        if (intval > 0x0CCCCCCCUL) { return(STATUS_BAD_NUMBER_FORMAT); }
+        intval = 10*intval + c;
+        if (intval > (0x80000000UL >> frac)) { return(STATUS_BAD_NUMBER_FORMAT); }
+      } else if (frac_digits < 9) {
+        fracval = 10*fracval + c;
+        frac_digits++;
+      }
+    } else if (c == (uint8_t)('.'-'0') && !isdecimal) {
+      isdecimal = 1;
+    } else {
+      break;
+    }
+    c = *ptr++;
+  }
+  if (!ndigit) { return(STATUS_BAD_NUMBER_FORMAT); }
+
+  // fracval < 10^frac_digits, so this is the fraction part of the division only.
+  uint32_t result = (intval << frac) + fixed_udiv(fracval, pgm_read_dword(&fixed_pow10[frac_digits]), frac);
+  if (result > (isnegative ? 0x80000000UL : 0x7fffffffUL)) { return(STATUS_BAD_NUMBER_FORMAT); }
+
+  *value = isnegative ? -(int32_t)result : (int32_t)result;
+  *char_counter = ptr - line - 1; // Set char_counter to next statement
+  return(STATUS_OK);
+}
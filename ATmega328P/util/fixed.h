@@ -0,0 +1,74 @@
+/*
+  fixed.h - Q-format binary fixed point
+
+  A Qm.n value is a signed integer scaled by 2^n: in Q16.16, 1.5 is 0x00018000. Add, subtract
+  and compare are plain integer operations. Multiply, divide, rounding, parsing and the
+  conversion to and from the parser's decimal fixed point (gc_fixed_t) are here, all in integer
+  arithmetic, so nothing pulls in the soft-float library. printFixed() in print.h formats them.
+
+  The generic functions take the fraction bits n as 'frac' and work on any Qm.n held in an
+  int32_t. q8_8_t and q16_16_t are the two common formats, with cheaper inline products.
+  Products and quotients round to nearest and saturate instead of wrapping.
+*/
+
+#ifndef fixed_h
+#define fixed_h
+#include <avr/io.h>
+
+typedef int16_t q8_8_t;   // -128 .. 127.996, resolution 1/256
+typedef int32_t q16_16_t; // -32768 .. 32767.99998, resolution 1/65536
+
+#define Q8_8_FRAC 8
+#define Q16_16_FRAC 16
+
+// Compile-time constant from a literal, rounded to nearest: Q16_16(1.5). Never for variables,
+// it would bring the float library back.
+#define FIXED_CONST(x,frac) ((int32_t)((x) * (double)(1UL << (frac)) + (((x) < 0) ? -0.5 : 0.5)))
+#define Q8_8(x) ((q8_8_t)FIXED_CONST(x,Q8_8_FRAC))
+#define Q16_16(x) ((q16_16_t)FIXED_CONST(x,Q16_16_FRAC))
+
+#define fixed_from_int(i,frac) ((int32_t)(i) * (1L << (frac)))
+#define fixed_floor(a,frac) ((a) >> (frac)) // Toward minus infinity
+#define fixed_ceil(a,frac) (((a) + ((1L << (frac)) - 1)) >> (frac))
+#define fixed_frac(a,frac) ((a) & ((1L << (frac)) - 1)) // Fraction bits, always positive
+
+// Rounds to the nearest integer, halves away from zero. Unsigned inside: a + half and half - a
+// pass the int32_t range at its ends.
+static inline int32_t fixed_round(int32_t a, uint8_t frac)
+{
+  uint32_t half = (1UL << frac) >> 1;
+  if (a < 0) { return((int32_t)(0 - ((half - (uint32_t)a) >> frac))); }
+  return((int32_t)(((uint32_t)a + half) >> frac));
+}
+
+// Q8.8 product: one 16x16 multiply on the hardware multiplier.
+static inline q8_8_t q8_8_mul(q8_8_t a, q8_8_t b)
+{
+  int32_t p = ((int32_t)a * b + 0x80) >> Q8_8_FRAC;
+  if (p > INT16_MAX) { return(INT16_MAX); }
+  if (p < INT16_MIN) { return(INT16_MIN); }
+  return(p);
+}
+
+// a*b >> frac. a and b may have different formats: the result has the fraction bits of
+// a and b added, minus frac.
+int32_t fixed_mul(int32_t a, int32_t b, uint8_t frac);
+
+// (a << frac) / b. Division by zero saturates to the sign of a.
+int32_t fixed_div(int32_t a, int32_t b, uint8_t frac);
+
+#define q16_16_mul(a,b) fixed_mul(a,b,Q16_16_FRAC)
+#define q16_16_div(a,b) fixed_div(a,b,Q16_16_FRAC)
+q8_8_t q8_8_div(q8_8_t a, q8_8_t b);
+
+// Between Qx.frac and decimal fixed point with 'decimals' implied digits, e.g. gc_fixed_t.
+int32_t fixed_from_decimal(int32_t value, uint8_t decimals, uint8_t frac);
+int32_t fixed_to_decimal(int32_t a, uint8_t frac, uint8_t decimals);
+
+// Reads a signed decimal number at line[*char_counter], e.g. "-12.375", into Qx.frac and
+// advances char_counter past it, like the g-code parser's read_fixed(). Digits beyond nine
+// decimals are ignored. Returns STATUS_OK, or STATUS_BAD_NUMBER_FORMAT without digits or when
+// the value does not fit.
+uint8_t fixed_parse(const char *line, uint8_t *char_counter, int32_t *value, uint8_t frac);
+
+#endif
@@ -0,0 +1,41 @@
+/*
+  gpior.h - ISR-to-main flag bits kept in the general purpose I/O registers
+
+  GPIOR0 sits at I/O address 0x1E, inside the sbi/cbi/sbis/sbic range. Setting, clearing or
+  testing one constant bit there is a single instruction, so it needs no SREG save/cli and can
+  not be torn by an interrupt. GPIOR1 and GPIOR2 (0x2A, 0x2B) are only in/out addressable:
+  still cheaper than SRAM, but a set or clear is in/ori/out and has to be guarded like RAM.
+
+  gpior_set()/gpior_clear() pick the single instruction form when the register is GPIOR0 and
+  the mask is one constant bit, and fall back to the SREG guarded read-modify-write otherwise.
+  Both checks fold at compile time. The _isr variants skip the guard; call them only with
+  interrupts off, i.e. from an ISR.
+*/
+
+#ifndef gpior_h
+#define gpior_h
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define GPIOR_IS_BITOP(reg,mask) ((&(reg) == &GPIOR0) && ((mask) != 0) && (((mask) & ((mask)-1)) == 0))
+
+#define gpior_set(reg,mask) do { \
+    if (GPIOR_IS_BITOP(reg,mask)) { (reg) |= (mask); } \
+    else { uint8_t sreg = SREG; cli(); (reg) |= (mask); SREG = sreg; } \
+  } while (0)
+#define gpior_clear(reg,mask) do { \
+    if (GPIOR_IS_BITOP(reg,mask)) { (reg) &= ~(mask); } \
+    else { uint8_t sreg = SREG; cli(); (reg) &= ~(mask); SREG = sreg; } \
+  } while (0)
+#define gpior_set_isr(reg,mask) ((reg) |= (mask))
+#define gpior_clear_isr(reg,mask) ((reg) &= ~(mask))
+#define gpior_test(reg,mask) (((reg) & (mask)) != 0)
+
+// Register assignment. Keep every user of a GPIOR bit listed here. The flags that are set from
+// ISRs and polled in the main loop most often go into GPIOR0.
+//   GPIOR0  bits 0-6 realtime executor flags, EXEC_* (serial.h); bit 7 below
+//   GPIOR1  realtime executor flags, EXEC_HI_* (serial.h)
+//   GPIOR2  free
+#define GPIOR0_SOFTSERIAL_OVERFLOW 7 // SoftSerial receive buffer overflowed (softSerial.c)
+
+#endif
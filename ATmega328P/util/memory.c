@@ -0,0 +1,54 @@
+/*
+  memory.c - SRAM usage: statics, heap and the stack watermark, see memory.h
+*/
+
+#include "memory.h"
+
+#ifdef MEMORY_STATS
+
+extern uint8_t __heap_start;
+extern void *__brkval; // avr-libc malloc() top, NULL until the first allocation
+
+// Paints [__heap_start, SP) with the canary. .init1 code falls through into the next init
+// section, and r1 is not zero yet here, so this is asm without a prologue, epilogue or ret.
+void memory_paint() __attribute__((naked, used, section(".init1")));
+void memory_paint()
+{
+  __asm__ volatile (
+    "    ldi r30, lo8(__heap_start)\n"
+    "    ldi r31, hi8(__heap_start)\n"
+    "    in r26, __SP_L__\n"
+    "    in r27, __SP_H__\n"
+    "    ldi r24, %0\n"
+    "    rjmp 2f\n"
+    "1:  st Z+, r24\n"
+    "2:  cp r30, r26\n"
+    "    cpc r31, r27\n"
+    "    brlo 1b\n"
+    :: "M" (MEMORY_CANARY));
+}
+
+static uint8_t *memory_heap_top()
+{
+  return (__brkval == 0) ? &__heap_start : (uint8_t *)__brkval;
+}
+
+void memory_get_stats(memory_stats_t *stats)
+{
+  uint8_t *top = memory_heap_top();
+  uint8_t *p = top;
+  uint8_t *sp = (uint8_t *)SP;
+
+  while ((p < sp) && (*p == MEMORY_CANARY)) { p++; }
+  stats->static_size = (uint16_t)&__heap_start - RAMSTART;
+  stats->heap_size = top - &__heap_start;
+  stats->stack_peak = (RAMEND + 1) - (uint16_t)p;
+  stats->free_min = p - top;
+}
+
+uint16_t memory_get_free()
+{
+  return (uint8_t *)SP - memory_heap_top();
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+  memory.h - SRAM usage: statics, heap and the stack watermark
+
+  Enabled with -DMEMORY_STATS. A naked .init1 routine, which runs before the C runtime sets up
+  .data and .bss, paints every byte from the end of the statics up to the stack pointer with
+  MEMORY_CANARY. The heap (malloc(), used by pcint and SoftSerial) grows up from the end of the
+  statics, the stack grows down from RAMEND, and neither restores the paint. memory_get_stats()
+  scans up from the heap top to the first byte that is no longer the canary: every byte above
+  it has been stack at some point since reset, so the gap is the smallest headroom seen so far.
+
+  The scan reads up to the whole free SRAM, about 6 cycles a byte. A stack byte that happens to
+  hold the canary value at the deepest point makes the watermark read a byte or so short.
+*/
+
+#ifndef memory_h
+#define memory_h
+#include <avr/io.h>
+
+#ifndef MEMORY_CANARY
+  #define MEMORY_CANARY 0xc5
+#endif
+
+typedef struct {
+  uint16_t static_size; // .data, .bss and .noinit
+  uint16_t heap_size;   // malloc() arena, __heap_start to __brkval
+  uint16_t stack_peak;  // Deepest stack since reset, in bytes up to RAMEND
+  uint16_t free_min;    // Bytes between the heap top and the deepest stack, never touched
+} memory_stats_t;
+
+void memory_get_stats(memory_stats_t *stats);
+
+// Bytes between the heap top and the stack pointer right now.
+uint16_t memory_get_free();
+
+#endif
@@ -20,24 +20,40 @@
 */
 
 #include "../serial/serial.h"
+#include "memory.h"
 
 #include <avr/pgmspace.h>
-#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+
+// The stream all print functions write to.
+stream_t *print_stream = &serial_stream;
+
+stream_t *print_bind(stream_t *s)
+{
+  stream_t *prev = print_stream;
+  print_stream = s;
+  return prev;
+}
+
+
+void printChar(char c)
+{
+  stream_write(print_stream, c);
+}
 
 
 void printString(const char *s)
 {
-  while (*s)
-    serial_write(*s++);
+  stream_write_block(print_stream, s, strlen(s));
 }
 
 
 // Print a string stored in PGM-memory
 void printPgmString(const char *s)
 {
-  char c;
-  while ((c = pgm_read_byte_near(s++)))
-    serial_write(c);
+  stream_write_block_P(print_stream, s, strlen_P(s));
 }
 
 
@@ -63,6 +79,57 @@ void printPgmString(const char *s)
 // }
 
 
+// Powers of ten for the upper digits of dec_digits().
+static const uint32_t dec_pow10[] PROGMEM = {
+  1000000000, 100000000, 10000000, 1000000, 100000, 10000
+};
+
+// Converts n to ten decimal digits '0'-'9' in buf, with leading zeros, and returns the number
+// of significant digits (at least 1). No division: AVR has no divider, and each 32-bit '%' or
+// '/' is a ~600 cycle libgcc call. The upper six digits are counted by subtracting powers of
+// ten (at most 9 per digit), which leaves n < 10000. The lower four use a multiply by the
+// reciprocal, q = m*0xCCCD >> 19, which is exact for m < 81920 and uses the hardware multiplier.
+static uint8_t dec_digits(uint32_t n, char *buf)
+{
+  uint8_t i;
+  for (i = 0; i < 6; i++) {
+    char d = '0';
+    if (n >= 10000) { // Skips the table for small values
+      uint32_t p = pgm_read_dword(&dec_pow10[i]);
+      while (n >= p) {
+        n -= p;
+        d++;
+      }
+    }
+    buf[i] = d;
+  }
+  uint16_t m = n;
+  for (i = 9; i > 5; i--) {
+    uint16_t q = ((uint32_t)m * 0xCCCD) >> 19;
+    buf[i] = '0' + (m - 10*q);
+    m = q;
+  }
+  for (i = 0; (i < 9) && (buf[i] == '0'); i++) { }
+  return (10 - i);
+}
+
+// Prints the last len digits of a dec_digits() buffer, with a decimal point before the last
+// decimals digits if point is set.
+static void print_dec_digits(const char *buf, uint8_t len, uint8_t decimals, uint8_t point)
+{
+  stream_write_block(print_stream, &buf[10 - len], len - decimals);
+  if (point) { stream_write(print_stream, '.'); }
+  stream_write_block(print_stream, &buf[10 - decimals], decimals);
+}
+
+// Number of characters dec_digits() output takes with decimals places: at least one digit
+// before the point.
+static uint8_t dec_length(uint8_t digits, uint8_t decimals)
+{
+  return ((digits > decimals) ? digits : decimals + 1);
+}
+
+
 // Prints an uint8 variable with base and number of desired digits.
 void print_unsigned_int8(uint8_t n, uint8_t base, uint8_t digits)
 { 
@@ -75,7 +142,7 @@ void print_unsigned_int8(uint8_t n, uint8_t base, uint8_t digits)
   }
 
   for (; i > 0; i--)
-      serial_write('0' + buf[i - 1]);
+      stream_write(print_stream, '0' + buf[i - 1]);
 }
 
 
@@ -86,40 +153,31 @@ void print_uint8_base2(uint8_t n) {
 
 
 // Prints an uint8 variable in base 10.
+// Digits by a multiply by the reciprocal, q = n*205 >> 11, exact for all uint8 values.
 void print_uint8_base10(uint8_t n)
 {   
-  uint8_t digits;
-  if (n < 10) { digits = 1; } 
-  else if (n < 100) { digits = 2; }
-  else { digits = 3; }
-  print_unsigned_int8(n,10,digits);
+  char buf[3];
+  uint8_t i = sizeof(buf);
+  do {
+    uint8_t q = ((uint16_t)n * 205) >> 11;
+    buf[--i] = '0' + (n - 10*q);
+    n = q;
+  } while (n);
+  stream_write_block(print_stream, &buf[i], sizeof(buf) - i);
 }
 
 
 void print_uint32_base10(uint32_t n)
 { 
-  if (n == 0) {
-    serial_write('0');
-    return;
-  } 
-
-  unsigned char buf[10]; 
-  uint8_t i = 0;  
-  
-  while (n > 0) {
-    buf[i++] = n % 10;
-    n /= 10;
-  }
-    
-  for (; i > 0; i--)
-    serial_write('0' + buf[i-1]);
+  char buf[10];
+  print_dec_digits(buf, dec_digits(n, buf), 0, 0);
 }
 
 
 void printInteger(long n)
 {
   if (n < 0) {
-    serial_write('-');
+    stream_write(print_stream, '-');
     print_uint32_base10(-n);
   } else {
     print_uint32_base10(n);
@@ -130,12 +188,12 @@ void printInteger(long n)
 // Convert float to string by immediately converting to a long integer, which contains
 // more digits than a float. Number of decimal places, which are tracked by a counter,
 // may be set by the user. The integer is then efficiently converted to a string.
-// NOTE: AVR '%' and '/' integer operations are very efficient. Bitshifting speed-up 
-// techniques are actually just slightly slower. Found this out the hard way.
+// The digits come from dec_digits(), without division.
 void printFloat(float n, uint8_t decimal_places)
 {
+  if (decimal_places > 9) { decimal_places = 9; } // Before the scaling below
   if (n < 0) {
-    serial_write('-');
+    stream_write(print_stream, '-');
     n = -n;
   }
 
@@ -146,52 +204,173 @@ void printFloat(float n, uint8_t decimal_places)
   }
   if (decimals) { n *= 10; }
   n += 0.5; // Add rounding factor. Ensures carryover through entire value.
-    
-  // Generate digits backwards and store in string.
-  unsigned char buf[10]; 
-  uint8_t i = 0;
-  uint32_t a = (long)n;  
-  buf[decimal_places] = '.'; // Place decimal point, even if decimal places are zero.
-  while(a > 0) {
-    if (i == decimal_places) { i++; } // Skip decimal point location
-    buf[i++] = (a % 10) + '0'; // Get digit
-    a /= 10;
+
+  // Print the digits with the decimal point, even if decimal places are zero.
+  char buf[10];
+  uint8_t digits = dec_digits((uint32_t)n, buf);
+  print_dec_digits(buf, dec_length(digits, decimal_places), decimal_places, 1);
+}
+
+
+// Prints a Qm.n binary fixed-point value, n = frac, rounded to decimal_places (at most 9).
+// Integer only: the fraction bits are scaled by 10^decimal_places in one widening multiply.
+void printFixed(int32_t n, uint8_t frac, uint8_t decimal_places)
+{
+  uint32_t u = n;
+  if (n < 0) {
+    stream_write(print_stream, '-');
+    u = -(uint32_t)n;
   }
-  while (i < decimal_places) { 
-     buf[i++] = '0'; // Fill in zeros to decimal point for (n < 1)
+  if (decimal_places > 9) { decimal_places = 9; }
+
+  uint32_t scale = 1;
+  uint8_t i;
+  for (i = 0; i < decimal_places; i++) { scale *= 10; }
+  uint32_t ipart = u >> frac;
+  uint32_t fpart = ((uint64_t)(u & ((1UL << frac) - 1)) * scale + ((1UL << frac) >> 1)) >> frac;
+  if (fpart == scale) { // Rounded up into the integer part
+    ipart++;
+    fpart = 0;
   }
-  if (i == decimal_places) { // Fill in leading zero, if needed.
-    i++;
-    buf[i++] = '0'; 
-  }   
-  
-  // Print the generated string.
-  for (; i > 0; i--)
-    serial_write(buf[i-1]);
-}
 
+  char buf[10];
+  print_dec_digits(buf, dec_digits(ipart, buf), 0, 0);
+  if (decimal_places) {
+    stream_write(print_stream, '.');
+    dec_digits(fpart, buf); // With leading zeros
+    stream_write_block(print_stream, &buf[10 - decimal_places], decimal_places);
+  }
+}
 
-// Debug tool to print free memory in bytes at the called point. 
-// NOTE: Keep commented unless using. Part of this function always gets compiled in.
-// void printFreeMemory()
-// {
-//   extern int __heap_start, *__brkval; 
-//   uint16_t free;  // Up to 64k values.
-//   free = (int) &free - (__brkval == 0 ? (int) &__heap_start : (int) __brkval); 
-//   printInteger((int32_t)free);
-//   printString(" ");
-// }
 
-#if _DEBUG
-void debugPrintfSerial(const char *cmd, ...)
+#ifdef MEMORY_STATS
+// Debug tool to print free memory in bytes at the called point.
+void printFreeMemory()
 {
-    char str[100] = {0};
-    va_list args;        //定义一个va_list类型的变量，用来储存单个参数
-    va_start(args, cmd); //使args指向可变参数的第一个参数
-    vsnprintf(str,sizeof(str), cmd, args);
-    va_end(args); //结束可变参数的获取
-    printString(str);
-}
-#else
-void debugPrintfSerial(const char *cmd, ...) {}
+  print_uint32_base10(memory_get_free());
+  stream_write(print_stream, ' ');
+}
 #endif
+
+// printPgmFormat() field flags
+#define FMT_LEFT bit(0)  // '-' left-justify in the field
+#define FMT_ZERO bit(1)  // '0' pad numbers with zeros
+#define FMT_LONG bit(2)  // 'l' 32-bit argument
+#define FMT_UPPER bit(3) // 'X' upper case hex digits
+
+static void print_padding(char c, uint8_t n)
+{
+  while (n--) { stream_write(print_stream, c); }
+}
+
+// Prints a string right- or left-justified in a field of width characters.
+static void print_field(const char *s, uint8_t pgm, uint8_t width, uint8_t flags)
+{
+  uint16_t len = pgm ? strlen_P(s) : strlen(s);
+  uint8_t pad = (width > len) ? width - len : 0;
+  if (!(flags & FMT_LEFT)) { print_padding(' ', pad); }
+  if (pgm) { stream_write_block_P(print_stream, s, len); }
+  else { stream_write_block(print_stream, s, len); }
+  if (flags & FMT_LEFT) { print_padding(' ', pad); }
+}
+
+// Prints a number in base 10 or 16. With decimals, n is a fixed-point value with that many
+// implied decimal places, e.g. n = 1234, decimals = 3 prints "1.234".
+static void print_format_number(uint32_t n, uint8_t negative, uint8_t base, uint8_t decimals,
+                                uint8_t width, uint8_t flags)
+{
+  char buf[10]; // dec_digits() buffer, or up to 8 hex digits at its end
+  uint8_t len;
+
+  if (base == 16) {
+    len = 0;
+    do {
+      uint8_t d = n & 0x0f;
+      n >>= 4;
+      if (d < 10) { buf[9 - len] = '0' + d; }
+      else { buf[9 - len] = ((flags & FMT_UPPER) ? 'A' : 'a') + d - 10; }
+      len++;
+    } while (n);
+    decimals = 0;
+  } else {
+    if (decimals > 9) { decimals = 9; }
+    len = dec_length(dec_digits(n, buf), decimals);
+  }
+
+  uint8_t total = len + (decimals != 0) + negative;
+  uint8_t pad = (width > total) ? width - total : 0;
+  if (flags & FMT_LEFT) { flags &= ~FMT_ZERO; }
+  if (!(flags & (FMT_LEFT|FMT_ZERO))) { print_padding(' ', pad); }
+  if (negative) { stream_write(print_stream, '-'); }
+  if (flags & FMT_ZERO) { print_padding('0', pad); }
+  print_dec_digits(buf, len, decimals, (decimals != 0));
+  if (flags & FMT_LEFT) { print_padding(' ', pad); }
+}
+
+// Formatted print with the format string in flash. Streams straight into print_stream: runs
+// of literal text are copied in bulk, numbers are converted in a 10 byte buffer. Nothing is
+// truncated. Supports %[-][0][width][.decimals][l]{d,i,u,x,X} and %c %s %S(flash string) %%.
+// Unlike C, a precision on d/i/u prints a fixed-point value: "%.3ld" with 12345 is "12.345".
+// Without 'l' the argument is an int (16 bit), with 'l' a 32-bit long.
+void printPgmFormat(const char *fmt, ...)
+{
+  va_list args;
+  char c;
+
+  va_start(args, fmt);
+  while ((c = pgm_read_byte(fmt)))
+  {
+    const char *run = fmt;
+    while (c && (c != '%')) { c = pgm_read_byte(++fmt); }
+    if (fmt != run) { stream_write_block_P(print_stream, run, fmt - run); }
+    if (!c) { break; }
+
+    uint8_t flags = 0;
+    uint8_t width = 0;
+    uint8_t decimals = 0;
+    for (;;) {
+      c = pgm_read_byte(++fmt);
+      if (c == '-') { flags |= FMT_LEFT; }
+      else if (c == '0') { flags |= FMT_ZERO; }
+      else { break; }
+    }
+    while ((uint8_t)(c - '0') <= 9) {
+      width = 10*width + (c - '0');
+      c = pgm_read_byte(++fmt);
+    }
+    if (c == '.') {
+      while ((uint8_t)((c = pgm_read_byte(++fmt)) - '0') <= 9) { decimals = 10*decimals + (c - '0'); }
+    }
+    if (c == 'l') {
+      flags |= FMT_LONG;
+      c = pgm_read_byte(++fmt);
+    }
+    if (!c) { break; }
+    fmt++;
+
+    switch (c) {
+      case 'd': case 'i': {
+        int32_t v = (flags & FMT_LONG) ? va_arg(args, int32_t) : va_arg(args, int);
+        if (v < 0) { print_format_number(-(uint32_t)v, 1, 10, decimals, width, flags); }
+        else { print_format_number(v, 0, 10, decimals, width, flags); }
+        break;
+      }
+      case 'X': flags |= FMT_UPPER; // no break
+      case 'x': case 'u': {
+        uint32_t v = (flags & FMT_LONG) ? va_arg(args, uint32_t) : va_arg(args, unsigned int);
+        if (c == 'u') { print_format_number(v, 0, 10, decimals, width, flags); }
+        else { print_format_number(v, 0, 16, 0, width, flags); }
+        break;
+      }
+      case 'c': {
+        char s[2] = { va_arg(args, int), 0 };
+        print_field(s, 0, width, flags);
+        break;
+      }
+      case 's': print_field(va_arg(args, const char *), 0, width, flags); break;
+      case 'S': print_field(va_arg(args, const char *), 1, width, flags); break;
+      default: stream_write(print_stream, c); // "%%", or an unknown conversion printed as is
+    }
+  }
+  va_end(args);
+}
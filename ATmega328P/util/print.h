@@ -22,9 +22,28 @@
 #ifndef print_h
 #define print_h
 #include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "stream.h"
 
-void debugPrintfSerial(const char *cmd, ...);
+// The stream all print functions write to, the USART after reset. See stream.h.
+extern stream_t *print_stream;
 
+// Binds the print functions to stream s. Returns the stream bound before, to restore it.
+stream_t *print_bind(stream_t *s);
+
+// Formatted print with the format string in flash, e.g. printPgmFormat(PSTR("X%.3ld"), x).
+// See print.c for the supported conversions.
+void printPgmFormat(const char *fmt, ...);
+
+// Debug output, compiled out without _DEBUG. Takes a format literal, which stays in flash.
+#if _DEBUG
+  #define debugPrintfSerial(fmt, ...) printPgmFormat(PSTR(fmt), ##__VA_ARGS__)
+#else
+  #define debugPrintfSerial(fmt, ...) do {} while (0)
+#endif
+
+
+void printChar(char c);
 
 void printString(const char *s);
 
@@ -45,8 +64,14 @@ void print_uint8_base10(uint8_t n);
 
 void printFloat(float n, uint8_t decimal_places);
 
+// Prints a Qm.n fixed-point value (see fixed.h) with n = frac, rounded to decimal_places.
+// The integer counterpart of printFloat().
+void printFixed(int32_t n, uint8_t frac, uint8_t decimal_places);
+#define printQ16_16(n,decimal_places) printFixed(n,16,decimal_places)
+#define printQ8_8(n,decimal_places) printFixed(n,8,decimal_places)
+
 
-// Debug tool to print free memory in bytes at the called point. Not used otherwise.
+// Debug tool to print free memory in bytes at the called point, with MEMORY_STATS.
 void printFreeMemory();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+//*****************************************************************************
+// File Name	: printtest.c
+//
+// Title		: cycle counts of the integer-to-decimal print functions
+// Revision		: 1.0
+// Notes		: Uses timer1 at clk/1, do not run with the stepper enabled.
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Revision History:
+// When			Who			Description of change
+// -----------	-----------	-----------------------
+// 19-Oct-2026	flyingyizi		Created the program
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>		   // include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h> // include interrupt support
+
+#include "../serial/serial.h"
+#include "print.h"
+#include <avr/pgmspace.h>
+
+//example
+// int main()
+// {
+//   // Initialize system upon power-up.
+//   serial_init(); // Setup serial baud rate and interrupts
+//   sei();         // Enable interrupts
+//   printTest();
+//   return 0;
+// }
+
+typedef void (*print_fn_t)(uint32_t n);
+
+// The conversion print_uint32_base10() used before, one '%' and one '/' per digit.
+static void print_div_u32(uint32_t n)
+{
+    unsigned char buf[10];
+    uint8_t i = 0;
+
+    if (n == 0) {
+        serial_write('0');
+        return;
+    }
+    while (n > 0) {
+        buf[i++] = n % 10;
+        n /= 10;
+    }
+    for (; i > 0; i--)
+        serial_write('0' + buf[i-1]);
+}
+
+// The conversion print_uint8_base10() used before, 8-bit '%' and '/' per digit.
+static void print_div_u8(uint32_t n)
+{
+    print_unsigned_int8(n, 10, (n < 10) ? 1 : (n < 100) ? 2 : 3);
+}
+
+static void print_new_u8(uint32_t n)  { print_uint8_base10(n); }
+static void print_new_u32(uint32_t n) { print_uint32_base10(n); }
+static void print_float(uint32_t n)   { printFloat(-123.456, 3); }
+static void print_nothing(uint32_t n) { }
+
+// Cycles for one call of fn, measured with timer1 at clk/1 and interrupts off. The output of
+// at most 10 characters fits the empty TX buffer, so serial_write() never waits.
+static uint16_t print_cycles(print_fn_t fn, uint32_t n)
+{
+    uint16_t t;
+
+    while (serial_get_tx_buffer_count()) { }
+    cli();
+    TCNT1 = 0;
+    fn(n);
+    t = TCNT1;
+    sei();
+    return t;
+}
+
+void printTest(void)
+{
+    static const uint32_t values[] PROGMEM = {
+        7, 255, 9999, 65535, 1234567, 4294967295UL // 8, 16 and 32 bit
+    };
+    uint8_t tccr1a = TCCR1A;
+    uint8_t tccr1b = TCCR1B;
+    uint16_t overhead;
+    uint8_t i;
+
+    TCCR1A = 0;
+    TCCR1B = (1 << CS10); // normal mode, clk/1
+    overhead = print_cycles(print_nothing, 0);
+
+    // Each row shows the output of both conversions, then their cycle counts.
+    printPgmString(PSTR("\r\n\n\nInteger to decimal, cycles per call. div = '%' and '/' per digit.\r\n"));
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        uint32_t n = pgm_read_dword(&values[i]);
+        uint8_t u8 = (n < 256);
+        uint16_t t_div, t_new;
+
+        printPgmString(u8 ? PSTR("u8  ") : (n < 65536) ? PSTR("u16 ") : PSTR("u32 "));
+        t_div = print_cycles(u8 ? print_div_u8 : print_div_u32, n) - overhead;
+        serial_write(' ');
+        t_new = print_cycles(u8 ? print_new_u8 : print_new_u32, n) - overhead;
+        printPgmFormat(PSTR("  div %5u  new %4u\r\n"), t_div, t_new);
+    }
+    printPgmString(PSTR("float "));
+    printPgmFormat(PSTR("  new %4u\r\n"), print_cycles(print_float, 0) - overhead);
+
+    TCCR1A = tccr1a;
+    TCCR1B = tccr1b;
+}
@@ -0,0 +1,8 @@
+#ifndef PRINTTEST_H
+#define PRINTTEST_H
+
+#include "print.h"
+
+void printTest(void);
+
+#endif
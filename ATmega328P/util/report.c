@@ -4,9 +4,64 @@
 #include "../serial/serial.h"
 #include "print.h"
 #include "report.h"
+#include "fixed.h"
+#include "../planner/planner.h"
+#include "../stepper/stepper.h"
+#include "../telemetry/telemetry.h"
+#include "memory.h"
+#include "../load/load.h"
 #include <avr/pgmspace.h>
 
 
+// Handles the primary confirmation protocol response for streaming interfaces and human-feedback.
+// For every incoming line, this method responds with an 'ok' for a successful command or an
+// 'error:' to indicate some error event with the line or some critical system error during
+// operation. Errors events can originate from the g-code parser, settings module, or asynchronously
+// from a critical error, such as a triggered hard limit. Interface should always monitor for these
+// responses. The numeric codes are listed in report.h.
+// With REPORT_BUFFER_STATE every response also carries " Bf:<planner blocks free>,<RX bytes free>"
+// as of the moment it is sent, e.g. "ok Bf:10,96". A host can use it for exact character-counting
+// streaming, see tools/stream.py.
+static void report_status_code(uint8_t status_code)
+{
+  if (status_code == 0) { // STATUS_OK
+    printPgmString(PSTR("ok"));
+  } else {
+    printPgmString(PSTR("error:"));
+    print_uint8_base10(status_code);
+  }
+}
+
+static void report_status_end()
+{
+  #ifdef REPORT_BUFFER_STATE
+    printPgmString(PSTR(" Bf:"));
+    print_uint8_base10(plan_get_block_buffer_available());
+    printChar(',');
+    print_uint8_base10(serial_get_rx_buffer_available());
+  #endif
+  printPgmString(PSTR("\r\n"));
+}
+
+void report_status_message(uint8_t status_code)
+{
+  report_status_code(status_code);
+  report_status_end();
+}
+
+
+// Answers a line that failed the N<line> ... *<checksum> framing. The line is not executed.
+// Lines already in flight behind it are rejected the same way with the same resend number,
+// so the host only has to go back to that line.
+void report_resend_request(uint8_t status_code, uint32_t line_number)
+{
+  report_status_code(status_code);
+  printPgmString(PSTR(" rs:"));
+  print_uint32_base10(line_number);
+  report_status_end();
+}
+
+
 // Prints feedback messages. This serves as a centralized method to provide additional
 // user feedback for things that are not of the status/alarm message protocol. These are
 // messages such as setup warnings, switch toggling, and how to exit alarms.
@@ -33,6 +88,101 @@ void report_feedback_message(uint8_t message_code)
     printPgmString(PSTR("Pgm End")); break;
     case MESSAGE_RESTORE_DEFAULTS:
     printPgmString(PSTR("Restoring defaults")); break;
+    case MESSAGE_RX_OVERFLOW:
+    printPgmString(PSTR("RX overflow")); break;
   }
   printPgmString(PSTR("]\r\n"));
 }
+
+
+// Machine position in mm as Q16.16. The step counts are scaled by mm-per-step constants in
+// Q4.28, in integer arithmetic only: steps * Q4.28 >> 12 is mm in Q16.16. Q4.28 needs at
+// least 0.125 steps per mm.
+static void report_position_mm(q16_16_t *mm)
+{
+  static const int32_t mm_per_step[N_AXIS] PROGMEM = {
+    FIXED_CONST(1.0/DEFAULT_X_STEPS_PER_MM, 28),
+    FIXED_CONST(1.0/DEFAULT_Y_STEPS_PER_MM, 28),
+    FIXED_CONST(1.0/DEFAULT_Z_STEPS_PER_MM, 28)
+  };
+  int32_t position[N_AXIS];
+  uint8_t idx;
+
+  st_get_position(position);
+  for (idx = 0; idx < N_AXIS; idx++) {
+    mm[idx] = fixed_mul(position[idx], pgm_read_dword(&mm_per_step[idx]), 28 - Q16_16_FRAC);
+  }
+}
+
+// Prints the realtime status report for the '?' command, e.g. "<Run,MPos:12.500,0.000,-1.000>".
+// With LOAD_METER it ends in the ISR, main and idle shares of the CPU in percent,
+// ",Ld:2.5,14.1,83.4".
+void report_realtime_status()
+{
+  q16_16_t mm[N_AXIS];
+  uint8_t idx;
+
+  report_position_mm(mm);
+  switch (st_get_state()) {
+    case ST_STATE_IDLE: printPgmString(PSTR("<Idle")); break;
+    case ST_STATE_CYCLE: printPgmString(PSTR("<Run")); break;
+    default: printPgmString(PSTR("<Hold")); break;
+  }
+  printPgmString(PSTR(",MPos:"));
+  for (idx = 0; idx < N_AXIS; idx++) {
+    printQ16_16(mm[idx], 3);
+    if (idx < (N_AXIS-1)) { printChar(','); }
+  }
+  #ifdef LOAD_METER
+    load_stats_t load;
+    load_get_stats(&load);
+    printPgmFormat(PSTR(",Ld:%.1u,%.1u,%.1u"), load.isr, load.main, load.idle);
+  #endif
+  printPgmString(PSTR(">\r\n"));
+}
+
+#ifdef TELEMETRY
+// The status report as a binary telemetry frame, for CMD_TELEMETRY_REPORT. Same content as
+// report_realtime_status() plus the buffer state, in TLM_SCHEMA_STATUS.
+void report_telemetry_status()
+{
+  q16_16_t mm[N_AXIS];
+  uint8_t idx;
+
+  report_position_mm(mm);
+  tlm_begin(TLM_SCHEMA_STATUS);
+  tlm_u8(st_get_state());
+  for (idx = 0; idx < N_AXIS; idx++) { tlm_u32(mm[idx]); }
+  tlm_u8(plan_get_block_buffer_available());
+  tlm_u8(serial_get_rx_buffer_available());
+  tlm_end();
+}
+#endif
+
+#ifdef MEMORY_STATS
+// SRAM usage for CMD_MEMORY_REPORT, in bytes, e.g. "[MEM:static=796,heap=70,stack=214,free=968]".
+// static + heap + stack + free is the whole SRAM; free is the headroom at the deepest stack
+// since reset.
+void report_memory_status()
+{
+  memory_stats_t stats;
+
+  memory_get_stats(&stats);
+  printPgmFormat(PSTR("[MEM:static=%u,heap=%u,stack=%u,free=%u]\r\n"),
+                 stats.static_size, stats.heap_size, stats.stack_peak, stats.free_min);
+}
+#endif
+
+#ifdef LOAD_METER
+// CPU load for CMD_LOAD_REPORT, over the last LOAD_WINDOW_MS, e.g.
+// "[LOAD:isr=2.5%,main=14.1%,idle=83.4%,loops=21034/s,max=1840us,peak=9520us]".
+// max is the longest main loop iteration in the window, peak the longest since reset.
+void report_load_status()
+{
+  load_stats_t load;
+
+  load_get_stats(&load);
+  printPgmFormat(PSTR("[LOAD:isr=%.1u%%,main=%.1u%%,idle=%.1u%%,loops=%lu/s,max=%luus,peak=%luus]\r\n"),
+                 load.isr, load.main, load.idle, load.loops, load.max_us, load.peak_us);
+}
+#endif
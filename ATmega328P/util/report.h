@@ -1,7 +1,32 @@
 
 #ifndef report_h
 #define report_h
+#include <avr/io.h>
 
+// Define Grbl status codes. Reported as "error:<code>" after a line that failed.
+#define STATUS_OK 0
+#define STATUS_EXPECTED_COMMAND_LETTER 1
+#define STATUS_BAD_NUMBER_FORMAT 2
+#define STATUS_INVALID_STATEMENT 3
+#define STATUS_NEGATIVE_VALUE 4
+#define STATUS_OVERFLOW 11
+
+#define STATUS_GCODE_UNSUPPORTED_COMMAND 20
+#define STATUS_GCODE_MODAL_GROUP_VIOLATION 21
+#define STATUS_GCODE_UNDEFINED_FEED_RATE 22
+#define STATUS_GCODE_COMMAND_VALUE_NOT_INTEGER 23
+#define STATUS_GCODE_AXIS_COMMAND_CONFLICT 24
+#define STATUS_GCODE_WORD_REPEATED 25
+#define STATUS_GCODE_NO_AXIS_WORDS 26
+#define STATUS_GCODE_INVALID_LINE_NUMBER 27
+#define STATUS_GCODE_VALUE_WORD_MISSING 28
+#define STATUS_GCODE_G53_INVALID_MOTION_MODE 30
+#define STATUS_GCODE_AXIS_WORDS_EXIST 31
+#define STATUS_GCODE_UNUSED_WORDS 36
+
+// Line framing errors (LINE_CHECKSUM). Reported with the line number to resend.
+#define STATUS_LINE_CHECKSUM 40
+#define STATUS_LINE_SEQUENCE 41
 
 // Define Grbl feedback message codes.
 #define MESSAGE_CRITICAL_EVENT 1
@@ -12,5 +37,27 @@
 #define MESSAGE_SAFETY_DOOR_AJAR 6
 #define MESSAGE_PROGRAM_END 7
 #define MESSAGE_RESTORE_DEFAULTS 8
+#define MESSAGE_RX_OVERFLOW 9
+
+// Prints system status messages.
+void report_status_message(uint8_t status_code);
+
+// Prints a framing error with the line number the host has to resend from, "error:40 rs:123".
+void report_resend_request(uint8_t status_code, uint32_t line_number);
+
+// Prints miscellaneous feedback messages.
+void report_feedback_message(uint8_t message_code);
+
+// Prints the realtime status report, machine state and position.
+void report_realtime_status();
+
+// Sends the status report as a binary telemetry frame. With TELEMETRY.
+void report_telemetry_status();
+
+// Prints the SRAM usage, with MEMORY_STATS. See memory.h.
+void report_memory_status();
+
+// Prints the CPU load and main loop figures, with LOAD_METER. See load.h.
+void report_load_status();
 
 #endif
\ No newline at end of file
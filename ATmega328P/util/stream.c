@@ -0,0 +1,79 @@
+/*
+  stream.c - Byte streams and the RAM buffer stream, see stream.h
+*/
+
+#include "stream.h"
+#include <string.h>
+
+void stream_write_bytes(stream_t *s, const char *data, uint16_t len, uint8_t pgm)
+{
+  void (*write_block)(stream_t *, const char *, uint16_t, uint8_t) = stream_op(s, write_block);
+  if (write_block)
+  {
+    write_block(s, data, len, pgm);
+    return;
+  }
+  void (*write)(stream_t *, uint8_t) = stream_op(s, write);
+  while (len--)
+  {
+    write(s, pgm ? pgm_read_byte(data) : *data);
+    data++;
+  }
+}
+
+
+static void stream_buf_write_block(stream_t *s, const char *data, uint16_t len, uint8_t pgm)
+{
+  stream_buf_t *b = (stream_buf_t *)s;
+  uint16_t n = b->size - b->len;
+  if (n > len) { n = len; }
+  if (pgm) { memcpy_P(&b->buf[b->len], data, n); }
+  else { memcpy(&b->buf[b->len], data, n); }
+  b->len += n;
+  b->dropped += len - n;
+}
+
+static void stream_buf_write(stream_t *s, uint8_t data)
+{
+  stream_buf_t *b = (stream_buf_t *)s;
+  if (b->len < b->size) { b->buf[b->len++] = data; }
+  else { b->dropped++; }
+}
+
+static uint16_t stream_buf_available(stream_t *s)
+{
+  stream_buf_t *b = (stream_buf_t *)s;
+  return b->len - b->pos;
+}
+
+static int stream_buf_read(stream_t *s)
+{
+  stream_buf_t *b = (stream_buf_t *)s;
+  if (b->pos == b->len) { return STREAM_NO_DATA; }
+  return (uint8_t)b->buf[b->pos++];
+}
+
+static const stream_ops_t stream_buf_ops PROGMEM = {
+  stream_buf_write, stream_buf_write_block, stream_buf_available, stream_buf_read
+};
+
+stream_t *stream_buf_init(stream_buf_t *b, char *buf, uint16_t size)
+{
+  b->stream.ops = &stream_buf_ops;
+  b->buf = buf;
+  b->size = size;
+  stream_buf_clear(b);
+  return &b->stream;
+}
+
+void stream_buf_clear(stream_buf_t *b)
+{
+  b->len = 0;
+  b->pos = 0;
+  b->dropped = 0;
+}
+
+void stream_buf_send(stream_buf_t *b, stream_t *dst)
+{
+  stream_write_block(dst, b->buf, b->len);
+}
@@ -0,0 +1,87 @@
+/*
+  stream.h - Byte streams: one interface for the USART, SoftSerial and RAM buffers
+
+  A stream is a struct that starts with a stream_t, whose ops table lives in flash. Implemented
+  by serial_stream (serial.c), each SoftSerial (its stream member, softSerial.c) and
+  stream_buf_t below. print.c writes to the stream bound with print_bind(), so all print and
+  report functions can go to any of them.
+
+  A report formatted once into RAM and sent to two ports in bulk:
+
+    char buf[80];
+    stream_buf_t out;
+    stream_t *prev = print_bind(stream_buf_init(&out, buf, sizeof(buf)));
+    report_realtime_status();
+    print_bind(prev);
+    stream_buf_send(&out, &serial_stream);
+    stream_buf_send(&out, &soft->stream);
+
+  The calls go through a function pointer read from flash, about 10 cycles more than calling
+  serial_write() directly. Bulk writes are one call per block.
+*/
+
+#ifndef stream_h
+#define stream_h
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#define STREAM_NO_DATA (-1)
+
+typedef struct stream stream_t;
+
+typedef struct {
+  void (*write)(stream_t *s, uint8_t data);
+  // pgm: data is in flash. NULL: one write() call per byte.
+  void (*write_block)(stream_t *s, const char *data, uint16_t len, uint8_t pgm);
+  uint16_t (*available)(stream_t *s); // Bytes ready to read
+  int (*read)(stream_t *s);           // Next byte, or STREAM_NO_DATA
+} stream_ops_t;
+
+struct stream {
+  const stream_ops_t *ops; // In PROGMEM
+};
+
+#define stream_op(s, op) ((__typeof__(((stream_ops_t *)0)->op))pgm_read_ptr(&(s)->ops->op))
+
+static inline void stream_write(stream_t *s, uint8_t data)
+{
+  stream_op(s, write)(s, data);
+}
+
+// Writes a block, in bulk where the stream supports it.
+void stream_write_bytes(stream_t *s, const char *data, uint16_t len, uint8_t pgm);
+#define stream_write_block(s, data, len) stream_write_bytes(s, data, len, 0)
+#define stream_write_block_P(s, data, len) stream_write_bytes(s, data, len, 1)
+
+static inline uint16_t stream_available(stream_t *s)
+{
+  return stream_op(s, available)(s);
+}
+
+static inline int stream_read(stream_t *s)
+{
+  return stream_op(s, read)(s);
+}
+
+
+// RAM buffer stream. Writes append until the buffer is full, the rest is counted as dropped.
+// Reads return the written bytes in order.
+typedef struct {
+  stream_t stream;
+  char *buf;
+  uint16_t size;
+  uint16_t len;     // Bytes written
+  uint16_t pos;     // Bytes read
+  uint16_t dropped; // Bytes that did not fit
+} stream_buf_t;
+
+// Sets up b on buf, empty. Returns the stream, e.g. for print_bind().
+stream_t *stream_buf_init(stream_buf_t *b, char *buf, uint16_t size);
+
+// Empties the buffer for the next use.
+void stream_buf_clear(stream_buf_t *b);
+
+// Sends the written bytes to dst in one block. Can be repeated for more ports.
+void stream_buf_send(stream_buf_t *b, stream_t *dst);
+
+#endif
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Runs the hot path benchmarks (firmware built with -DBENCH, "make benchmark") and prints a
+table of cycles and code size per path.
+
+The firmware measures each path with timer1 at clk/1 and prints
+"BENCH,<name>,<cycles>,<symbol>[+<symbol>...]" lines, then sleeps with interrupts off, which
+ends a simavr run; see ATmega328P/bench/benchtest.c. The sizes are the sizes of the listed
+symbols in the ELF. The output comes from simavr (default), a serial port running the same
+image on the chip, or a saved log.
+
+With --baseline the results are compared against a JSON file written earlier with --save.
+Any path that got slower or bigger by more than --tolerance percent is reported and the exit
+status is 1, so a regression is caught before flashing.
+
+usage: bench.py [--elf ELF] [--sim CMD | --port PORT [-b BAUD] | --log FILE]
+                [--format text|csv|json] [--save FILE] [--baseline FILE [--tolerance PCT]]
+"""
+
+import argparse
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import elf     # noqa: E402
+import stream  # noqa: E402
+
+ELF = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                   '..', 'ATmega328P', 'Debug', 'bin', 'myapp.elf')
+SIM = 'simavr -m atmega328p -f 16000000'
+LINE = re.compile(r'BENCH,(\w+),(\d+),([\w+]+)')
+ANSI = re.compile(r'\x1b\[[0-9;]*m')  # simavr colours the UART output
+
+
+def run_sim(cmd, path, timeout):
+    args = shlex.split(cmd) + [path]
+    try:
+        out = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             timeout=timeout).stdout
+    except FileNotFoundError:
+        raise SystemExit('%s: not found, install simavr or pass --sim' % args[0])
+    except subprocess.TimeoutExpired as e:
+        out = e.stdout or b''  # Did not reach the sleep, parse what there is
+    return out.decode('ascii', 'replace').splitlines()
+
+
+def run_port(port, baud, timeout):
+    link = stream.Link(port, baud)
+    lines = []
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        line = link.readline(timeout=deadline - time.time())
+        if line is None:
+            break
+        line = line.decode('ascii', 'replace')
+        lines.append(line)
+        if 'BENCH,end' in line:
+            break
+    return lines
+
+
+def parse(lines):
+    results = []
+    for line in lines:
+        m = LINE.search(ANSI.sub('', line))
+        if m:
+            results.append({'name': m.group(1), 'cycles': int(m.group(2)),
+                            'symbols': m.group(3).split('+')})
+    if not results:
+        raise SystemExit('no BENCH lines in the output, firmware built with -DBENCH?')
+    return results
+
+
+def add_sizes(results, path):
+    sizes = {}
+    for _, size, name in elf.Elf(path).functions():
+        sizes[name] = sizes.get(name, 0) + size
+    for r in results:
+        # A static function the compiler inlined has no symbol of its own; its code is in
+        # the caller's size already.
+        r['bytes'] = sum(sizes.get(s, 0) for s in r['symbols'])
+        r['symbols'] = [s for s in r['symbols'] if s in sizes]
+
+
+def compare(results, baseline, tolerance):
+    """Regression messages against a list of earlier results."""
+    old = dict((r['name'], r) for r in baseline)
+    out = []
+    for r in results:
+        b = old.get(r['name'])
+        if not b:
+            continue
+        for key in ('cycles', 'bytes'):
+            if b[key] and r[key] > b[key] * (1 + tolerance / 100.0):
+                out.append('%s: %s %d -> %d (%+.1f%%)' % (r['name'], key, b[key], r[key],
+                                                          100.0 * (r[key] - b[key]) / b[key]))
+    return out
+
+
+def print_results(results, fmt, baseline):
+    old = dict((r['name'], r) for r in baseline or [])
+    if fmt == 'json':
+        print(json.dumps(results, indent=1))
+    elif fmt == 'csv':
+        print('name,cycles,bytes,symbols')
+        for r in results:
+            print('%s,%d,%d,%s' % (r['name'], r['cycles'], r['bytes'], '+'.join(r['symbols'])))
+    else:
+        print('%-18s %8s %7s  %s' % ('path', 'cycles', 'bytes', 'symbols'))
+        for r in results:
+            b = old.get(r['name'])
+            delta = ('  (%+d, %+d)' % (r['cycles'] - b['cycles'], r['bytes'] - b['bytes'])
+                     if b else '')
+            print('%-18s %8d %7d  %s%s' % (r['name'], r['cycles'], r['bytes'],
+                                           '+'.join(r['symbols']), delta))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--elf', default=ELF)
+    src = ap.add_mutually_exclusive_group()
+    src.add_argument('--sim', default=SIM, help='simulator command, the ELF is appended')
+    src.add_argument('--port', help='read the results from the chip instead')
+    src.add_argument('--log', help='parse a saved output')
+    ap.add_argument('-b', '--baud', type=int, default=None)
+    ap.add_argument('--timeout', type=float, default=60.0)
+    ap.add_argument('--format', choices=('text', 'csv', 'json'), default='text')
+    ap.add_argument('--save', help='write the results as JSON, for --baseline')
+    ap.add_argument('--baseline', help='JSON results to compare against')
+    ap.add_argument('--tolerance', type=float, default=0.0, help='allowed growth in percent')
+    args = ap.parse_args()
+
+    if args.log:
+        with open(args.log, 'rb') as f:
+            lines = f.read().decode('ascii', 'replace').splitlines()
+    elif args.port:
+        lines = run_port(args.port, args.baud, args.timeout)
+    else:
+        lines = run_sim(args.sim, args.elf, args.timeout)
+    results = parse(lines)
+    add_sizes(results, args.elf)
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    print_results(results, args.format, baseline)
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump(results, f, indent=1)
+    if baseline is not None:
+        regressions = compare(results, baseline, args.tolerance)
+        for msg in regressions:
+            print('REGRESSION ' + msg, file=sys.stderr)
+        return 1 if regressions else 0
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,64 @@
+"""Minimal ELF reader for the host tools: section contents and the symbol table.
+
+Handles 32 and 64 bit files of either byte order, so the same code reads the avr-gcc output
+(ELF32, little-endian) and host builds.
+"""
+
+import struct
+
+STT_FUNC = 2
+SHT_SYMTAB = 2
+
+
+class Elf(object):
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = data = f.read()
+        if data[:4] != b'\x7fELF':
+            raise ValueError('%s: not an ELF file' % path)
+        self.path = path
+        self.bits64 = data[4] == 2
+        self.end = end = '<' if data[5] == 1 else '>'
+        if self.bits64:
+            shoff, = struct.unpack_from(end + 'Q', data, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from(end + 'HHH', data, 0x3a)
+            entry = end + 'IIQQQQIIQQ'
+        else:
+            shoff, = struct.unpack_from(end + 'I', data, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from(end + 'HHH', data, 0x2e)
+            entry = end + 'IIIIIIIIII'
+        # (name, type, flags, addr, offset, size, link, info, addralign, entsize)
+        self.sections = [list(struct.unpack_from(entry, data, shoff + i * shentsize))
+                         for i in range(shnum)]
+        strtab = self.sections[shstrndx][4]
+        for s in self.sections:
+            s[0] = self.string(strtab + s[0])
+
+    def string(self, offset):
+        return self.data[offset:self.data.index(b'\0', offset)].decode('ascii', 'replace')
+
+    def section(self, name):
+        for s in self.sections:
+            if s[0] == name:
+                return self.data[s[4]:s[4] + s[5]]
+        raise KeyError('%s: no %s section' % (self.path, name))
+
+    def functions(self):
+        """Sorted (address, size, name) of the function symbols."""
+        out = []
+        for s in self.sections:
+            if s[1] != SHT_SYMTAB:
+                continue
+            strtab = self.sections[s[6]][4]
+            if self.bits64:
+                fmt, size = self.end + 'IBBHQQ', 24
+            else:
+                fmt, size = self.end + 'IIIBBH', 16
+            for off in range(s[4], s[4] + s[5], size):
+                if self.bits64:
+                    name, info, _, shndx, value, sz = struct.unpack_from(fmt, self.data, off)
+                else:
+                    name, value, sz, info, _, shndx = struct.unpack_from(fmt, self.data, off)
+                if info & 0xf == STT_FUNC and shndx != 0:
+                    out.append((value, sz, self.string(strtab + name)))
+        return sorted(set(out))
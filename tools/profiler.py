@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Flat profile from the sampling profiler (firmware built with -DPROFILE).
+
+The firmware counts Timer2 samples of the interrupted PC in bins of 2^shift flash words and
+prints them on CMD_PROFILE_REPORT, clearing the histogram; see ATmega328P/profile/profile.h.
+This script takes one report, either from a capture file or from the serial port (it clears
+the histogram, waits --seconds and asks again), and charges each bin to the functions of the
+ELF that overlap it, in proportion to the overlap. A bin shared by several functions makes
+their figures approximate; such rows are marked '~'. Use a larger PROFILE_BINS for finer bins.
+
+usage: profiler.py [--elf ELF] [--bins] FILE
+       profiler.py [--elf ELF] [--bins] [-b BAUD] [--seconds S] PORT
+"""
+
+import argparse
+import collections
+import os
+import re
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import elf     # noqa: E402
+import stream  # noqa: E402
+
+ELF = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                   '..', 'ATmega328P', 'Debug', 'bin', 'myapp.elf')
+CMD_PROFILE_REPORT = b'\x85'
+HEADER = re.compile(r'\[PROF:(\d+),(\d+),(\d+)\]')
+BINS = re.compile(r'\[PBIN:([\d=,]+)\]')
+
+
+class Report(object):
+    def __init__(self, hz, shift, samples):
+        self.hz, self.shift, self.samples = hz, shift, samples
+        self.bins = {}
+
+    def complete(self):
+        return sum(self.bins.values()) >= self.samples
+
+
+def parse(lines):
+    """The last complete report in lines, or None."""
+    report, last = None, None
+    for line in lines:
+        m = HEADER.search(line)
+        if m:
+            report = Report(*map(int, m.groups()))
+        m = BINS.search(line)
+        if m and report:
+            for item in m.group(1).split(','):
+                b, c = item.split('=')
+                report.bins[int(b)] = int(c)
+        if report and report.complete():
+            last, report = report, None
+    return last
+
+
+def read_report(link, timeout=10.0):
+    lines = []
+    deadline = time.time() + timeout
+    link.write(CMD_PROFILE_REPORT)
+    while time.time() < deadline:
+        line = link.readline(timeout=deadline - time.time())
+        if line is None:
+            break
+        line = line.decode('ascii', 'replace')
+        lines.append(line)
+        if HEADER.search(line) or BINS.search(line):
+            report = parse(lines)
+            if report:
+                return report
+    raise SystemExit('no complete profile report, firmware built with -DPROFILE?')
+
+
+def attribute(report, functions):
+    """{name: (samples, shared)} from the bins and the (address, size, name) list."""
+    words = 1 << report.shift
+    out = collections.defaultdict(lambda: [0.0, False])
+    for b, count in report.bins.items():
+        lo, hi = 2 * b * words, 2 * (b + 1) * words  # Bytes, as the ELF symbols
+        hits = [(min(hi, a + s) - max(lo, a), n) for a, s, n in functions
+                if a < hi and a + s > lo and s]
+        covered = sum(h for h, _ in hits)
+        if covered == 0:
+            out['?0x%04x-0x%04x' % (lo, hi)][0] += count
+            continue
+        for h, n in hits:
+            out[n][0] += count * h / covered
+            out[n][1] = out[n][1] or len(hits) > 1
+    return out
+
+
+def print_profile(report, functions, show_bins):
+    seconds = report.samples / float(report.hz)
+    print('%d samples, %.1f s at %d Hz, %d words per bin' %
+          (report.samples, seconds, report.hz, 1 << report.shift))
+    if not report.samples:
+        return
+    if show_bins:
+        words = 1 << report.shift
+        for b in sorted(report.bins):
+            lo, hi = 2 * b * words, 2 * (b + 1) * words
+            names = [n for a, s, n in functions if a < hi and a + s > lo and s]
+            print('  bin %3d 0x%04x %6d  %s' % (b, lo, report.bins[b], ' '.join(names)))
+        print()
+    print('     %       samples  function')
+    rows = sorted(attribute(report, functions).items(), key=lambda kv: -kv[1][0])
+    for name, (count, shared) in rows:
+        print('%6.2f %s %9.1f  %s' % (100.0 * count / report.samples, '~' if shared else ' ',
+                                      count, name))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('source')
+    ap.add_argument('--elf', default=ELF)
+    ap.add_argument('-b', '--baud', type=int, default=None)
+    ap.add_argument('--seconds', type=float, default=10.0, help='sampling time on a port')
+    ap.add_argument('--bins', action='store_true', help='also list the raw bins')
+    args = ap.parse_args()
+    functions = elf.Elf(args.elf).functions()
+    if os.path.isfile(args.source):
+        with open(args.source, 'rb') as f:
+            report = parse(f.read().decode('ascii', 'replace').splitlines())
+        if report is None:
+            raise SystemExit('%s: no complete profile report' % args.source)
+    else:
+        link = stream.Link(args.source, args.baud)
+        read_report(link)  # Starts a fresh histogram
+        time.sleep(args.seconds)
+        report = read_report(link)
+    print_profile(report, functions, args.bins)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,273 @@
+#!/usr/bin/env python3
+"""Reference g-code streamer for the avrframe serial protocol.
+
+Two modes:
+
+  ping   send one line, wait for its 'ok'/'error:N', repeat. Always safe, but the link
+         idles for a full round trip plus the execution time of every line.
+  count  character counting. Keep sending while the bytes of all unacknowledged lines
+         still fit the device RX ring. Each ack frees the bytes of the oldest line.
+
+Character counting needs the RX ring size. Build the firmware with -DREPORT_BUFFER_STATE
+and every ack ends in " Bf:<planner blocks free>,<RX bytes free>". The streamer first
+sends an empty line and waits for its ack: the device is idle then, so the reported RX
+free space is the usable ring size. Without Bf, pass --rx-size (RX_BUFFER_SIZE - 1).
+
+Lines the firmware would keep more than LINE_BUFFER_SIZE - 1 bytes of (--line-size, default
+80) are refused before streaming starts: the device would only answer them with error:11.
+
+Bytes moved from the RX ring into the firmware's line slots are still counted as in
+flight until their ack arrives, so the count is always an upper bound of the real ring
+occupancy and the ring can not be overrun.
+
+--framed sends every line as "N<line><g-code>*<checksum>" for firmware built with
+-DLINE_CHECKSUM, starting with "N0M110" to reset the line number. A line that arrives
+corrupted or out of sequence is answered with "error:N rs:<line>"; the streamer goes
+back to that line and sends it and everything after it again. A corrupted newline merges
+two lines or leaves one unterminated, and its ack never comes: after --timeout seconds
+without an ack the streamer sends "*", which terminates any partial line and is itself
+always answered with the device's current resend number. The timeout must be longer than
+the slowest line (dwells, a full planner).
+
+usage: stream.py [-m ping|count] [-b BAUD] [--rx-size N] [--line-size N] [--framed [--timeout S]] [-q]
+                 PORT FILE
+"""
+
+import argparse
+import collections
+import os
+import re
+import select
+import sys
+import termios
+import time
+
+LINE_BUFFER_SIZE = 80  # Firmware default
+
+ACK_RE = re.compile(rb'(ok|error:(\d+))(?: rs:(\d+))?(?: Bf:(\d+),(\d+))?\s*$')
+
+
+class Link(object):
+    """Raw tty (or pty) opened with termios, read line by line."""
+
+    def __init__(self, path, baud=None):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        attr = termios.tcgetattr(self.fd)
+        attr[0] = 0                                   # iflag: no input processing
+        attr[1] = 0                                   # oflag: raw output
+        attr[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attr[3] = 0                                   # lflag: no echo, non-canonical
+        attr[6][termios.VMIN] = 1
+        attr[6][termios.VTIME] = 0
+        if baud:
+            speed = getattr(termios, 'B%d' % baud)
+            attr[4] = attr[5] = speed
+        termios.tcsetattr(self.fd, termios.TCSANOW, attr)
+        self.pending = b''
+
+    def write(self, data):
+        while data:
+            n = os.write(self.fd, data)
+            data = data[n:]
+
+    def readline(self, timeout=None):
+        """Returns the next line, or None if no complete line arrives within timeout."""
+        deadline = time.time() + timeout if timeout is not None else None
+        while b'\n' not in self.pending:
+            if deadline is not None:
+                left = deadline - time.time()
+                if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+                    return None
+            self.pending += os.read(self.fd, 256)
+        line, _, self.pending = self.pending.partition(b'\n')
+        return line
+
+    def read_ack(self, log=None, timeout=None):
+        """Returns (status, planner_free, rx_free, resend) of the next ack, or None on timeout.
+        Skips other lines."""
+        while True:
+            line = self.readline(timeout)
+            if line is None:
+                return None
+            m = ACK_RE.search(line)
+            if m:
+                status = int(m.group(2)) if m.group(2) else 0
+                bf = (int(m.group(4)), int(m.group(5))) if m.group(4) else (None, None)
+                resend = int(m.group(3)) if m.group(3) else None
+                return (status,) + bf + (resend,)
+            if log:
+                log(line)
+
+    def close(self):
+        os.close(self.fd)
+
+
+def prepare(lines):
+    """Strips comments/whitespace like the firmware preprocessor does, drops empty lines."""
+    out = []
+    for line in lines:
+        line = re.sub(r'\(.*?\)|;.*', '', line).strip()
+        if line:
+            out.append(line.encode('ascii') + b'\n')
+    return out
+
+
+def frame(lines):
+    """Numbers the lines and appends the XOR checksum. Line i of the result carries N<i>;
+    line 0 is the M110 that sets the device's line number."""
+    out = []
+    for n, line in enumerate([b'M110\n'] + lines):
+        body = b'N%d%s' % (n, line.rstrip(b'\n'))
+        checksum = 0
+        for c in body:
+            checksum ^= c
+        out.append(body + b'*%d\n' % checksum)
+    return out
+
+
+def line_length(line):
+    """Bytes of a sent line that the firmware stores in its line slot: no whitespace, no
+    '*<checksum>' and no newline."""
+    return len(re.sub(rb'\s', b'', line.split(b'*')[0]))
+
+
+def check_lines(lines, line_size):
+    """Refuses lines that would overflow the device line buffer. A framed one would be
+    answered error:11 on every resend."""
+    for line in lines:
+        if line_length(line) > line_size - 1:
+            raise ValueError('line longer than the line buffer: %r' % line)
+
+
+def resync(link, timeout):
+    """Asks an idle device for its resend number, see --timeout."""
+    while True:
+        link.write(b'*\n')
+        ack = link.read_ack(timeout=timeout)
+        if ack and ack[3] is not None:
+            return ack[3]
+
+
+def stream_ping(link, lines, on_error=None, timeout=None, line_size=LINE_BUFFER_SIZE):
+    check_lines(lines, line_size)
+    errors = 0
+    i = 0
+    while i < len(lines):
+        link.write(lines[i])
+        ack = link.read_ack(timeout=timeout)
+        if ack is None:
+            i = resync(link, timeout)
+            continue
+        status, _, _, resend = ack
+        if resend is not None:
+            i = resend
+            continue
+        if status:
+            errors += 1
+            if on_error:
+                on_error(lines[i], status)
+        i += 1
+    return errors
+
+
+def probe_rx_size(link):
+    """Sends an empty line to an idle device. Returns the RX free bytes of its ack, or None."""
+    link.write(b'\n')
+    return link.read_ack()[2]
+
+
+def stream_count(link, lines, rx_size, on_error=None, timeout=None, line_size=LINE_BUFFER_SIZE):
+    # Framed lines rejected with rs:<line> rewind 'i'. The lines sent after a rejected one
+    # are rejected with the same rs number; 'epoch' tells those stale rejects apart from a
+    # new failure of the resent lines.
+    inflight = collections.deque()
+    used = 0
+    errors = 0
+    epoch = 0
+    i = 0
+
+    def ack():
+        nonlocal used, errors, epoch, i
+        ack = link.read_ack(timeout=timeout)
+        if ack is None:
+            # A line lost its newline, so one ack will never come. The device is idle.
+            inflight.clear()
+            used = 0
+            epoch += 1
+            i = resync(link, timeout)
+            return
+        status, _, _, resend = ack
+        line, line_epoch = inflight.popleft()
+        used -= len(line)
+        if resend is not None:
+            if line_epoch == epoch:
+                epoch += 1
+                i = resend
+        elif status:
+            errors += 1
+            if on_error:
+                on_error(line, status)
+
+    for line in lines:
+        if len(line) > rx_size:
+            raise ValueError('line longer than the RX ring: %r' % line)
+    check_lines(lines, line_size)
+    while i < len(lines) or inflight:
+        if i == len(lines) or used + len(lines[i]) > rx_size:
+            ack()
+            continue
+        line = lines[i]
+        link.write(line)
+        inflight.append((line, epoch))
+        used += len(line)
+        i += 1
+    return errors
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('port')
+    ap.add_argument('file')
+    ap.add_argument('-m', '--mode', choices=('ping', 'count'), default='count')
+    ap.add_argument('-b', '--baud', type=int, default=None)
+    ap.add_argument('--rx-size', type=int, default=None,
+                    help='usable RX ring size when the firmware does not report Bf')
+    ap.add_argument('--line-size', type=int, default=LINE_BUFFER_SIZE,
+                    help='firmware LINE_BUFFER_SIZE (default %d)' % LINE_BUFFER_SIZE)
+    ap.add_argument('--framed', action='store_true',
+                    help='send N<line>...*<checksum> framed lines (firmware -DLINE_CHECKSUM)')
+    ap.add_argument('--timeout', type=float, default=5.0,
+                    help='seconds without an ack before a framed stream resyncs')
+    ap.add_argument('-q', '--quiet', action='store_true')
+    args = ap.parse_args()
+
+    with open(args.file) as f:
+        lines = prepare(f)
+    if args.framed:
+        lines = frame(lines)
+    link = Link(args.port, args.baud)
+
+    def on_error(line, status):
+        if not args.quiet:
+            sys.stderr.write('error:%d  %s\n' % (status, line.decode().strip()))
+
+    timeout = args.timeout if args.framed else None
+    start = time.time()
+    if args.mode == 'ping':
+        errors = stream_ping(link, lines, on_error, timeout, args.line_size)
+    else:
+        rx_size = probe_rx_size(link) or args.rx_size
+        if not rx_size:
+            ap.error('device does not report Bf, pass --rx-size')
+        errors = stream_count(link, lines, rx_size, on_error, timeout, args.line_size)
+    elapsed = time.time() - start
+    link.close()
+
+    nbytes = sum(len(l) for l in lines)
+    print('%d lines, %d bytes in %.2f s: %.0f lines/s, %.0f B/s, %d errors'
+          % (len(lines), nbytes, elapsed, len(lines) / elapsed, nbytes / elapsed, errors))
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
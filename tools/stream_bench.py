@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""Throughput benchmark for tools/stream.py against a simulated device on a pty.
+
+The device side models the firmware's receive path, not its motion: bytes arrive at the
+UART rate into an RX ring of RX_BUFFER_SIZE (overrun bytes are dropped and counted, as
+the real ISR does). The main loop moves them into LINE_BUFFER_COUNT line slots, each
+line costs --exec-us to execute, and motion lines wait for a free planner block, with one
+block retired every --block-us. --latency-us delays both directions, like the polling of a
+USB-serial bridge. Every ack carries " Bf:<blocks free>,<RX free>" as the
+firmware does with -DREPORT_BUFFER_STATE.
+
+With --framed the lines are sent as "N<line>...*<checksum>" and the device checks them like
+-DLINE_CHECKSUM firmware; --corrupt P flips a bit in each byte on the wire with
+probability P, to exercise the resend path.
+
+Each mode streams the same generated program; 'flood' sends without any flow control
+and shows what the ring does without it.
+
+usage: stream_bench.py [--lines N] [--baud B] [--exec-us T] [--block-us T] [--latency-us T]
+                       [--framed] [--corrupt P]
+"""
+
+import argparse
+import collections
+import os
+import random
+import re
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import stream  # noqa: E402
+
+FRAME_RE = re.compile(rb'N(\d+)(.*)\*(\d+)$')
+
+
+
+class Device(threading.Thread):
+    def __init__(self, fd, baud, rx_size, line_slots, blocks, exec_us, block_us, latency_us,
+                 corrupt=0.0):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.fd = fd
+        self.byte_s = 10.0 / baud
+        self.rx_size = rx_size
+        self.line_slots = line_slots
+        self.blocks = blocks
+        self.exec_s = exec_us * 1e-6
+        self.block_s = block_us * 1e-6
+        self.latency_s = latency_us * 1e-6
+        self.corrupt = corrupt
+        self.stop = False
+        self.overruns = 0
+        self.resends = 0
+        self.expected = 0
+
+    def check_frame(self, line):
+        """Returns (empty line, ack prefix) of a completed line, as protocol_check_frame()."""
+        if b'*' not in line and not line.startswith(b'N'):
+            return line, 'ok'
+        m = FRAME_RE.match(line)
+        checksum = 0
+        for c in line[:line.rfind(b'*')]:
+            checksum ^= c
+        if not m or int(m.group(3)) != checksum:
+            status = 40
+        elif m.group(2) == b'M110':
+            self.expected = int(m.group(1)) + 1
+            return b'', 'ok'
+        elif int(m.group(1)) != self.expected:
+            status = 41
+        else:
+            self.expected += 1
+            return line, 'ok'
+        self.resends += 1
+        return b'', 'error:%d rs:%d' % (status, self.expected)
+
+    def run(self):
+        inbound = collections.deque()  # (time, bytes) written by the host, before the UART
+        outbound = collections.deque() # (time, bytes) acks on their way to the host
+        wire = b''                     # bytes being shifted in by the UART
+        wire_t = time.time()           # time the next wire byte completes
+        rx = collections.deque()       # RX ring
+        slots = collections.deque()    # completed lines
+        line = b''
+        planner = 0                    # queued planner blocks
+        block_t = time.time()
+        current = None                 # line executing until busy_until
+        busy_until = 0.0
+        os.set_blocking(self.fd, False)
+        while not self.stop:
+            now = time.time()
+            try:
+                inbound.append((now + self.latency_s, os.read(self.fd, 4096)))
+            except BlockingIOError:
+                pass
+            while inbound and inbound[0][0] <= now:
+                wire += inbound.popleft()[1]
+            while outbound and outbound[0][0] <= now:
+                os.write(self.fd, outbound.popleft()[1])
+            # UART: one byte per character time.
+            if not wire:
+                wire_t = now
+            while wire and wire_t <= now:
+                c = wire[0:1]
+                if self.corrupt and random.random() < self.corrupt:
+                    c = bytes([c[0] ^ (1 << random.randrange(7))])
+                if len(rx) < self.rx_size - 1:
+                    rx.append(c)
+                else:
+                    self.overruns += 1
+                wire = wire[1:]
+                wire_t += self.byte_s
+            # Steppers retire planner blocks.
+            while planner and block_t + self.block_s <= now:
+                planner -= 1
+                block_t += self.block_s
+            if not planner:
+                block_t = now
+            # Line assembly, like protocol_read_lines().
+            while rx and len(slots) < self.line_slots:
+                c = rx.popleft()
+                if c == b'\n':
+                    slots.append(self.check_frame(line))
+                    line = b''
+                else:
+                    line += c
+            # Finish the executing line: ack it once parsed and queued to the planner.
+            if current is not None and now >= busy_until and (not current or planner < self.blocks - 1):
+                if current:
+                    planner += 1
+                prefix = slots.popleft()[1]
+                current = None
+                ack = '%s Bf:%d,%d\r\n' % (prefix, self.blocks - 1 - planner,
+                                            self.rx_size - 1 - len(rx))
+                outbound.append((now + self.latency_s, ack.encode()))
+            if current is None and slots:
+                current = slots[0][0]
+                busy_until = now + (self.exec_s if current else 0)
+            time.sleep(0.00005)
+
+
+def program(n):
+    return stream.prepare('G1X%.3fY%.3fF600' % (i * 0.01, (i % 100) * 0.02) for i in range(n))
+
+
+def nbytes(lines):
+    return sum(len(l) for l in lines)
+
+
+def run(mode, args, lines):
+    master, slave = os.openpty()
+    dev = Device(master, args.baud, args.rx_size, args.line_slots, args.blocks,
+                 args.exec_us, args.block_us, args.latency_us, args.corrupt)
+    dev.start()
+    link = stream.Link(os.ttyname(slave))
+    os.close(slave)
+    timeout = 0.5 if args.framed else None
+    start = time.time()
+    if mode == 'ping':
+        stream.stream_ping(link, lines, timeout=timeout)
+    elif mode == 'count':
+        stream.stream_count(link, lines, stream.probe_rx_size(link), timeout=timeout)
+    else:
+        link.write(b''.join(lines))
+        time.sleep(nbytes(lines) * 10.0 / args.baud + 2 * args.latency_us * 1e-6 + 0.2)
+    elapsed = time.time() - start
+    dev.stop = True
+    dev.join()
+    link.close()
+    os.close(master)
+    return elapsed, dev.overruns, dev.resends
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--lines', type=int, default=500)
+    ap.add_argument('--baud', type=int, default=115200)
+    ap.add_argument('--rx-size', type=int, default=128, help='RX_BUFFER_SIZE')
+    ap.add_argument('--line-slots', type=int, default=2, help='LINE_BUFFER_COUNT')
+    ap.add_argument('--blocks', type=int, default=12, help='BLOCK_BUFFER_SIZE')
+    ap.add_argument('--exec-us', type=int, default=1500, help='parse+plan time per line')
+    ap.add_argument('--block-us', type=int, default=2000, help='execution time per block')
+    ap.add_argument('--latency-us', type=int, default=1000,
+                    help='one-way host link latency, e.g. USB-serial bridge')
+    ap.add_argument('--framed', action='store_true', help='N<line>...*<checksum> framing')
+    ap.add_argument('--corrupt', type=float, default=0.0,
+                    help='probability of a bit error per byte on the wire')
+    ap.add_argument('--modes', default='ping,count,flood')
+    args = ap.parse_args()
+
+    lines = program(args.lines)
+    if args.framed:
+        lines = stream.frame(lines)
+    total = nbytes(lines)
+    print('%d lines, %d bytes, %d baud, RX %d, %d line slots, %d blocks'
+          % (len(lines), total, args.baud, args.rx_size, args.line_slots, args.blocks))
+    for mode in args.modes.split(','):
+        elapsed, overruns, resends = run(mode, args, lines)
+        if mode == 'flood':
+            print('%-6s %d RX overrun bytes' % (mode, overruns))
+        else:
+            print('%-6s %7.2f s  %6.0f lines/s  %6.0f B/s  %d RX overrun bytes  %d resends'
+                  % (mode, elapsed, len(lines) / elapsed, total / elapsed, overruns, resends))
+
+
+if __name__ == '__main__':
+    main()
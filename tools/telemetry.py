@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+"""Decoder and size benchmark for the binary telemetry frames (firmware built with -DTELEMETRY).
+
+A frame is 0x00, COBS(<schema id> <fields> <CRC-16/XMODEM, high byte first>), 0x00, mixed
+into the ordinary ASCII output; see ATmega328P/telemetry/telemetry.h. Schema descriptors are
+learned from the descriptor frames the firmware sends (schema id 0) and, for a stream joined
+late, read from the TELEMETRY_SCHEMAS table in telemetry.h.
+
+  decode  read a serial port (or a capture file) and print text lines and decoded frames.
+          With --poll HZ it requests a binary status report (CMD_TELEMETRY_REPORT) HZ times
+          per second.
+  bench   bytes per status report, ASCII '?' report against the binary frame, over random
+          positions, and the report rate that fits a baud rate.
+
+usage: telemetry.py decode [-b BAUD] [--poll HZ] PORT|FILE
+       telemetry.py bench [--samples N] [--baud B]
+"""
+
+import argparse
+import binascii
+import os
+import random
+import re
+import select
+import struct
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import stream  # noqa: E402
+
+HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                      '..', 'ATmega328P', 'telemetry', 'telemetry.h')
+CMD_TELEMETRY_REPORT = b'\x83'
+FIELD_TYPES = {'B': 'B', 'b': 'b', 'H': 'H', 'h': 'h', 'I': 'I', 'i': 'i', 'q': 'i'}
+STATES = {0: 'Idle', 1: 'Run', 2: 'Hold', 3: 'Queued'}
+
+
+def cobs_encode(data):
+    out = bytearray()
+    for run in data.split(b'\x00'):
+        assert len(run) < 254
+        out.append(len(run) + 1)
+        out += run
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError('bad COBS code')
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xff and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def crc16(data):
+    return binascii.crc_hqx(data, 0)  # CRC-16/XMODEM, as avr-libc _crc_xmodem_update()
+
+
+def frame(payload):
+    crc = crc16(payload)
+    return b'\x00' + cobs_encode(payload + bytes((crc >> 8, crc & 0xff))) + b'\x00'
+
+
+class Schema(object):
+    def __init__(self, descriptor):
+        self.name, _, fields = descriptor.partition(':')
+        self.fields = [(f[1:], f[0]) for f in fields.split(',') if f]
+        self.struct = struct.Struct('<' + ''.join(FIELD_TYPES[t] for _, t in self.fields))
+
+    def decode(self, data):
+        values = self.struct.unpack(data)
+        return [(name, v / 65536.0 if t == 'q' else v)
+                for (name, t), v in zip(self.fields, values)]
+
+
+class Decoder(object):
+    """Splits a byte stream into text lines and frames. feed() returns a list of
+    ('text', bytes), ('frame', schema name, [(field, value)]), ('schema', id, descriptor),
+    ('trace', raw records) and ('bad', reason)."""
+
+    def __init__(self, header=HEADER):
+        self.schemas = {}
+        if header and os.path.exists(header):
+            with open(header) as f:
+                text = f.read()
+            for m in re.finditer(r'X\((\w+),\s*"([^"]*)"\)', text):
+                ids = re.search(r'#define\s+%s\s+(\d+)' % m.group(1), text)
+                if ids:
+                    self.schemas[int(ids.group(1))] = Schema(m.group(2))
+        self.text = b''
+        self.frame = None  # bytes of the frame being collected, None outside a frame
+
+    def feed(self, data):
+        out = []
+        for c in data:
+            if c == 0:
+                if not self.frame:
+                    self.frame = bytearray()  # Opening zero
+                    continue
+                ev = self.decode(bytes(self.frame))
+                if ev[0] != 'bad':
+                    out.append(ev)
+                    self.frame = None
+                    continue
+                # Not a frame: joined mid-frame, or a corrupted one. Text between frames ends in
+                # a newline. Either way this zero may open the next frame.
+                if self.frame.endswith(b'\n'):
+                    out.append(('text', bytes(self.frame)))
+                else:
+                    out.append(ev)
+                self.frame = bytearray()
+                continue
+            if self.frame is not None:
+                self.frame.append(c)
+            else:
+                self.text += bytes((c,))
+                if c == 10:
+                    out.append(('text', self.text))
+                    self.text = b''
+        return out
+
+    def decode(self, raw):
+        try:
+            data = cobs_decode(raw)
+        except ValueError as e:
+            return ('bad', str(e))
+        if len(data) < 3:
+            return ('bad', 'short frame')
+        payload, crc = data[:-2], (data[-2] << 8) | data[-1]
+        if crc16(payload) != crc:
+            return ('bad', 'CRC')
+        schema = payload[0]
+        if schema == 0:
+            self.schemas[payload[1]] = Schema(payload[2:].decode('ascii'))
+            return ('schema', payload[1], payload[2:].decode('ascii'))
+        if schema not in self.schemas:
+            return ('bad', 'unknown schema %d' % schema)
+        s = self.schemas[schema]
+        if s.name == 'trace':
+            return ('trace', payload[1:])  # Variable length records, see tools/trace.py
+        if len(payload) - 1 != s.struct.size:
+            return ('bad', 'length')
+        return ('frame', s.name, s.decode(payload[1:]))
+
+
+def format_event(ev):
+    if ev[0] == 'text':
+        return ev[1].decode('ascii', 'replace').rstrip()
+    if ev[0] == 'frame':
+        return '#%s %s' % (ev[1], ' '.join('%s=%s' % (n, STATES.get(v, v) if n == 'state'
+                                                      else ('%.3f' % v if isinstance(v, float) else v))
+                                              for n, v in ev[2]))
+    if ev[0] == 'schema':
+        return '#schema %d %s' % (ev[1], ev[2])
+    if ev[0] == 'trace':
+        return '#trace %s' % binascii.hexlify(ev[1]).decode('ascii')
+    return '#bad frame: %s' % ev[1]
+
+
+def decode_main(args):
+    dec = Decoder()
+    if os.path.isfile(args.source):
+        with open(args.source, 'rb') as f:
+            for ev in dec.feed(f.read()):
+                print(format_event(ev))
+        return 0
+    link = stream.Link(args.source, args.baud)
+    next_poll = time.time()
+    while True:
+        if args.poll:
+            now = time.time()
+            if now >= next_poll:
+                link.write(CMD_TELEMETRY_REPORT)
+                next_poll = now + 1.0 / args.poll
+            timeout = max(0.0, next_poll - time.time())
+        else:
+            timeout = None
+        if select.select([link.fd], [], [], timeout)[0]:
+            for ev in dec.feed(os.read(link.fd, 256)):
+                print(format_event(ev))
+                sys.stdout.flush()
+
+
+def fixed_text(q, decimals=3):
+    """printFixed() of a Q16.16 value."""
+    sign = '-' if q < 0 else ''
+    u = abs(q)
+    scale = 10 ** decimals
+    ipart, fpart = u >> 16, ((u & 0xffff) * scale + 0x8000) >> 16
+    if fpart == scale:
+        ipart, fpart = ipart + 1, 0
+    return '%s%d.%0*d' % (sign, ipart, decimals, fpart)
+
+
+def bench_main(args):
+    rnd = random.Random(1)
+    steps_per_mm = 250
+    ascii_total = ascii_bf_total = binary_total = 0
+    dec = Decoder()
+    status = Schema('status:Bstate,qx,qy,qz,Bplan,Brx')
+    for n in range(args.samples):
+        state = rnd.choice((0, 1, 1, 1, 2))
+        mm = [round(rnd.uniform(-args.range, args.range) * steps_per_mm) * 65536 // steps_per_mm
+              for _ in range(3)]
+        plan, rx = rnd.randrange(16), rnd.randrange(128)
+        text = '<%s,MPos:%s>\r\n' % (STATES[state], ','.join(fixed_text(q) for q in mm))
+        ascii_total += len(text)
+        ascii_bf_total += len(text) + len(',Bf:%d,%d' % (plan, rx))
+        payload = bytes((1,)) + status.struct.pack(state, *mm, plan, rx)
+        f = frame(payload)
+        binary_total += len(f)
+        ev = dec.feed(f)
+        assert ev[0][0] == 'frame' and [v for _, v in ev[0][2]][1:4] == [q / 65536.0 for q in mm]
+    byte_s = args.baud / 10.0
+    print('%d status reports, positions within +/-%g mm, %d baud' % (args.samples, args.range, args.baud))
+    for name, total in (('ascii', ascii_total), ('ascii+Bf', ascii_bf_total), ('binary', binary_total)):
+        per = total / float(args.samples)
+        print('%-9s %5.1f bytes/report  %6.0f reports/s' % (name, per, byte_s / per))
+    return 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    sub = ap.add_subparsers(dest='cmd')
+    d = sub.add_parser('decode')
+    d.add_argument('source')
+    d.add_argument('-b', '--baud', type=int, default=None)
+    d.add_argument('--poll', type=float, default=0)
+    b = sub.add_parser('bench')
+    b.add_argument('--samples', type=int, default=10000)
+    b.add_argument('--baud', type=int, default=115200)
+    b.add_argument('--range', type=float, default=300.0, help='position range in mm')
+    args = ap.parse_args()
+    if args.cmd == 'decode':
+        return decode_main(args)
+    if args.cmd == 'bench':
+        return bench_main(args)
+    ap.print_help()
+    return 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""Decoder for the deferred trace log (firmware built with -DTELEMETRY -DTRACE).
+
+The firmware stores only a format id and the raw argument bytes of each trace point and sends
+them in telemetry frames of the 'trace' schema: <drop count> then records <id> <arguments>.
+The format strings live in the .trace_fmt section of the ELF, NUL terminated in id order
+(id 1 first); it is not loaded, so it is in the ELF only, not in the hex file. See
+ATmega328P/trace/trace.h.
+
+Reads a serial port (or a capture file) and prints the text lines, telemetry frames and the
+rebuilt trace messages. --dump lists the formats found in the ELF.
+
+usage: trace.py [--elf ELF] [-b BAUD] PORT|FILE
+       trace.py [--elf ELF] --dump
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import elf        # noqa: E402
+import stream     # noqa: E402
+import telemetry  # noqa: E402
+
+ELF = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                   '..', 'ATmega328P', 'Debug', 'bin', 'myapp.elf')
+SECTION = '.trace_fmt'
+
+# C conversion: flags, width, length modifier, conversion.
+CONVERSION = re.compile(r'%([-0+ #]*)(\d*)(hh|h|l)?([diuxXc%])')
+ARG_SIZE = {'hh': 1, 'h': 2, None: 2, 'l': 4}  # avr-gcc: int is 16 bits
+
+
+class Format(object):
+    def __init__(self, text):
+        self.text = text
+        self.args = []  # (struct code, C conversion)
+        for m in CONVERSION.finditer(text):
+            if m.group(4) == '%':
+                continue
+            size = ARG_SIZE[m.group(3)]
+            code = {1: 'b', 2: 'h', 4: 'i'}[size]
+            if m.group(4) not in 'di':
+                code = code.upper()
+            self.args.append(code)
+        self.struct = struct.Struct('<' + ''.join(self.args))
+        # Same string for Python: drop the length modifiers, %c takes an int too.
+        self.py = CONVERSION.sub(lambda m: '%' + m.group(1) + m.group(2) + m.group(4), text)
+
+    def format(self, values):
+        return self.py % tuple(values)
+
+
+def load_formats(path):
+    try:
+        raw = elf.Elf(path).section(SECTION)
+    except KeyError as e:
+        raise SystemExit('%s, not built with -DTRACE?' % e.args[0])
+    return [Format(s.decode('ascii')) for s in raw.rstrip(b'\0').split(b'\0')]
+
+
+def decode_records(formats, data):
+    """Messages in one trace frame payload (drop count and records)."""
+    out = []
+    if data[0]:
+        out.append('%d events dropped' % data[0])
+    i = 1
+    while i < len(data):
+        tid = data[i]
+        if not 1 <= tid <= len(formats):
+            out.append('unknown trace id %d, rest of frame skipped' % tid)
+            break
+        fmt = formats[tid - 1]
+        if i + 1 + fmt.struct.size > len(data):
+            out.append('truncated record for id %d' % tid)
+            break
+        out.append(fmt.format(fmt.struct.unpack_from(data, i + 1)))
+        i += 1 + fmt.struct.size
+    return out
+
+
+def print_events(formats, events):
+    for ev in events:
+        if ev[0] == 'trace':
+            for msg in decode_records(formats, ev[1]):
+                print('#trace ' + msg)
+        else:
+            print(telemetry.format_event(ev))
+    sys.stdout.flush()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('source', nargs='?')
+    ap.add_argument('--elf', default=ELF)
+    ap.add_argument('-b', '--baud', type=int, default=None)
+    ap.add_argument('--dump', action='store_true', help='list the trace formats and exit')
+    args = ap.parse_args()
+    formats = load_formats(args.elf)
+    if args.dump:
+        for i, f in enumerate(formats):
+            print('%3d  %s' % (i + 1, f.text))
+        return 0
+    if not args.source:
+        ap.print_help()
+        return 1
+    dec = telemetry.Decoder()
+    if os.path.isfile(args.source):
+        with open(args.source, 'rb') as f:
+            print_events(formats, dec.feed(f.read()))
+        return 0
+    link = stream.Link(args.source, args.baud)
+    while True:
+        print_events(formats, dec.feed(os.read(link.fd, 256)))
+
+
+if __name__ == '__main__':
+    sys.exit(main())